@@ -6,26 +6,112 @@ typedef struct result_s Result;
 typedef struct slice_s Slice;
 struct allocator_s {
 	Result (*alloc)(Allocator*, unsigned int);
+	Result (*alloc_aligned)(Allocator*, unsigned int, unsigned int);
+	Result (*alloc_zeroed)(Allocator*, unsigned int);
+	Result (*alloc_batch)(Allocator*, const unsigned int *sizes, Slice *out, unsigned int count);
 	Result (*realloc)(Allocator*, Slice, unsigned int);
+	Result (*resize)(Allocator*, Slice, unsigned int);
 	Result (*free)(Allocator*, Slice);
+	Result (*free_batch)(Allocator*, Slice *ptrs, unsigned int count);
 	Result (*freeall)(Allocator*);
 	Result (*clone)(Allocator*, Slice);
 	Result (*slice_split)(Allocator *, Slice whole, Slice part);
+	Result (*owns)(Allocator*, Slice);
 };
 
 #define ALLOC(allocator, length) (((Allocator*)allocator)->alloc(allocator, length))
+#define ALLOC_ALIGNED(allocator, length, alignment) (((Allocator*)allocator)->alloc_aligned(allocator, length, alignment))
+#define ALLOC_ZEROED(allocator, length) (((Allocator*)allocator)->alloc_zeroed(allocator, length))
+#define ALLOC_BATCH(allocator, sizes, out, count) (((Allocator*)allocator)->alloc_batch(allocator, sizes, out, count))
 #define REALLOC(allocator, ptr, length) (((Allocator*)allocator)->realloc(allocator, ptr, length))
+#define RESIZE(allocator, ptr, length) (((Allocator*)allocator)->resize(allocator, ptr, length))
 #define FREE(allocator, ptr) (((Allocator*)allocator)->free(allocator, ptr))
+#define FREE_BATCH(allocator, ptrs, count) (((Allocator*)allocator)->free_batch(allocator, ptrs, count))
 #define FREEALL(allocator) (((Allocator*)allocator)->freeall(allocator))
 #define CLONE(allocator, ptr) (((Allocator*)allocator)->clone(allocator, ptr))
 #define SLICE_SPLIT(allocator, whole, part) (((Allocator*)allocator)->slice_split(allocator, whole, part))
+#define OWNS(allocator, ptr) (((Allocator*)allocator)->owns(allocator, ptr))
+
+// True when ptr lies entirely inside whole
+#define SLICE_WITHIN(whole, ptr) \
+	((uint8_t*)(ptr).data >= (uint8_t*)(whole).data && \
+	(uint8_t*)(ptr).data + (ptr).length <= (uint8_t*)(whole).data + (whole).length)
+
+// Alignments are powers of two; the returned Slice starts on a multiple
+#define ALIGNMENT_VALID(alignment) ((alignment) != 0 && ((alignment) & ((alignment) - 1)) == 0)
 
 Result standard_clone(Allocator *allocator, Slice ptr);
+// Succeeds only when the block happens to land aligned, so whether it works
+// can depend on earlier traffic; allocators that place their blocks
+// (the bump allocators, buddy) give their own instead.
+Result standard_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment);
+// Allocators that cannot tell fresh memory from reused memory clear it all
+Result standard_alloc_zeroed(Allocator *allocator, unsigned int size);
+// A batch is allocated whole or not at all, and freed back to front so
+// bump allocators can reclaim a batch freed right after allocation.
+Result standard_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count);
+Result standard_free_batch(Allocator *allocator, Slice *ptrs, unsigned int count);
+Result standard_realloc_aligned(Allocator *allocator, Slice ptr, unsigned int size, unsigned int alignment);
 Result standard_realloc(Allocator *allocator, Slice ptr, unsigned int size);
+Result standard_resize(Allocator *allocator, Slice ptr, unsigned int size);
 Result standard_slice_split(Allocator *allocator, Slice whole, Slice part);
+// OWNS succeeds only when the allocator knows ptr came from it; a failure
+// means "not mine" or, for allocators like the raw heap, "cannot tell".
+Result standard_owns(Allocator *allocator, Slice ptr);
+
+// Allocators that wrap a parent never pass FREEALL on to it, since the
+// parent holds the wrapper too. Their FREEALL releases only what the
+// wrapper keeps itself (cached rounds, sampled slots, tracked blocks) and
+// returns OK; other blocks the parent served stay live until freed.
 
 Allocator *get_raw_heap_allocator(void);
 
+// Snapshot of how an allocator's capacity is split between live allocations
+// (including rounding) and free space, and how fragmented the latter is.
+typedef struct fragmentation_stats_s FragmentationStats;
+struct fragmentation_stats_s {
+	unsigned int capacity;
+	unsigned int bytes_requested;
+	unsigned int bytes_reserved;
+	unsigned int bytes_free;
+	unsigned int free_blocks;
+	unsigned int largest_free_block;
+};
+
+// What a bump allocator does with its pages when FREEALL resets it. The
+// first `retain` bytes always stay resident. TRIM_ON_RESET hands the rest
+// back to the OS on every reset; TRIM_WHEN_IDLE waits until `idle_resets`
+// resets in a row found no more than `retain` bytes in use, so steady
+// bursts do not pay for page faults while one-off spikes still shrink.
+// Each spike is trimmed once, and an `idle_resets` of 0 acts as 1.
+// A zeroed policy never trims.
+enum trim_mode {
+	TRIM_NEVER,
+	TRIM_ON_RESET,
+	TRIM_WHEN_IDLE,
+};
+
+// TRIM_DONTNEED drops pages at once and they read back as zeroes;
+// TRIM_LAZY lets the kernel reclaim them only under memory pressure.
+enum trim_advice {
+	TRIM_DONTNEED,
+	TRIM_LAZY,
+};
+
+typedef struct trim_policy_s TrimPolicy;
+struct trim_policy_s {
+	enum trim_mode mode;
+	enum trim_advice advice;
+	size_t retain;
+	unsigned int idle_resets;
+};
+
+// Releases the whole pages inside ptr; the memory stays mapped and usable
+Result trim_pages(Slice ptr, enum trim_advice);
+// Called on every reset with the most memory used since the last one, and
+// a counter the caller keeps; true when the reset should trim.
+int trim_policy_due(TrimPolicy*, unsigned int *idle, size_t high_water);
+
 struct heap_allocator_s;
 typedef struct heap_allocator_s HeapAllocator;
 
@@ -33,9 +119,307 @@ struct basic_linear_alloc_s;
 typedef struct basic_linear_alloc_s BasicLinearAllocator;
 Result new_basic_linear_allocator(Allocator*, unsigned int max_size);
 Result deinit_basic_linear_allocator(BasicLinearAllocator*);
+Result basic_linear_set_trim_policy(BasicLinearAllocator*, TrimPolicy);
+// Returns the unused tail past the policy's retained bytes to the OS
+Result basic_linear_trim(BasicLinearAllocator*);
+
+// Serves allocations from a caller-provided buffer, e.g. one on the stack
+// or embedded in a struct, and falls back to the parent once it runs out.
+// Frees and reallocs are routed by which of the two owns the pointer. The
+// allocator itself lives in caller storage too.
+struct inline_alloc_s;
+typedef struct inline_alloc_s InlineAllocator;
+Result new_inline_allocator(InlineAllocator*, Slice buffer, Allocator *parent);
+Result deinit_inline_allocator(InlineAllocator*);
 
+// Bump allocator that many threads can share without locks. FREEALL starts
+// a new epoch and must not race with allocations from the previous one.
+struct concurrent_linear_alloc_s;
+typedef struct concurrent_linear_alloc_s ConcurrentLinearAllocator;
+Result new_concurrent_linear_allocator(Allocator*, unsigned int max_size);
+Result deinit_concurrent_linear_allocator(ConcurrentLinearAllocator*);
+uint64_t concurrent_linear_epoch(ConcurrentLinearAllocator*);
+
+// Checkpoint of a bump allocator. Rewinding to it releases everything
+// allocated since in O(1); FREEALL invalidates outstanding marks.
+typedef struct arena_mark_s ArenaMark;
+struct arena_mark_s {
+	void *chunk;
+	unsigned int used;
+};
+ArenaMark basic_linear_mark(BasicLinearAllocator*);
+Result basic_linear_rewind(BasicLinearAllocator*, ArenaMark);
+
+struct linear_alloc_s;
+typedef struct linear_alloc_s LinearAllocator;
 Result init_linear_allocator(Allocator*, unsigned int max_size);
 Result deinit_linear_allocator(Allocator*);
+Result linear_allocator_stats(Allocator*, FragmentationStats*);
+Result linear_allocator_set_trim_policy(Allocator*, TrimPolicy);
+// Returns the pages inside free blocks past the retained bytes to the OS
+Result linear_allocator_trim(Allocator*);
+
+struct slab_alloc_s;
+typedef struct slab_alloc_s SlabAllocator;
+unsigned int size_class_index(unsigned int size);
+unsigned int size_class_length(unsigned int index);
+Result new_slab_allocator(Allocator*, unsigned int page_size);
+Result deinit_slab_allocator(SlabAllocator*);
+
+struct magazine_alloc_s;
+typedef struct magazine_alloc_s MagazineAllocator;
+Result new_magazine_allocator(Allocator*);
+Result deinit_magazine_allocator(MagazineAllocator*);
+
+// Lock-free pool of one object size, refilled from the parent a batch at a
+// time. Larger requests are forwarded to the parent. Each thread keeps the
+// objects it freed last, so alloc/free pairs stay off the shared free list;
+// threads must have stopped using the pool before deinit.
+struct pool_alloc_s;
+typedef struct pool_alloc_s PoolAllocator;
+Result new_pool_allocator(Allocator*, unsigned int object_size, unsigned int batch_count);
+Result deinit_pool_allocator(PoolAllocator*);
+
+struct tlsf_alloc_s;
+typedef struct tlsf_alloc_s TlsfAllocator;
+Result init_tlsf_allocator(Allocator*, unsigned int max_size);
+Result deinit_tlsf_allocator(Allocator*);
+
+struct buddy_alloc_s;
+typedef struct buddy_alloc_s BuddyAllocator;
+Result init_buddy_allocator(Allocator*, unsigned int max_size);
+Result deinit_buddy_allocator(Allocator*);
+Result buddy_allocator_stats(Allocator*, FragmentationStats*);
+
+// What a chained arena keeps of its chunks when it is reset with FREEALL
+enum arena_retention {
+	ARENA_RETAIN_ALL,
+	ARENA_RETAIN_LARGEST,
+	ARENA_RETAIN_FIRST,
+	ARENA_RETAIN_NONE,
+};
+
+struct arena_alloc_s;
+typedef struct arena_alloc_s ArenaAllocator;
+Result new_arena_allocator(Allocator*, unsigned int initial_size, enum arena_retention);
+Result deinit_arena_allocator(ArenaAllocator*);
+ArenaMark arena_mark(ArenaAllocator*);
+Result arena_rewind(ArenaAllocator*, ArenaMark);
+// Frees the retained chunks past the current one back to the parent
+Result arena_trim(ArenaAllocator*);
+
+// Per-thread scratch arenas. scratch_begin() picks one that is not
+// `conflict` (usually the caller's own arena) so results and temporaries
+// never share an arena; scratch_end() rewinds it.
+typedef struct scratch_s Scratch;
+struct scratch_s {
+	ArenaAllocator *arena;
+	ArenaMark mark;
+};
+Result scratch_begin(Scratch*, Allocator *conflict);
+Result scratch_end(Scratch*);
+Result release_scratch_arenas(void);
+
+// Arena over a fixed mmap reservation: memory is committed as the bump
+// pointer advances, so allocations never move. FREEALL decommits whatever
+// lies past the first `retain` bytes; pass SIZE_MAX to keep everything.
+struct vm_arena_alloc_s;
+typedef struct vm_arena_alloc_s VmArenaAllocator;
+Result new_vm_arena_allocator(size_t reserve, size_t retain);
+Result deinit_vm_arena_allocator(VmArenaAllocator*);
+// Decommits the granules past both the bump pointer and `retain`
+Result vm_arena_trim(VmArenaAllocator*);
+
+// Maps large requests as 2 MiB aligned runs of huge pages, explicit ones if
+// the system has a hugetlb pool and transparent ones otherwise. Small
+// requests, and the bookkeeping, go to the parent.
+typedef struct huge_page_stats_s HugePageStats;
+struct huge_page_stats_s {
+	unsigned int regions;
+	size_t bytes_mapped;
+	size_t bytes_hugetlb;
+	size_t bytes_advised;
+	size_t bytes_thp_backed;
+};
+
+struct huge_page_alloc_s;
+typedef struct huge_page_alloc_s HugePageAllocator;
+Result new_huge_page_allocator(Allocator*);
+Result deinit_huge_page_allocator(HugePageAllocator*);
+Result huge_page_allocator_stats(HugePageAllocator*, HugePageStats*);
+
+// Maps every allocation as its own run of pages and asks the kernel to
+// place them on one NUMA node; node -1 picks the calling thread's node.
+// On single-node machines, or when mbind() is refused, the memory is
+// mapped as usual. Every allocation costs an mmap() and at least a whole
+// page, and FREE and OWNS walk a list of all of them under one lock. Give
+// it a few large buffers, as the parent of an arena or linear allocator;
+// even the small struct of such an allocator takes a page of its own.
+struct numa_alloc_s;
+typedef struct numa_alloc_s NumaAllocator;
+Result new_numa_allocator(Allocator*, int node);
+Result deinit_numa_allocator(NumaAllocator*);
+int numa_node_count(void);
+int numa_current_node(void);
+
+// Process-wide NUMA allocators, one per node, created on first use.
+// release_numa_allocators() must not race with their users.
+Allocator *numa_node_allocator(int node);
+Allocator *numa_local_allocator(void);
+Result release_numa_allocators(void);
+
+// Sends one allocation in about sample_rate, per thread, to a page of its
+// own that ends against a PROT_NONE guard page, so an overrun faults on the
+// first byte past the block. Freed pages are made inaccessible and reused as
+// late as possible. Everything else, including blocks larger than a page and
+// requests made while every slot is live, is forwarded to the parent.
+enum guard_fault {
+	GUARD_FAULT_OVERFLOW,
+	GUARD_FAULT_UNDERFLOW,
+	GUARD_FAULT_USE_AFTER_FREE,
+	GUARD_FAULT_UNKNOWN
+};
+
+typedef struct guard_report_s GuardReport;
+struct guard_report_s {
+	enum guard_fault fault;
+	Slice allocation;
+};
+
+struct guard_alloc_s;
+typedef struct guard_alloc_s GuardAllocator;
+Result new_guard_allocator(Allocator*, unsigned int sample_rate, unsigned int slot_count);
+Result deinit_guard_allocator(GuardAllocator*);
+// Samples the calling thread's next allocation through any guard allocator
+void guard_sample_next(void);
+// Attributes a faulting address to a sampled block. Takes no lock, so a
+// SIGSEGV handler may call it.
+Result guard_allocator_describe(GuardAllocator*, void *address, GuardReport*);
+
+// Counts the traffic through a parent allocator. histogram[n] counts
+// requests of 2^n up to 2^(n+1) - 1 bytes.
+#define ALLOCATOR_HISTOGRAM_BUCKETS 32
+typedef struct allocator_stats_s AllocatorStats;
+struct allocator_stats_s {
+	uint64_t allocs;
+	uint64_t reallocs;
+	uint64_t resizes;
+	uint64_t frees;
+	uint64_t failures;
+	uint64_t bytes_live;
+	uint64_t bytes_peak;
+	uint64_t histogram[ALLOCATOR_HISTOGRAM_BUCKETS];
+};
+
+struct stats_alloc_s;
+typedef struct stats_alloc_s StatsAllocator;
+Result new_stats_allocator(Allocator*);
+Result deinit_stats_allocator(StatsAllocator*);
+Result stats_allocator_snapshot(StatsAllocator*, AllocatorStats*);
+Result stats_allocator_reset(StatsAllocator*);
+
+// Debug wrapper that remembers the call site of every live allocation so
+// leaks can be reported grouped by where they were made.
+typedef struct trace_site_s TraceSite;
+struct trace_site_s {
+	void *site;
+	unsigned int allocations;
+	uint64_t bytes;
+};
+
+struct trace_alloc_s;
+typedef struct trace_alloc_s TraceAllocator;
+Result new_trace_allocator(Allocator*);
+Result deinit_trace_allocator(TraceAllocator*);
+Result trace_allocator_report(TraceAllocator*, TraceSite *sites, unsigned int capacity);
+Result trace_allocator_dump(TraceAllocator*, int fd, unsigned int max_sites);
+
+// Holds the bytes allocated through it under a budget. Crossing the soft
+// limit runs the pressure callbacks once, so caches can be shrunk; a request
+// that would pass the hard limit runs them again and fails if that did not
+// free enough. Callbacks run on the allocating thread and may free through
+// the allocator, but allocations they make are never given relief.
+enum budget_level {
+	BUDGET_SOFT,
+	BUDGET_HARD
+};
+
+typedef struct budget_usage_s BudgetUsage;
+struct budget_usage_s {
+	size_t used;
+	size_t peak;
+	size_t soft_limit;
+	size_t hard_limit;
+	uint64_t pressure_events;
+	uint64_t failures;
+};
+
+struct budget_alloc_s;
+typedef struct budget_alloc_s BudgetAllocator;
+// `excess` is how far usage is past the soft limit, or for BUDGET_HARD how
+// much has to be freed for the failing request to fit
+typedef void (*BudgetPressure)(BudgetAllocator*, enum budget_level, size_t excess, void *context);
+Result new_budget_allocator(Allocator*, size_t soft_limit, size_t hard_limit);
+Result deinit_budget_allocator(BudgetAllocator*);
+Result budget_allocator_on_pressure(BudgetAllocator*, BudgetPressure, void *context);
+// Lowering a limit below current usage fails nothing already allocated
+Result budget_allocator_set_limits(BudgetAllocator*, size_t soft_limit, size_t hard_limit);
+Result budget_allocator_usage(BudgetAllocator*, BudgetUsage*);
+
+// Combinators that build one allocator out of others, which they borrow
+// rather than own. The segregator sends sizes up to threshold to `small`
+// and the rest to `large`; the fallback tries `primary` first and routes
+// frees by asking it OWNS; the bucketizer sends sizes in
+// [min + n * step, min + (n + 1) * step) to buckets[n] and fails the rest.
+struct segregator_alloc_s;
+typedef struct segregator_alloc_s SegregatorAllocator;
+Result new_segregator_allocator(Allocator*, unsigned int threshold, Allocator *small, Allocator *large);
+Result deinit_segregator_allocator(SegregatorAllocator*);
+
+struct fallback_alloc_s;
+typedef struct fallback_alloc_s FallbackAllocator;
+Result new_fallback_allocator(Allocator*, Allocator *primary, Allocator *secondary);
+Result deinit_fallback_allocator(FallbackAllocator*);
+
+struct bucketizer_alloc_s;
+typedef struct bucketizer_alloc_s BucketizerAllocator;
+Result new_bucketizer_allocator(Allocator*, Allocator **buckets, unsigned int count, unsigned int min, unsigned int step);
+Result deinit_bucketizer_allocator(BucketizerAllocator*);
+
+// Epoch-based reclamation for lock-free readers. Readers bracket their
+// accesses with epoch_enter()/epoch_exit(); writers unlink memory and
+// epoch_retire() it, and it is freed once no reader can still see it.
+// Each thread registers its own record and must not share it.
+struct epoch_domain_s;
+typedef struct epoch_domain_s EpochDomain;
+struct epoch_record_s;
+typedef struct epoch_record_s EpochRecord;
+Result new_epoch_domain(Allocator*);
+Result deinit_epoch_domain(EpochDomain*);
+Result epoch_register(EpochDomain*);
+Result epoch_unregister(EpochRecord*);
+Result epoch_enter(EpochRecord*);
+Result epoch_exit(EpochRecord*);
+Result epoch_retire(EpochRecord*, Slice ptr, Allocator *owner);
+Result epoch_reclaim(EpochRecord*);
+uint64_t epoch_current(EpochDomain*);
 
 #include "memory/heap.h"
 #include "memory/linear_alloc.h"
+#include "memory/concurrent_linear_alloc.h"
+#include "memory/inline_alloc.h"
+#include "memory/slab_alloc.h"
+#include "memory/magazine_alloc.h"
+#include "memory/pool_alloc.h"
+#include "memory/tlsf_alloc.h"
+#include "memory/buddy_alloc.h"
+#include "memory/arena_alloc.h"
+#include "memory/vm_arena_alloc.h"
+#include "memory/huge_page_alloc.h"
+#include "memory/numa_alloc.h"
+#include "memory/guard_alloc.h"
+#include "memory/stats_alloc.h"
+#include "memory/trace_alloc.h"
+#include "memory/budget_alloc.h"
+#include "memory/combinator_alloc.h"
+#include "memory/epoch.h"
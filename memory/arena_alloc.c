@@ -0,0 +1,546 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1))
+
+local _Thread_local ArenaAllocator *scratch_arenas[SCRATCH_ARENA_COUNT];
+local pthread_key_t scratch_key;
+local pthread_once_t scratch_key_once = PTHREAD_ONCE_INIT;
+
+// Chunks grow geometrically so that a burst needs O(log n) parent calls.
+// They start zeroed, which the parent can often provide for free.
+function ArenaChunk *arena_new_chunk(ArenaAllocator *self, unsigned int size) {
+	Result res;
+	ArenaChunk *chunk;
+	unsigned int capacity;
+
+	capacity = size > self->next_size ? size : self->next_size;
+	if (capacity > UINT32_MAX - sizeof(ArenaChunk)) {
+		return 0;
+	}
+
+	res = ALLOC_ZEROED(self->inside_methods, capacity + sizeof(ArenaChunk));
+	if (res.status != ERROR_OK) {
+		return 0;
+	}
+	if (res.data.length != capacity + sizeof(ArenaChunk)) {
+		FREE(self->inside_methods, res.data);
+		return 0;
+	}
+
+	chunk = (ArenaChunk *) res.data.data;
+	chunk->next = 0;
+	chunk->mem = res.data;
+	chunk->capacity = capacity;
+	chunk->used = 0;
+	chunk->dirty = 0;
+
+	if (self->next_size < ARENA_MAX_CHUNK_SIZE) {
+		self->next_size <<= 1;
+	}
+
+	return chunk;
+}
+
+function void arena_release_chunk(ArenaAllocator *self, ArenaChunk *chunk) {
+	FREE(self->inside_methods, chunk->mem);
+}
+
+// The bump paths only move `used`, so the high-water mark is caught up
+// lazily, before anything lowers or overwrites it.
+function void arena_touch(ArenaChunk *chunk) {
+	if (chunk != 0 && chunk->used > chunk->dirty) {
+		chunk->dirty = chunk->used;
+	}
+}
+
+function int arena_is_last(ArenaAllocator *self, Slice ptr) {
+	ArenaChunk *chunk = self->current;
+
+	return chunk != 0 &&
+		(uint8_t *) ptr.data >= ARENA_CHUNK_DATA(chunk) &&
+		(uint8_t *) ptr.data + ptr.length == ARENA_CHUNK_DATA(chunk) + chunk->used;
+}
+
+// Bytes to skip from `used` so that the next allocation is aligned
+function unsigned int arena_padding(ArenaChunk *chunk, unsigned int used, unsigned int alignment) {
+	uintptr_t address = (uintptr_t)(ARENA_CHUNK_DATA(chunk) + used);
+
+	return (unsigned int)(((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+}
+
+function int arena_fits(ArenaChunk *chunk, unsigned int offset, unsigned int size) {
+	return offset <= chunk->capacity && chunk->capacity - offset >= size;
+}
+
+function Result arena_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	ArenaAllocator *self;
+	ArenaChunk *chunk, *next;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+	if (alignment < ARENA_ALIGN) {
+		alignment = ARENA_ALIGN;
+	}
+	if (size > UINT32_MAX - alignment) {
+		return res;
+	}
+
+	self = (ArenaAllocator *) allocator;
+	chunk = self->current;
+	if (chunk != 0) {
+		offset = chunk->used + arena_padding(chunk, chunk->used, alignment);
+		if (arena_fits(chunk, offset, size)) {
+			chunk->used = offset + size;
+			res.data.data = (void*)(ARENA_CHUNK_DATA(chunk) + offset);
+			res.data.length = size;
+			res.status = ERROR_OK;
+			return res;
+		}
+	}
+
+	// Retained chunks past the current one are reset as they are reached
+	next = chunk != 0 ? chunk->next : self->first;
+	if (next == 0 || !arena_fits(next, arena_padding(next, 0, alignment), size)) {
+		next = arena_new_chunk(self, size + alignment - ARENA_ALIGN);
+		if (next == 0) {
+			return res;
+		}
+		if (chunk != 0) {
+			next->next = chunk->next;
+			chunk->next = next;
+		} else {
+			next->next = self->first;
+			self->first = next;
+		}
+	}
+
+	arena_touch(next);
+	offset = arena_padding(next, 0, alignment);
+	next->used = offset + size;
+	self->current = next;
+
+	res.data.data = (void*)(ARENA_CHUNK_DATA(next) + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result arena_alloc_slow(ArenaAllocator *self, unsigned int size) {
+	return arena_alloc_aligned((Allocator *) self, size, ARENA_ALIGN);
+}
+
+function Result arena_alloc(Allocator *allocator, unsigned int size) {
+	return arena_alloc_inline((ArenaAllocator *) allocator, size);
+}
+
+// Only the part of the allocation below the chunk's high-water mark can
+// hold old data; the rest has never been handed out.
+function Result arena_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	ArenaAllocator *self;
+	ArenaChunk *chunk;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (ArenaAllocator *) allocator;
+	arena_touch(self->current);
+	res = arena_alloc_aligned(allocator, size, ARENA_ALIGN);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	chunk = self->current;
+	offset = (uint8_t *) res.data.data - ARENA_CHUNK_DATA(chunk);
+	if (offset < chunk->dirty) {
+		memset(res.data.data, 0, chunk->dirty - offset < size ? chunk->dirty - offset : size);
+	}
+
+	return res;
+}
+
+// One bump for the batch, laid out as consecutive arena_alloc() calls
+// would place it, so the last item can still be freed or resized.
+function Result arena_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+	Result res;
+	uint64_t total;
+	uint8_t *data;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+		return res;
+	}
+
+	total = 0;
+	for (unsigned int index = 0; index < count; index++) {
+		if (sizes[index] == 0) {
+			return res;
+		}
+		total = ARENA_ROUND(total) + sizes[index];
+	}
+	if (total > UINT32_MAX - ARENA_ALIGN) {
+		return res;
+	}
+
+	res = arena_alloc_aligned(allocator, (unsigned int) total, ARENA_ALIGN);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	data = (uint8_t *) res.data.data;
+	for (unsigned int index = 0; index < count; index++) {
+		out[index].data = (void*) data;
+		out[index].length = sizes[index];
+		data += ARENA_ROUND(sizes[index]);
+	}
+
+	res.data.data = out;
+	res.data.length = count * sizeof(Slice);
+	return res;
+}
+
+// Only the most recent allocation can be given back; anything else waits
+// for FREEALL.
+function Result arena_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	ArenaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (ArenaAllocator *) allocator;
+	if (arena_is_last(self, ptr)) {
+		arena_touch(self->current);
+		self->current->used = (uint8_t *) ptr.data - ARENA_CHUNK_DATA(self->current);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// The last allocation can move its end freely; any other one can only shrink
+function Result arena_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	ArenaAllocator *self;
+	ArenaChunk *chunk;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (ArenaAllocator *) allocator;
+	chunk = self->current;
+	if (arena_is_last(self, ptr)) {
+		offset = (uint8_t *) ptr.data - ARENA_CHUNK_DATA(chunk);
+		if (chunk->capacity - offset < size) {
+			return res;
+		}
+		arena_touch(chunk);
+		chunk->used = offset + size;
+	} else if (size > ptr.length) {
+		return res;
+	}
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result arena_freeall(Allocator *allocator) {
+	Result res;
+	ArenaAllocator *self;
+	ArenaChunk *chunk, *next, *keep;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (ArenaAllocator *) allocator;
+	keep = 0;
+	switch (self->retention) {
+	case ARENA_RETAIN_ALL:
+		self->current = 0;
+		res.status = ERROR_OK;
+		return res;
+	case ARENA_RETAIN_LARGEST:
+		keep = self->first;
+		for (chunk = self->first; chunk != 0; chunk = chunk->next) {
+			if (chunk->capacity > keep->capacity) {
+				keep = chunk;
+			}
+		}
+		break;
+	case ARENA_RETAIN_FIRST:
+		keep = self->first;
+		break;
+	case ARENA_RETAIN_NONE:
+		self->next_size = self->initial_size;
+		break;
+	}
+
+	for (chunk = self->first; chunk != 0; chunk = next) {
+		next = chunk->next;
+		if (chunk != keep) {
+			arena_release_chunk(self, chunk);
+		}
+	}
+	if (keep != 0) {
+		keep->next = 0;
+	}
+	self->first = keep;
+	self->current = 0;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Spare chunks are the ones a retention policy kept for reuse: everything
+// past the current chunk, or every chunk right after FREEALL.
+Result arena_trim(ArenaAllocator *self) {
+	Result res;
+	ArenaChunk *chunk, *next;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	if (self->current != 0) {
+		chunk = self->current->next;
+		self->current->next = 0;
+	} else {
+		chunk = self->first;
+		self->first = 0;
+	}
+	for (; chunk != 0; chunk = next) {
+		next = chunk->next;
+		arena_release_chunk(self, chunk);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result arena_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	ArenaChunk *chunk;
+	Slice data;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	for (chunk = ((ArenaAllocator *) allocator)->first; chunk != 0; chunk = chunk->next) {
+		data.data = ARENA_CHUNK_DATA(chunk);
+		data.length = chunk->capacity;
+		if (SLICE_WITHIN(data, ptr)) {
+			res.status = ERROR_OK;
+			res.data = ptr;
+			return res;
+		}
+	}
+	return res;
+}
+
+ArenaMark arena_mark(ArenaAllocator *self) {
+	ArenaMark mark = { 0, 0 };
+
+	if (self == 0 || self->current == 0) {
+		return mark;
+	}
+
+	mark.chunk = self->current;
+	mark.used = self->current->used;
+	return mark;
+}
+
+// Chunks past the marked one keep stale offsets until arena_alloc() reaches
+// and resets them, which keeps the rewind itself O(1).
+Result arena_rewind(ArenaAllocator *self, ArenaMark mark) {
+	Result res;
+	ArenaChunk *chunk;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	chunk = (ArenaChunk *) mark.chunk;
+	if (chunk != 0 && mark.used > chunk->capacity) {
+		return res;
+	}
+
+	self->current = chunk;
+	if (chunk != 0) {
+		arena_touch(chunk);
+		chunk->used = mark.used;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result new_arena_allocator(Allocator *allocator, unsigned int initial_size, enum arena_retention retention) {
+	Result res;
+	ArenaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || initial_size == 0 || initial_size > ARENA_MAX_CHUNK_SIZE) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(ArenaAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(ArenaAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (ArenaAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->initial_size = initial_size;
+	self->next_size = initial_size;
+	self->retention = retention;
+	self->current = 0;
+
+	self->first = arena_new_chunk(self, initial_size);
+	if (self->first == 0) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self->outside_methods.alloc = arena_alloc;
+	self->outside_methods.alloc_aligned = arena_alloc_aligned;
+	self->outside_methods.alloc_zeroed = arena_alloc_zeroed;
+	self->outside_methods.alloc_batch = arena_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = arena_resize;
+	self->outside_methods.free = arena_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = arena_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = arena_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(ArenaAllocator);
+	return res;
+}
+
+Result deinit_arena_allocator(ArenaAllocator *self) {
+	Result res;
+	ArenaChunk *chunk, *next;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	for (chunk = self->first; chunk != 0; chunk = next) {
+		next = chunk->next;
+		arena_release_chunk(self, chunk);
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(ArenaAllocator);
+	return FREE(self->inside_methods, res.data);
+}
+
+function void scratch_destroy(void *data) {
+	ArenaAllocator **arenas = (ArenaAllocator **) data;
+
+	for (unsigned int index = 0; index < SCRATCH_ARENA_COUNT; index++) {
+		if (arenas[index] != 0) {
+			deinit_arena_allocator(arenas[index]);
+			arenas[index] = 0;
+		}
+	}
+}
+
+function void scratch_create_key(void) {
+	pthread_key_create(&scratch_key, scratch_destroy);
+}
+
+Result scratch_begin(Scratch *scratch, Allocator *conflict) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (scratch == 0) {
+		return res;
+	}
+
+	for (unsigned int index = 0; index < SCRATCH_ARENA_COUNT; index++) {
+		if ((Allocator *) scratch_arenas[index] == conflict && conflict != 0) {
+			continue;
+		}
+
+		if (scratch_arenas[index] == 0) {
+			res = new_arena_allocator(get_raw_heap_allocator(), SCRATCH_INITIAL_SIZE, ARENA_RETAIN_ALL);
+			if (res.status != ERROR_OK) {
+				return res;
+			}
+			scratch_arenas[index] = (ArenaAllocator *) res.data.data;
+
+			// Registers the thread's arenas for release at thread exit
+			pthread_once(&scratch_key_once, scratch_create_key);
+			pthread_setspecific(scratch_key, scratch_arenas);
+		}
+
+		scratch->arena = scratch_arenas[index];
+		scratch->mark = arena_mark(scratch->arena);
+
+		res.status = ERROR_OK;
+		res.data.data = scratch->arena;
+		res.data.length = sizeof(ArenaAllocator);
+		return res;
+	}
+
+	return res;
+}
+
+Result scratch_end(Scratch *scratch) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (scratch == 0 || scratch->arena == 0) {
+		return res;
+	}
+
+	res = arena_rewind(scratch->arena, scratch->mark);
+	scratch->arena = 0;
+	return res;
+}
+
+Result release_scratch_arenas(void) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	scratch_destroy(scratch_arenas);
+
+	res.status = ERROR_OK;
+	return res;
+}
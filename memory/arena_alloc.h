@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define ARENA_ALIGN 8
+#define ARENA_MAX_CHUNK_SIZE (1u << 30)
+
+#define SCRATCH_ARENA_COUNT 2
+#define SCRATCH_INITIAL_SIZE (64 * 1024)
+
+typedef struct arena_chunk_s ArenaChunk;
+struct arena_chunk_s {
+	ArenaChunk *next;
+	Slice mem;
+	unsigned int capacity;
+	unsigned int used;
+	// Everything past max(used, dirty) is still zero from the parent
+	unsigned int dirty;
+};
+
+#define ARENA_CHUNK_DATA(chunk) ((uint8_t *)&(chunk)[1])
+
+struct arena_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	ArenaChunk *first;
+	ArenaChunk *current;
+	unsigned int initial_size;
+	unsigned int next_size;
+	enum arena_retention retention;
+};
+
+Result arena_alloc_slow(ArenaAllocator*, unsigned int size);
+
+// Bumps the current chunk without going through the vtable; anything that
+// needs a new chunk takes the out-of-line path.
+static inline Result arena_alloc_inline(ArenaAllocator *self, unsigned int size) {
+	Result res;
+	ArenaChunk *chunk;
+	uintptr_t address;
+	unsigned int offset;
+
+	chunk = self != 0 ? self->current : 0;
+	if (chunk != 0 && size != 0) {
+		address = (uintptr_t)(ARENA_CHUNK_DATA(chunk) + chunk->used);
+		offset = chunk->used + (unsigned int)(-address & (ARENA_ALIGN - 1));
+		if (offset <= chunk->capacity && chunk->capacity - offset >= size) {
+			chunk->used = offset + size;
+			res.status = ERROR_OK;
+			res.data.data = (void*)(ARENA_CHUNK_DATA(chunk) + offset);
+			res.data.length = size;
+			return res;
+		}
+	}
+
+	return arena_alloc_slow(self, size);
+}
@@ -0,0 +1,439 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+
+#define BUDDY_ALIGN 16
+
+function unsigned int buddy_order(unsigned int length) {
+	if (length <= (1u << BUDDY_MIN_ORDER)) {
+		return BUDDY_MIN_ORDER;
+	}
+	return 32 - __builtin_clz(length - 1);
+}
+
+function unsigned int buddy_map_bit(BuddyAllocator *self, unsigned int order, unsigned int offset) {
+	return self->map_offsets[order] + (offset >> order);
+}
+
+function int buddy_is_free(BuddyAllocator *self, unsigned int order, unsigned int offset) {
+	unsigned int bit = buddy_map_bit(self, order, offset);
+	return (((uint8_t *) self->free_map.data)[bit >> 3] >> (bit & 7)) & 1;
+}
+
+function void buddy_push(BuddyAllocator *self, unsigned int order, unsigned int offset) {
+	BuddyBlock *block;
+	unsigned int bit;
+
+	block = (BuddyBlock *)((uint8_t *) self->memory.data + offset);
+	block->previous = 0;
+	block->next = self->free_lists[order];
+	if (block->next != 0) {
+		block->next->previous = block;
+	}
+	self->free_lists[order] = block;
+	self->free_counts[order]++;
+
+	bit = buddy_map_bit(self, order, offset);
+	((uint8_t *) self->free_map.data)[bit >> 3] |= 1 << (bit & 7);
+}
+
+function void buddy_remove(BuddyAllocator *self, unsigned int order, unsigned int offset) {
+	BuddyBlock *block;
+	unsigned int bit;
+
+	block = (BuddyBlock *)((uint8_t *) self->memory.data + offset);
+	if (block->previous != 0) {
+		block->previous->next = block->next;
+	} else {
+		self->free_lists[order] = block->next;
+	}
+	if (block->next != 0) {
+		block->next->previous = block->previous;
+	}
+	self->free_counts[order]--;
+
+	bit = buddy_map_bit(self, order, offset);
+	((uint8_t *) self->free_map.data)[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+function void buddy_reset(BuddyAllocator *self) {
+	memset(self->free_map.data, 0, self->free_map.length);
+	for (unsigned int order = 0; order < BUDDY_ORDER_COUNT; order++) {
+		self->free_lists[order] = 0;
+		self->free_counts[order] = 0;
+	}
+	self->bytes_requested = 0;
+	self->bytes_reserved = 0;
+
+	buddy_push(self, self->max_order, 0);
+}
+
+// Validates that ptr is a live block of the order its length implies and
+// returns its offset, or -1 for foreign, misaligned, or already free blocks.
+function long buddy_offset(BuddyAllocator *self, Slice ptr) {
+	unsigned int order, offset;
+
+	if ((uint8_t *) ptr.data < (uint8_t *) self->memory.data) {
+		return -1;
+	}
+	order = buddy_order(ptr.length);
+	if (order > self->max_order) {
+		return -1;
+	}
+
+	offset = (uint8_t *) ptr.data - (uint8_t *) self->memory.data;
+	if (offset >= self->memory.length || (offset & ((1u << order) - 1)) != 0) {
+		return -1;
+	}
+
+	for (unsigned int parent = order; parent <= self->max_order; parent++) {
+		if (buddy_is_free(self, parent, offset & ~((1u << parent) - 1))) {
+			return -1;
+		}
+	}
+
+	return offset;
+}
+
+// Blocks sit at multiples of their own size from the base. Taking a block
+// of at least `min_order` and keeping its lower part down to the order of
+// `size` gives a block aligned to 2^min_order relative to the base.
+function Result buddy_take(BuddyAllocator *self, unsigned int size, unsigned int min_order) {
+	Result res;
+	unsigned int order, current, offset;
+	BASE_ERROR_RESULT(res);
+
+	order = buddy_order(size);
+	if (order > self->max_order) {
+		return res;
+	}
+
+	current = order > min_order ? order : min_order;
+	while (current <= self->max_order && self->free_lists[current] == 0) {
+		current++;
+	}
+	if (current > self->max_order) {
+		return res;
+	}
+
+	offset = (uint8_t *) self->free_lists[current] - (uint8_t *) self->memory.data;
+	buddy_remove(self, current, offset);
+	while (current > order) {
+		current--;
+		buddy_push(self, current, offset + (1u << current));
+	}
+
+	self->bytes_requested += size;
+	self->bytes_reserved += 1u << order;
+
+	res.data.data = (void*)((uint8_t *) self->memory.data + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result buddy_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	return buddy_take((BuddyAllocator *) allocator, size, 0);
+}
+
+// Fails at once when the base is less aligned than asked, rather than
+// depending on where a block happens to land
+function Result buddy_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	BuddyAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	if (((uintptr_t) self->memory.data & (alignment - 1)) != 0) {
+		return res;
+	}
+
+	return buddy_take(self, size, __builtin_ctz(alignment));
+}
+
+function Result buddy_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	BuddyAllocator *self;
+	unsigned int order, offset, buddy;
+	long checked;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	checked = buddy_offset(self, ptr);
+	if (checked < 0) {
+		return res;
+	}
+	offset = (unsigned int) checked;
+	order = buddy_order(ptr.length);
+
+	self->bytes_requested -= ptr.length;
+	self->bytes_reserved -= 1u << order;
+
+	while (order < self->max_order) {
+		buddy = offset ^ (1u << order);
+		if (!buddy_is_free(self, order, buddy)) {
+			break;
+		}
+		buddy_remove(self, order, buddy);
+		offset &= ~(1u << order);
+		order++;
+	}
+	buddy_push(self, order, offset);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Grows in place by absorbing the free buddies above the block, and shrinks
+// in place by releasing its upper halves.
+function Result buddy_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BuddyAllocator *self;
+	unsigned int order, new_order, offset;
+	long checked;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	checked = buddy_offset(self, ptr);
+	if (checked < 0) {
+		return res;
+	}
+	offset = (unsigned int) checked;
+	order = buddy_order(ptr.length);
+	new_order = buddy_order(size);
+
+	if (new_order > self->max_order) {
+		return res;
+	}
+
+	if (new_order > order) {
+		if ((offset & ((1u << new_order) - 1)) != 0) {
+			return res;
+		}
+		for (unsigned int current = order; current < new_order; current++) {
+			if (!buddy_is_free(self, current, offset + (1u << current))) {
+				return res;
+			}
+		}
+		for (unsigned int current = order; current < new_order; current++) {
+			buddy_remove(self, current, offset + (1u << current));
+		}
+	} else {
+		for (unsigned int current = order; current > new_order; current--) {
+			buddy_push(self, current - 1, offset + (1u << (current - 1)));
+		}
+	}
+
+	self->bytes_requested += size - ptr.length;
+	self->bytes_reserved += (1u << new_order) - (1u << order);
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result buddy_freeall(Allocator *allocator) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	buddy_reset((BuddyAllocator *) allocator);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result buddy_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	BuddyAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	if (SLICE_WITHIN(self->memory, ptr)) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result buddy_allocator_stats(Allocator *allocator, FragmentationStats *stats) {
+	Result res;
+	BuddyAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || stats == 0) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	stats->capacity = self->memory.length;
+	stats->bytes_requested = self->bytes_requested;
+	stats->bytes_reserved = self->bytes_reserved;
+	stats->bytes_free = self->memory.length - self->bytes_reserved;
+	stats->free_blocks = 0;
+	stats->largest_free_block = 0;
+	for (unsigned int order = BUDDY_MIN_ORDER; order <= self->max_order; order++) {
+		stats->free_blocks += self->free_counts[order];
+		if (self->free_counts[order] > 0) {
+			stats->largest_free_block = 1u << order;
+		}
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = stats;
+	res.data.length = sizeof(FragmentationStats);
+	return res;
+}
+
+Result init_buddy_allocator(Allocator *allocator, unsigned int max_size) {
+	Result res;
+	BuddyAllocator *self;
+	unsigned int map_bits, length;
+	uintptr_t start;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || max_size == 0 || buddy_order(max_size) > BUDDY_MAX_ORDER) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(BuddyAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(BuddyAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (BuddyAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->max_order = buddy_order(max_size);
+
+	map_bits = 0;
+	for (unsigned int order = 0; order < BUDDY_ORDER_COUNT; order++) {
+		self->map_offsets[order] = map_bits;
+		if (order >= BUDDY_MIN_ORDER && order <= self->max_order) {
+			map_bits += 1u << (self->max_order - order);
+		}
+	}
+
+	res = ALLOC(allocator, (map_bits + 7) >> 3);
+	if (res.status != ERROR_OK) {
+		res.data.data = self;
+		res.data.length = sizeof(BuddyAllocator);
+		FREE(allocator, res.data);
+		return res;
+	}
+	if (res.data.length != (map_bits + 7) >> 3) {
+		FREE(allocator, res.data);
+		res.data.data = self;
+		res.data.length = sizeof(BuddyAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->free_map = res.data;
+
+	// A base aligned to the whole buffer lets ALLOC_ALIGNED place any block;
+	// a parent that cannot align it gets the old 16 byte slack instead
+	length = 1u << self->max_order;
+	res = ALLOC_ALIGNED(allocator, length, length);
+	if (res.status != ERROR_OK) {
+		length += BUDDY_ALIGN;
+		res = ALLOC(allocator, length);
+	}
+	if (res.status != ERROR_OK) {
+		FREE(allocator, self->free_map);
+		res.data.data = self;
+		res.data.length = sizeof(BuddyAllocator);
+		FREE(allocator, res.data);
+		return res;
+	}
+	if (res.data.length != length) {
+		FREE(allocator, res.data);
+		FREE(allocator, self->free_map);
+		res.data.data = self;
+		res.data.length = sizeof(BuddyAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->buffer = res.data;
+
+	start = ((uintptr_t) self->buffer.data + BUDDY_ALIGN - 1) & ~(uintptr_t)(BUDDY_ALIGN - 1);
+	self->memory.data = (void*) start;
+	self->memory.length = 1u << self->max_order;
+	buddy_reset(self);
+
+	self->outside_methods.alloc = buddy_alloc;
+	self->outside_methods.alloc_aligned = buddy_alloc_aligned;
+	self->outside_methods.alloc_zeroed = standard_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = buddy_resize;
+	self->outside_methods.free = buddy_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = buddy_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = buddy_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(BuddyAllocator);
+	return res;
+}
+
+Result deinit_buddy_allocator(Allocator *allocator) {
+	Result res;
+	BuddyAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (BuddyAllocator *) allocator;
+	res = FREE(self->inside_methods, self->buffer);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	res = FREE(self->inside_methods, self->free_map);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(BuddyAllocator);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Blocks are 2^order bytes; the smallest one must hold the free list links
+#define BUDDY_MIN_ORDER 4
+#define BUDDY_MAX_ORDER 31
+#define BUDDY_ORDER_COUNT (BUDDY_MAX_ORDER + 1)
+
+typedef struct buddy_block_s BuddyBlock;
+struct buddy_block_s {
+	BuddyBlock *next;
+	BuddyBlock *previous;
+};
+
+// A set bit in the map of an order marks a free block of exactly that order
+// starting at offset (index << order), which is what makes merging O(1).
+struct buddy_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Slice buffer;
+	Slice memory;
+	Slice free_map;
+	unsigned int max_order;
+	unsigned int map_offsets[BUDDY_ORDER_COUNT];
+	unsigned int free_counts[BUDDY_ORDER_COUNT];
+	BuddyBlock *free_lists[BUDDY_ORDER_COUNT];
+	unsigned int bytes_requested;
+	unsigned int bytes_reserved;
+};
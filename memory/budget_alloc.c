@@ -0,0 +1,373 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+
+#define BUDGET_ADD(counter, value) atomic_fetch_add_explicit(&(counter), value, memory_order_relaxed)
+#define BUDGET_SUB(counter, value) atomic_fetch_sub_explicit(&(counter), value, memory_order_relaxed)
+#define BUDGET_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define BUDGET_STORE(counter, value) atomic_store_explicit(&(counter), value, memory_order_relaxed)
+
+function void budget_record_peak(BudgetAllocator *self, size_t used) {
+	size_t peak = BUDGET_LOAD(self->peak);
+
+	while (used > peak && !atomic_compare_exchange_weak_explicit(
+		&self->peak, &peak, used, memory_order_relaxed, memory_order_relaxed
+	)) {
+	}
+}
+
+// Runs the callbacks unless another call is already running them, which
+// includes an allocation made by one of the callbacks
+function void budget_relieve(BudgetAllocator *self, enum budget_level level, size_t excess) {
+	BudgetCallback callbacks[BUDGET_MAX_CALLBACKS];
+	unsigned int count;
+	int idle = 0;
+
+	if (!atomic_compare_exchange_strong_explicit(
+		&self->relieving, &idle, 1, memory_order_acquire, memory_order_relaxed
+	)) {
+		return;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	count = self->callback_count;
+	memcpy(callbacks, self->callbacks, count * sizeof(BudgetCallback));
+	pthread_mutex_unlock(&self->lock);
+
+	BUDGET_ADD(self->pressure_events, 1);
+	for (unsigned int index = 0; index < count; index++) {
+		callbacks[index].callback(self, level, excess, callbacks[index].context);
+	}
+
+	atomic_store_explicit(&self->relieving, 0, memory_order_release);
+}
+
+// Claims bytes if they fit under the hard limit, reporting the usage before
+function int budget_reserve(BudgetAllocator *self, size_t bytes, size_t *before) {
+	size_t hard = BUDGET_LOAD(self->hard_limit);
+	size_t used = BUDGET_LOAD(self->used);
+
+	do {
+		if (bytes > hard || used > hard - bytes) {
+			*before = used;
+			return 0;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(
+		&self->used, &used, used + bytes, memory_order_relaxed, memory_order_relaxed
+	));
+
+	*before = used;
+	budget_record_peak(self, used + bytes);
+	return 1;
+}
+
+function int budget_charge(BudgetAllocator *self, size_t bytes) {
+	size_t before, soft, hard;
+
+	if (!budget_reserve(self, bytes, &before)) {
+		hard = BUDGET_LOAD(self->hard_limit);
+		budget_relieve(self, BUDGET_HARD, before + bytes > hard ? before + bytes - hard : 0);
+		if (!budget_reserve(self, bytes, &before)) {
+			BUDGET_ADD(self->failures, 1);
+			return 0;
+		}
+	}
+
+	soft = BUDGET_LOAD(self->soft_limit);
+	if (before <= soft && before + bytes > soft) {
+		budget_relieve(self, BUDGET_SOFT, before + bytes - soft);
+	}
+	return 1;
+}
+
+// Corrects a charge once the parent says how many bytes it really handed out
+function void budget_settle(BudgetAllocator *self, size_t charged, size_t actual) {
+	if (actual > charged) {
+		budget_record_peak(self, BUDGET_ADD(self->used, actual - charged) + (actual - charged));
+	} else if (actual < charged) {
+		BUDGET_SUB(self->used, charged - actual);
+	}
+}
+
+function Result budget_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	if (!budget_charge(self, size)) {
+		return res;
+	}
+
+	res = ALLOC(self->inside_methods, size);
+	budget_settle(self, size, res.status == ERROR_OK ? res.data.length : 0);
+	return res;
+}
+
+function Result budget_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	if (!budget_charge(self, size)) {
+		return res;
+	}
+
+	res = ALLOC_ALIGNED(self->inside_methods, size, alignment);
+	budget_settle(self, size, res.status == ERROR_OK ? res.data.length : 0);
+	return res;
+}
+
+function Result budget_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	if (!budget_charge(self, size)) {
+		return res;
+	}
+
+	res = ALLOC_ZEROED(self->inside_methods, size);
+	budget_settle(self, size, res.status == ERROR_OK ? res.data.length : 0);
+	return res;
+}
+
+// Growth is charged up front; shrinking is only credited once it happened
+function Result budget_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BudgetAllocator *self;
+	size_t charged = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	if (size > ptr.length) {
+		charged = size - ptr.length;
+		if (!budget_charge(self, charged)) {
+			return res;
+		}
+	}
+
+	res = REALLOC(self->inside_methods, ptr, size);
+	if (res.status != ERROR_OK) {
+		budget_settle(self, charged, 0);
+	} else if (res.data.length >= ptr.length) {
+		budget_settle(self, charged, res.data.length - ptr.length);
+	} else {
+		budget_settle(self, charged + (ptr.length - res.data.length), 0);
+	}
+	return res;
+}
+
+function Result budget_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BudgetAllocator *self;
+	size_t charged = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	if (size > ptr.length) {
+		charged = size - ptr.length;
+		if (!budget_charge(self, charged)) {
+			return res;
+		}
+	}
+
+	res = RESIZE(self->inside_methods, ptr, size);
+	if (res.status != ERROR_OK) {
+		budget_settle(self, charged, 0);
+	} else if (res.data.length >= ptr.length) {
+		budget_settle(self, charged, res.data.length - ptr.length);
+	} else {
+		budget_settle(self, charged + (ptr.length - res.data.length), 0);
+	}
+	return res;
+}
+
+function Result budget_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	res = FREE(self->inside_methods, ptr);
+	if (res.status == ERROR_OK) {
+		BUDGET_SUB(self->used, ptr.length);
+	}
+	return res;
+}
+
+// Holds no blocks of its own; charges stay until their blocks are freed
+function Result budget_freeall(Allocator *allocator) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result budget_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (BudgetAllocator *) allocator;
+	return OWNS(self->inside_methods, ptr);
+}
+
+Result budget_allocator_on_pressure(BudgetAllocator *self, BudgetPressure callback, void *context) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || callback == 0) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	if (self->callback_count < BUDGET_MAX_CALLBACKS) {
+		self->callbacks[self->callback_count].callback = callback;
+		self->callbacks[self->callback_count].context = context;
+		self->callback_count++;
+		res.status = ERROR_OK;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+Result budget_allocator_set_limits(BudgetAllocator *self, size_t soft_limit, size_t hard_limit) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || hard_limit == 0 || soft_limit > hard_limit) {
+		return res;
+	}
+
+	BUDGET_STORE(self->soft_limit, soft_limit);
+	BUDGET_STORE(self->hard_limit, hard_limit);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Like the stats allocator's snapshot, each field is exact on its own but
+// they are not read at a single point in time
+Result budget_allocator_usage(BudgetAllocator *self, BudgetUsage *usage) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || usage == 0) {
+		return res;
+	}
+
+	usage->used = BUDGET_LOAD(self->used);
+	usage->peak = BUDGET_LOAD(self->peak);
+	usage->soft_limit = BUDGET_LOAD(self->soft_limit);
+	usage->hard_limit = BUDGET_LOAD(self->hard_limit);
+	usage->pressure_events = BUDGET_LOAD(self->pressure_events);
+	usage->failures = BUDGET_LOAD(self->failures);
+
+	res.status = ERROR_OK;
+	res.data.data = usage;
+	res.data.length = sizeof(BudgetUsage);
+	return res;
+}
+
+Result new_budget_allocator(Allocator *allocator, size_t soft_limit, size_t hard_limit) {
+	Result res;
+	BudgetAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || hard_limit == 0 || soft_limit > hard_limit) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(BudgetAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(BudgetAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (BudgetAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	atomic_init(&self->soft_limit, soft_limit);
+	atomic_init(&self->hard_limit, hard_limit);
+	atomic_init(&self->used, 0);
+	atomic_init(&self->peak, 0);
+	atomic_init(&self->pressure_events, 0);
+	atomic_init(&self->failures, 0);
+	atomic_init(&self->relieving, 0);
+	pthread_mutex_init(&self->lock, 0);
+	self->callback_count = 0;
+
+	self->outside_methods.alloc = budget_alloc;
+	self->outside_methods.alloc_aligned = budget_alloc_aligned;
+	self->outside_methods.alloc_zeroed = budget_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = budget_realloc;
+	self->outside_methods.resize = budget_resize;
+	self->outside_methods.free = budget_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = budget_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = budget_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(BudgetAllocator);
+	return res;
+}
+
+Result deinit_budget_allocator(BudgetAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	pthread_mutex_destroy(&self->lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(BudgetAllocator);
+	return FREE(self->inside_methods, res.data);
+}
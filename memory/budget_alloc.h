@@ -0,0 +1,32 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define BUDGET_MAX_CALLBACKS 8
+
+typedef struct {
+	BudgetPressure callback;
+	void *context;
+} BudgetCallback;
+
+// `used` counts the bytes callers hold, charged before the parent is asked
+// so concurrent allocations can never overshoot the hard limit together.
+// Only one thread runs the callbacks at a time; `relieving` marks it.
+struct budget_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	_Atomic size_t soft_limit;
+	_Atomic size_t hard_limit;
+	_Atomic size_t used;
+	_Atomic size_t peak;
+	_Atomic uint64_t pressure_events;
+	_Atomic uint64_t failures;
+	_Atomic int relieving;
+	pthread_mutex_t lock;
+	unsigned int callback_count;
+	BudgetCallback callbacks[BUDGET_MAX_CALLBACKS];
+};
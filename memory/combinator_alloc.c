@@ -0,0 +1,609 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+// None of the combinators own their children: deinit only releases the
+// combinator itself, and FREEALL is passed down to every child.
+
+function Result combinator_owned(Slice ptr) {
+	Result res;
+
+	res.status = ERROR_OK;
+	res.data = ptr;
+	return res;
+}
+
+function Allocator *segregator_route(SegregatorAllocator *self, unsigned int size) {
+	return size <= self->threshold ? self->small : self->large;
+}
+
+function Result segregator_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	return ALLOC(segregator_route((SegregatorAllocator *) allocator, size), size);
+}
+
+function Result segregator_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	return ALLOC_ALIGNED(segregator_route((SegregatorAllocator *) allocator, size), size, alignment);
+}
+
+function Result segregator_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	return ALLOC_ZEROED(segregator_route((SegregatorAllocator *) allocator, size), size);
+}
+
+function Result segregator_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	return FREE(segregator_route((SegregatorAllocator *) allocator, ptr.length), ptr);
+}
+
+function Result segregator_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	SegregatorAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SegregatorAllocator *) allocator;
+	if (segregator_route(self, ptr.length) != segregator_route(self, size)) {
+		return res;
+	}
+
+	return RESIZE(segregator_route(self, size), ptr, size);
+}
+
+// Crossing the threshold moves the data to the other child
+function Result segregator_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	SegregatorAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SegregatorAllocator *) allocator;
+	if (segregator_route(self, ptr.length) == segregator_route(self, size)) {
+		return REALLOC(segregator_route(self, size), ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+function Result segregator_freeall(Allocator *allocator) {
+	Result res, large_res;
+	SegregatorAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (SegregatorAllocator *) allocator;
+	res = FREEALL(self->small);
+	large_res = FREEALL(self->large);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	return large_res;
+}
+
+function Result segregator_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	SegregatorAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (SegregatorAllocator *) allocator;
+	if (OWNS(self->small, ptr).status == ERROR_OK || OWNS(self->large, ptr).status == ERROR_OK) {
+		return combinator_owned(ptr);
+	}
+
+	return res;
+}
+
+Result new_segregator_allocator(Allocator *allocator, unsigned int threshold, Allocator *small, Allocator *large) {
+	Result res;
+	SegregatorAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || small == 0 || large == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(SegregatorAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(SegregatorAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (SegregatorAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->small = small;
+	self->large = large;
+	self->threshold = threshold;
+
+	self->outside_methods.alloc = segregator_alloc;
+	self->outside_methods.alloc_aligned = segregator_alloc_aligned;
+	self->outside_methods.alloc_zeroed = segregator_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = segregator_realloc;
+	self->outside_methods.resize = segregator_resize;
+	self->outside_methods.free = segregator_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = segregator_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = segregator_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(SegregatorAllocator);
+	return res;
+}
+
+Result deinit_segregator_allocator(SegregatorAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(SegregatorAllocator);
+	return FREE(self->inside_methods, res.data);
+}
+
+// Anything the primary does not claim is assumed to be the secondary's
+function Allocator *fallback_owner(FallbackAllocator *self, Slice ptr) {
+	return OWNS(self->primary, ptr).status == ERROR_OK ? self->primary : self->secondary;
+}
+
+function Result fallback_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	res = ALLOC(self->primary, size);
+	if (res.status == ERROR_OK) {
+		return res;
+	}
+
+	return ALLOC(self->secondary, size);
+}
+
+function Result fallback_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	res = ALLOC_ALIGNED(self->primary, size, alignment);
+	if (res.status == ERROR_OK) {
+		return res;
+	}
+
+	return ALLOC_ALIGNED(self->secondary, size, alignment);
+}
+
+function Result fallback_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	res = ALLOC_ZEROED(self->primary, size);
+	if (res.status == ERROR_OK) {
+		return res;
+	}
+
+	return ALLOC_ZEROED(self->secondary, size);
+}
+
+function Result fallback_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	return FREE(fallback_owner((FallbackAllocator *) allocator, ptr), ptr);
+}
+
+function Result fallback_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	return RESIZE(fallback_owner((FallbackAllocator *) allocator, ptr), ptr, size);
+}
+
+// Memory that outgrows the primary moves to the secondary, never back
+function Result fallback_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	if (fallback_owner(self, ptr) == self->secondary) {
+		return REALLOC(self->secondary, ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+function Result fallback_freeall(Allocator *allocator) {
+	Result res, secondary_res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	res = FREEALL(self->primary);
+	secondary_res = FREEALL(self->secondary);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	return secondary_res;
+}
+
+function Result fallback_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (FallbackAllocator *) allocator;
+	if (OWNS(self->primary, ptr).status == ERROR_OK || OWNS(self->secondary, ptr).status == ERROR_OK) {
+		return combinator_owned(ptr);
+	}
+
+	return res;
+}
+
+Result new_fallback_allocator(Allocator *allocator, Allocator *primary, Allocator *secondary) {
+	Result res;
+	FallbackAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || primary == 0 || secondary == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(FallbackAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(FallbackAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (FallbackAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->primary = primary;
+	self->secondary = secondary;
+
+	self->outside_methods.alloc = fallback_alloc;
+	self->outside_methods.alloc_aligned = fallback_alloc_aligned;
+	self->outside_methods.alloc_zeroed = fallback_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = fallback_realloc;
+	self->outside_methods.resize = fallback_resize;
+	self->outside_methods.free = fallback_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = fallback_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = fallback_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(FallbackAllocator);
+	return res;
+}
+
+Result deinit_fallback_allocator(FallbackAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(FallbackAllocator);
+	return FREE(self->inside_methods, res.data);
+}
+
+// Returns 0 for sizes outside the buckets' range
+function Allocator *bucketizer_route(BucketizerAllocator *self, unsigned int size) {
+	unsigned int index;
+
+	if (size < self->min) {
+		return 0;
+	}
+
+	index = (size - self->min) / self->step;
+	return index < self->count ? self->buckets[index] : 0;
+}
+
+function Result bucketizer_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	bucket = bucketizer_route((BucketizerAllocator *) allocator, size);
+	if (bucket == 0) {
+		return res;
+	}
+
+	return ALLOC(bucket, size);
+}
+
+function Result bucketizer_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	bucket = bucketizer_route((BucketizerAllocator *) allocator, size);
+	if (bucket == 0) {
+		return res;
+	}
+
+	return ALLOC_ALIGNED(bucket, size, alignment);
+}
+
+function Result bucketizer_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	bucket = bucketizer_route((BucketizerAllocator *) allocator, size);
+	if (bucket == 0) {
+		return res;
+	}
+
+	return ALLOC_ZEROED(bucket, size);
+}
+
+function Result bucketizer_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	bucket = bucketizer_route((BucketizerAllocator *) allocator, ptr.length);
+	if (bucket == 0) {
+		return res;
+	}
+
+	return FREE(bucket, ptr);
+}
+
+function Result bucketizer_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BucketizerAllocator *self;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BucketizerAllocator *) allocator;
+	bucket = bucketizer_route(self, ptr.length);
+	if (bucket == 0 || bucket != bucketizer_route(self, size)) {
+		return res;
+	}
+
+	return RESIZE(bucket, ptr, size);
+}
+
+function Result bucketizer_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BucketizerAllocator *self;
+	Allocator *bucket;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (BucketizerAllocator *) allocator;
+	bucket = bucketizer_route(self, ptr.length);
+	if (bucket != 0 && bucket == bucketizer_route(self, size)) {
+		return REALLOC(bucket, ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+function Result bucketizer_freeall(Allocator *allocator) {
+	Result res;
+	BucketizerAllocator *self;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (BucketizerAllocator *) allocator;
+	for (unsigned int index = 0; index < self->count; index++) {
+		if (FREEALL(self->buckets[index]).status != ERROR_OK) {
+			failed = 1;
+		}
+	}
+
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
+
+function Result bucketizer_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	BucketizerAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (BucketizerAllocator *) allocator;
+	for (unsigned int index = 0; index < self->count; index++) {
+		if (OWNS(self->buckets[index], ptr).status == ERROR_OK) {
+			return combinator_owned(ptr);
+		}
+	}
+
+	return res;
+}
+
+Result new_bucketizer_allocator(Allocator *allocator, Allocator **buckets, unsigned int count, unsigned int min, unsigned int step) {
+	Result res;
+	BucketizerAllocator *self;
+	unsigned int length;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || buckets == 0 || count == 0 || step == 0) {
+		return res;
+	}
+	if (count > (UINT32_MAX - sizeof(BucketizerAllocator)) / sizeof(Allocator *)) {
+		return res;
+	}
+	for (unsigned int index = 0; index < count; index++) {
+		if (buckets[index] == 0) {
+			return res;
+		}
+	}
+
+	length = sizeof(BucketizerAllocator) + count * sizeof(Allocator *);
+	res = ALLOC(allocator, length);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != length) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (BucketizerAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->min = min;
+	self->step = step;
+	self->count = count;
+	for (unsigned int index = 0; index < count; index++) {
+		self->buckets[index] = buckets[index];
+	}
+
+	self->outside_methods.alloc = bucketizer_alloc;
+	self->outside_methods.alloc_aligned = bucketizer_alloc_aligned;
+	self->outside_methods.alloc_zeroed = bucketizer_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = bucketizer_realloc;
+	self->outside_methods.resize = bucketizer_resize;
+	self->outside_methods.free = bucketizer_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = bucketizer_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = bucketizer_owns;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result deinit_bucketizer_allocator(BucketizerAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(BucketizerAllocator) + self->count * sizeof(Allocator *);
+	return FREE(self->inside_methods, res.data);
+}
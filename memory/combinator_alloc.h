@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+struct segregator_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Allocator *small;
+	Allocator *large;
+	unsigned int threshold;
+};
+
+struct fallback_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Allocator *primary;
+	Allocator *secondary;
+};
+
+// Bucket n serves sizes in [min + n * step, min + (n + 1) * step)
+struct bucketizer_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	unsigned int min;
+	unsigned int step;
+	unsigned int count;
+	Allocator *buckets[];
+};
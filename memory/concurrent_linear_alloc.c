@@ -0,0 +1,327 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#define CONCURRENT_LINEAR_ROUND(size) (((uint64_t)(size) + CONCURRENT_LINEAR_ALIGN - 1) & ~(uint64_t)(CONCURRENT_LINEAR_ALIGN - 1))
+
+// Reserves length bytes with one fetch_add, returning their offset or
+// UINT64_MAX if the arena is full
+function uint64_t concurrent_linear_claim(ConcurrentLinearAllocator *self, uint64_t length) {
+	uint64_t state, offset;
+
+	// Failing early on a full arena keeps failed adds from piling up in
+	// the offset bits.
+	state = atomic_load_explicit(&self->state, memory_order_relaxed);
+	if (CONCURRENT_LINEAR_OFFSET(state) + length > self->capacity) {
+		return UINT64_MAX;
+	}
+
+	state = atomic_fetch_add_explicit(&self->state, length, memory_order_relaxed);
+	offset = CONCURRENT_LINEAR_OFFSET(state);
+	if (offset + length > self->capacity) {
+		// Only undone while nobody else moved the offset or reset the arena
+		uint64_t expected = state + length;
+		atomic_compare_exchange_strong_explicit(
+			&self->state, &expected, state, memory_order_relaxed, memory_order_relaxed
+		);
+		return UINT64_MAX;
+	}
+
+	return offset;
+}
+
+function Result concurrent_linear_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	offset = concurrent_linear_claim(self, CONCURRENT_LINEAR_ROUND(size));
+	if (offset == UINT64_MAX) {
+		return res;
+	}
+
+	res.data.data = (void*)(self->memory + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// The whole batch is one claim, so its items are contiguous even when
+// other threads allocate concurrently.
+function Result concurrent_linear_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t length, offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	length = 0;
+	for (unsigned int index = 0; index < count; index++) {
+		if (sizes[index] == 0) {
+			return res;
+		}
+		length += CONCURRENT_LINEAR_ROUND(sizes[index]);
+	}
+
+	offset = concurrent_linear_claim(self, length);
+	if (offset == UINT64_MAX) {
+		return res;
+	}
+
+	for (unsigned int index = 0; index < count; index++) {
+		out[index].data = (void*)(self->memory + offset);
+		out[index].length = sizes[index];
+		offset += CONCURRENT_LINEAR_ROUND(sizes[index]);
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = out;
+	res.data.length = count * sizeof(Slice);
+	return res;
+}
+
+function Result concurrent_linear_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t length, state, offset;
+	uintptr_t address;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+	if (alignment <= CONCURRENT_LINEAR_ALIGN) {
+		return concurrent_linear_alloc(allocator, size);
+	}
+
+	// The padding depends on the offset, so this path claims space with CAS
+	self = (ConcurrentLinearAllocator *) allocator;
+	length = CONCURRENT_LINEAR_ROUND(size);
+	state = atomic_load_explicit(&self->state, memory_order_relaxed);
+	do {
+		address = (uintptr_t)(self->memory + CONCURRENT_LINEAR_OFFSET(state));
+		address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		offset = address - (uintptr_t) self->memory;
+		if (offset + length > self->capacity) {
+			return res;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(
+		&self->state, &state, CONCURRENT_LINEAR_STATE(CONCURRENT_LINEAR_EPOCH(state), offset + length),
+		memory_order_relaxed, memory_order_relaxed
+	));
+
+	res.data.data = (void*)(self->memory + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Gives back the most recent allocation if no other thread allocated since
+function Result concurrent_linear_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t state, offset, end;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	if ((uint8_t *) ptr.data < self->memory || (uint8_t *) ptr.data >= self->memory + self->capacity) {
+		return res;
+	}
+
+	offset = (uint8_t *) ptr.data - self->memory;
+	end = offset + CONCURRENT_LINEAR_ROUND(ptr.length);
+	state = atomic_load_explicit(&self->state, memory_order_relaxed);
+	if (CONCURRENT_LINEAR_OFFSET(state) == end) {
+		atomic_compare_exchange_strong_explicit(
+			&self->state, &state, CONCURRENT_LINEAR_STATE(CONCURRENT_LINEAR_EPOCH(state), offset),
+			memory_order_relaxed, memory_order_relaxed
+		);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result concurrent_linear_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t state, offset, end;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	if ((uint8_t *) ptr.data < self->memory || (uint8_t *) ptr.data >= self->memory + self->capacity) {
+		return res;
+	}
+
+	offset = (uint8_t *) ptr.data - self->memory;
+	end = offset + CONCURRENT_LINEAR_ROUND(ptr.length);
+	state = atomic_load_explicit(&self->state, memory_order_relaxed);
+	if (
+		CONCURRENT_LINEAR_OFFSET(state) == end &&
+		offset + CONCURRENT_LINEAR_ROUND(size) <= self->capacity &&
+		atomic_compare_exchange_strong_explicit(
+			&self->state, &state, CONCURRENT_LINEAR_STATE(CONCURRENT_LINEAR_EPOCH(state), offset + CONCURRENT_LINEAR_ROUND(size)),
+			memory_order_relaxed, memory_order_relaxed
+		)
+	) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	} else if (size <= ptr.length) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	}
+
+	return res;
+}
+
+// Starts a new epoch at offset 0. Allocations still being made from the old
+// epoch must have finished, as their memory is handed out again.
+function Result concurrent_linear_freeall(Allocator *allocator) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	uint64_t state;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	state = atomic_load_explicit(&self->state, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(
+		&self->state, &state, CONCURRENT_LINEAR_STATE(CONCURRENT_LINEAR_EPOCH(state) + 1, 0),
+		memory_order_acq_rel, memory_order_relaxed
+	)) {
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+uint64_t concurrent_linear_epoch(ConcurrentLinearAllocator *self) {
+	if (self == 0) {
+		return 0;
+	}
+
+	return CONCURRENT_LINEAR_EPOCH(atomic_load_explicit(&self->state, memory_order_acquire));
+}
+
+function Result concurrent_linear_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) allocator;
+	if ((uint8_t *) ptr.data >= self->memory &&
+		(uint8_t *) ptr.data + ptr.length <= self->memory + self->capacity) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result new_concurrent_linear_allocator(Allocator *allocator, unsigned int max_size) {
+	Result res;
+	ConcurrentLinearAllocator *self;
+	unsigned int buffer_size;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || max_size == 0 || max_size > UINT32_MAX - 2 * CONCURRENT_LINEAR_ALIGN) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(ConcurrentLinearAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(ConcurrentLinearAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (ConcurrentLinearAllocator *) res.data.data;
+	self->inside_methods = allocator;
+
+	buffer_size = (unsigned int) CONCURRENT_LINEAR_ROUND(max_size) + CONCURRENT_LINEAR_ALIGN;
+	res = ALLOC(allocator, buffer_size);
+	if (res.status != ERROR_OK) {
+		res.data.data = self;
+		res.data.length = sizeof(ConcurrentLinearAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	if (res.data.length != buffer_size) {
+		FREE(allocator, res.data);
+		res.data.data = self;
+		res.data.length = sizeof(ConcurrentLinearAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->buffer = res.data;
+	self->memory = (uint8_t *)(((uintptr_t) res.data.data + CONCURRENT_LINEAR_ALIGN - 1) & ~(uintptr_t)(CONCURRENT_LINEAR_ALIGN - 1));
+	self->capacity = (unsigned int) CONCURRENT_LINEAR_ROUND(max_size);
+	atomic_init(&self->state, CONCURRENT_LINEAR_STATE(0, 0));
+
+	self->outside_methods.alloc = concurrent_linear_alloc;
+	self->outside_methods.alloc_aligned = concurrent_linear_alloc_aligned;
+	self->outside_methods.alloc_zeroed = standard_alloc_zeroed;
+	self->outside_methods.alloc_batch = concurrent_linear_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = concurrent_linear_resize;
+	self->outside_methods.free = concurrent_linear_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = concurrent_linear_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = concurrent_linear_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(ConcurrentLinearAllocator);
+	return res;
+}
+
+Result deinit_concurrent_linear_allocator(ConcurrentLinearAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = FREE(self->inside_methods, self->buffer);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(ConcurrentLinearAllocator);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define CONCURRENT_LINEAR_ALIGN 8
+
+// The bump offset and a reset epoch share one word so that a single
+// fetch_add allocates, and a rollback can tell whether a reset happened
+// in between.
+#define CONCURRENT_LINEAR_OFFSET_BITS 40
+#define CONCURRENT_LINEAR_OFFSET_MASK ((UINT64_C(1) << CONCURRENT_LINEAR_OFFSET_BITS) - 1)
+#define CONCURRENT_LINEAR_STATE(epoch, offset) (((uint64_t)(epoch) << CONCURRENT_LINEAR_OFFSET_BITS) | (offset))
+#define CONCURRENT_LINEAR_EPOCH(state) ((state) >> CONCURRENT_LINEAR_OFFSET_BITS)
+#define CONCURRENT_LINEAR_OFFSET(state) ((state) & CONCURRENT_LINEAR_OFFSET_MASK)
+
+struct concurrent_linear_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Slice buffer;
+	uint8_t *memory;
+	unsigned int capacity;
+	_Atomic uint64_t state;
+};
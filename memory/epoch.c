@@ -0,0 +1,282 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#define EPOCH_ACTIVE 1
+
+function void epoch_free_bag(EpochBag *bag) {
+	EpochRetired *items = (EpochRetired *) bag->items.data;
+
+	for (unsigned int index = 0; index < bag->count; index++) {
+		FREE(items[index].allocator, items[index].ptr);
+	}
+	bag->count = 0;
+}
+
+// The epoch can only move on once every active record has caught up to it
+function void epoch_try_advance(EpochDomain *domain) {
+	EpochRecord *record;
+	uint64_t epoch, announced;
+
+	epoch = atomic_load(&domain->epoch);
+	for (record = atomic_load(&domain->records); record != 0; record = record->next) {
+		announced = atomic_load(&record->announced);
+		if ((announced & EPOCH_ACTIVE) && (announced >> 1) != epoch) {
+			return;
+		}
+	}
+
+	// Losing the race means another thread already advanced it
+	atomic_compare_exchange_strong(&domain->epoch, &epoch, epoch + 1);
+}
+
+function void epoch_collect(EpochRecord *record) {
+	uint64_t epoch = atomic_load(&record->domain->epoch);
+
+	for (unsigned int index = 0; index < EPOCH_BAG_COUNT; index++) {
+		if (record->bags[index].count > 0 && record->bags[index].epoch + 2 <= epoch) {
+			epoch_free_bag(&record->bags[index]);
+		}
+	}
+}
+
+Result new_epoch_domain(Allocator *allocator) {
+	Result res;
+	EpochDomain *domain;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(EpochDomain));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(EpochDomain)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	domain = (EpochDomain *) res.data.data;
+	domain->allocator = allocator;
+	atomic_init(&domain->epoch, 0);
+	atomic_init(&domain->records, 0);
+	pthread_mutex_init(&domain->lock, 0);
+
+	res.status = ERROR_OK;
+	res.data.data = domain;
+	res.data.length = sizeof(EpochDomain);
+	return res;
+}
+
+// Frees everything still retired. No thread may be using the domain.
+Result deinit_epoch_domain(EpochDomain *domain) {
+	Result res;
+	EpochRecord *record, *next;
+	Slice s;
+	BASE_ERROR_RESULT(res);
+
+	if (domain == 0) {
+		return res;
+	}
+
+	for (record = atomic_load(&domain->records); record != 0; record = next) {
+		next = record->next;
+		for (unsigned int index = 0; index < EPOCH_BAG_COUNT; index++) {
+			epoch_free_bag(&record->bags[index]);
+			if (record->bags[index].items.data != 0) {
+				FREE(domain->allocator, record->bags[index].items);
+			}
+		}
+		s.data = record;
+		s.length = sizeof(EpochRecord);
+		FREE(domain->allocator, s);
+	}
+	pthread_mutex_destroy(&domain->lock);
+
+	res.data.data = domain;
+	res.data.length = sizeof(EpochDomain);
+	return FREE(domain->allocator, res.data);
+}
+
+// Hands out a record for the calling thread, reusing one an earlier thread
+// gave back along with whatever it still had retired.
+Result epoch_register(EpochDomain *domain) {
+	Result res;
+	EpochRecord *record;
+	int unused;
+	BASE_ERROR_RESULT(res);
+
+	if (domain == 0) {
+		return res;
+	}
+
+	pthread_mutex_lock(&domain->lock);
+	for (record = atomic_load(&domain->records); record != 0; record = record->next) {
+		unused = 0;
+		if (atomic_compare_exchange_strong(&record->in_use, &unused, 1)) {
+			pthread_mutex_unlock(&domain->lock);
+			res.status = ERROR_OK;
+			res.data.data = record;
+			res.data.length = sizeof(EpochRecord);
+			return res;
+		}
+	}
+
+	res = ALLOC(domain->allocator, sizeof(EpochRecord));
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&domain->lock);
+		return res;
+	}
+	if (res.data.length != sizeof(EpochRecord)) {
+		FREE(domain->allocator, res.data);
+		pthread_mutex_unlock(&domain->lock);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	record = (EpochRecord *) res.data.data;
+	record->domain = domain;
+	atomic_init(&record->announced, 0);
+	atomic_init(&record->in_use, 1);
+	record->depth = 0;
+	record->retired = 0;
+	for (unsigned int index = 0; index < EPOCH_BAG_COUNT; index++) {
+		record->bags[index].epoch = 0;
+		record->bags[index].count = 0;
+		SET_NULL_SLICE(record->bags[index].items);
+	}
+	record->next = atomic_load(&domain->records);
+	atomic_store(&domain->records, record);
+	pthread_mutex_unlock(&domain->lock);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result epoch_unregister(EpochRecord *record) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (record == 0 || record->depth != 0) {
+		return res;
+	}
+
+	epoch_try_advance(record->domain);
+	epoch_collect(record);
+	atomic_store(&record->in_use, 0);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Critical sections nest; only the outermost one publishes the epoch.
+Result epoch_enter(EpochRecord *record) {
+	Result res;
+	uint64_t epoch;
+	BASE_ERROR_RESULT(res);
+
+	if (record == 0) {
+		return res;
+	}
+
+	if (record->depth++ == 0) {
+		// Re-checks so a concurrent advance cannot slip in between
+		do {
+			epoch = atomic_load(&record->domain->epoch);
+			atomic_store(&record->announced, epoch << 1 | EPOCH_ACTIVE);
+		} while (atomic_load(&record->domain->epoch) != epoch);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result epoch_exit(EpochRecord *record) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (record == 0 || record->depth == 0) {
+		return res;
+	}
+
+	if (--record->depth == 0) {
+		atomic_store_explicit(&record->announced, 0, memory_order_release);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// ptr must already be unreachable for new readers. It is FREEd to its
+// allocator once no reader can still hold it; every EPOCH_RECLAIM_INTERVAL
+// retirements the record tries to move the epoch and collect.
+Result epoch_retire(EpochRecord *record, Slice ptr, Allocator *allocator) {
+	Result res;
+	EpochBag *bag;
+	EpochRetired *items;
+	uint64_t epoch;
+	unsigned int capacity;
+	BASE_ERROR_RESULT(res);
+
+	if (record == 0 || allocator == 0 || ptr.data == 0 || ptr.length == 0) {
+		return res;
+	}
+
+	epoch = atomic_load(&record->domain->epoch);
+	bag = &record->bags[epoch % EPOCH_BAG_COUNT];
+	if (bag->epoch != epoch) {
+		// The bag last held epoch - 3 or earlier, which is safe to free
+		epoch_free_bag(bag);
+		bag->epoch = epoch;
+	}
+
+	capacity = bag->items.length / sizeof(EpochRetired);
+	if (bag->count == capacity) {
+		capacity = capacity == 0 ? EPOCH_BAG_INITIAL : capacity << 1;
+		if (bag->items.data == 0) {
+			res = ALLOC(record->domain->allocator, capacity * sizeof(EpochRetired));
+		} else {
+			res = REALLOC(record->domain->allocator, bag->items, capacity * sizeof(EpochRetired));
+		}
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+		bag->items = res.data;
+	}
+
+	items = (EpochRetired *) bag->items.data;
+	items[bag->count].ptr = ptr;
+	items[bag->count].allocator = allocator;
+	bag->count++;
+
+	if (++record->retired >= EPOCH_RECLAIM_INTERVAL) {
+		epoch_reclaim(record);
+	}
+
+	res.status = ERROR_OK;
+	res.data = ptr;
+	return res;
+}
+
+Result epoch_reclaim(EpochRecord *record) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (record == 0) {
+		return res;
+	}
+
+	record->retired = 0;
+	epoch_try_advance(record->domain);
+	epoch_collect(record);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+uint64_t epoch_current(EpochDomain *domain) {
+	return domain == 0 ? 0 : atomic_load(&domain->epoch);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Retired memory is bagged by the epoch it was retired in. A bag can be
+// freed once the global epoch is two past it: every reader that might have
+// seen its contents has left its critical section by then.
+#define EPOCH_BAG_COUNT 3
+#define EPOCH_BAG_INITIAL 16
+#define EPOCH_RECLAIM_INTERVAL 64
+
+typedef struct {
+	Slice ptr;
+	Allocator *allocator;
+} EpochRetired;
+
+typedef struct {
+	uint64_t epoch;
+	Slice items;
+	unsigned int count;
+} EpochBag;
+
+// `announced` holds the epoch the owner entered in, shifted left by one,
+// with the low bit set while it is inside a critical section.
+struct epoch_record_s {
+	EpochRecord *next;
+	EpochDomain *domain;
+	_Atomic uint64_t announced;
+	_Atomic int in_use;
+	unsigned int depth;
+	unsigned int retired;
+	EpochBag bags[EPOCH_BAG_COUNT];
+};
+
+// Records are only ever added to the list, so scanning it needs no lock;
+// the mutex just serializes registration.
+struct epoch_domain_s {
+	Allocator *allocator;
+	_Atomic uint64_t epoch;
+	_Atomic(EpochRecord *) records;
+	pthread_mutex_t lock;
+};
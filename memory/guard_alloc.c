@@ -0,0 +1,487 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Sampled blocks are right-aligned against the guard, so they keep only
+// the alignment their size implies, up to what malloc() would give them
+#define GUARD_MAX_ALIGN 16
+
+// One unsigned compare: addresses below the pool wrap around to huge offsets
+#define GUARD_IN_POOL(self, address) \
+	((uintptr_t)(address) - (uintptr_t)(self)->pool.data < (self)->pool.length)
+
+// Allocations left before the next sampled one, shared by every guard
+// allocator on the thread so the fast path touches no shared cache line
+local _Thread_local unsigned int guard_countdown;
+local _Thread_local uint32_t guard_seed;
+
+// Uniform in [1, 2 * rate - 1], so the mean gap is `rate` but allocation
+// patterns with a fixed period cannot keep dodging the samples
+function unsigned int guard_interval(unsigned int rate) {
+	if (rate <= 1) {
+		return 1;
+	}
+
+	if (guard_seed == 0) {
+		guard_seed = (uint32_t)(uintptr_t) &guard_seed | 1;
+	}
+	guard_seed ^= guard_seed << 13;
+	guard_seed ^= guard_seed >> 17;
+	guard_seed ^= guard_seed << 5;
+
+	return 1 + (unsigned int)(guard_seed % (2 * (uint64_t) rate - 1));
+}
+
+// A thread starts with a full interval rather than a sample, so short-lived
+// threads are not all sampled on their first allocation
+function int guard_sample_due(GuardAllocator *self) {
+	if (__builtin_expect(guard_countdown == 0, 0)) {
+		guard_countdown = guard_interval(self->sample_rate);
+	}
+	if (__builtin_expect(guard_countdown > 1, 1)) {
+		guard_countdown--;
+		return 0;
+	}
+
+	guard_countdown = guard_interval(self->sample_rate);
+	return 1;
+}
+
+void guard_sample_next(void) {
+	guard_countdown = 1;
+}
+
+function uint8_t *guard_slot_page(GuardAllocator *self, unsigned int slot) {
+	return (uint8_t *) self->pool.data + (2 * (size_t) slot + 1) * self->page_size;
+}
+
+// Returns the slot whose page holds address, or GUARD_SLOT_NONE for guards
+function unsigned int guard_slot_of(GuardAllocator *self, void *address) {
+	size_t page = ((uint8_t *) address - (uint8_t *) self->pool.data) / self->page_size;
+
+	if ((page & 1) == 0) {
+		return GUARD_SLOT_NONE;
+	}
+	return (unsigned int)(page >> 1);
+}
+
+// Callers hold the lock
+function void guard_enqueue(GuardAllocator *self, unsigned int slot) {
+	self->slots[slot].next = GUARD_SLOT_NONE;
+	if (self->quarantine_tail == GUARD_SLOT_NONE) {
+		self->quarantine_head = slot;
+	} else {
+		self->slots[self->quarantine_tail].next = slot;
+	}
+	self->quarantine_tail = slot;
+}
+
+// Callers hold the lock. Fresh slots go first; after that the slot freed
+// longest ago, which keeps a dangling pointer faulting for as long as possible.
+function unsigned int guard_take_slot(GuardAllocator *self) {
+	unsigned int slot;
+
+	if (self->fresh < self->slot_count) {
+		return self->fresh++;
+	}
+
+	slot = self->quarantine_head;
+	if (slot != GUARD_SLOT_NONE) {
+		self->quarantine_head = self->slots[slot].next;
+		if (self->quarantine_head == GUARD_SLOT_NONE) {
+			self->quarantine_tail = GUARD_SLOT_NONE;
+		}
+	}
+	return slot;
+}
+
+// Callers hold the lock. Dropping the pages means a reused slot reads as zero.
+function void guard_retire(GuardAllocator *self, unsigned int slot) {
+	uint8_t *page = guard_slot_page(self, slot);
+
+	self->slots[slot].live = 0;
+	madvise(page, self->page_size, MADV_DONTNEED);
+	mprotect(page, self->page_size, PROT_NONE);
+	guard_enqueue(self, slot);
+}
+
+// Fails when the block does not fit a slot or none is free, and the caller
+// then forwards the request to the parent
+function Result guard_place(GuardAllocator *self, unsigned int size, unsigned int alignment) {
+	Result res;
+	unsigned int slot;
+	uint8_t *page;
+	uintptr_t start;
+	BASE_ERROR_RESULT(res);
+
+	if (size > self->page_size || alignment > self->page_size) {
+		return res;
+	}
+	if (alignment == 0) {
+		alignment = size & -size;
+		if (alignment > GUARD_MAX_ALIGN) {
+			alignment = GUARD_MAX_ALIGN;
+		}
+	}
+
+	pthread_mutex_lock(&self->lock);
+	slot = guard_take_slot(self);
+	if (slot == GUARD_SLOT_NONE) {
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	page = guard_slot_page(self, slot);
+	if (mprotect(page, self->page_size, PROT_READ | PROT_WRITE) != 0) {
+		guard_enqueue(self, slot);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	start = ((uintptr_t) page + self->page_size - size) & ~(uintptr_t)(alignment - 1);
+	self->slots[slot].allocation.data = (void*) start;
+	self->slots[slot].allocation.length = size;
+	self->slots[slot].live = 1;
+	self->sampled++;
+	pthread_mutex_unlock(&self->lock);
+
+	res.data = self->slots[slot].allocation;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result guard_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	GuardAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (guard_sample_due(self)) {
+		res = guard_place(self, size, 0);
+		if (res.status == ERROR_OK) {
+			return res;
+		}
+	}
+
+	return ALLOC(self->inside_methods, size);
+}
+
+function Result guard_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	GuardAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (guard_sample_due(self)) {
+		res = guard_place(self, size, alignment);
+		if (res.status == ERROR_OK) {
+			return res;
+		}
+	}
+
+	return ALLOC_ALIGNED(self->inside_methods, size, alignment);
+}
+
+// Slot pages are always fresh or dropped, so sampled blocks are zero already
+function Result guard_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	GuardAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (guard_sample_due(self)) {
+		res = guard_place(self, size, 0);
+		if (res.status == ERROR_OK) {
+			return res;
+		}
+	}
+
+	return ALLOC_ZEROED(self->inside_methods, size);
+}
+
+// Frees of anything but a live block's start, double frees included, fail
+function Result guard_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	GuardAllocator *self;
+	unsigned int slot;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (!GUARD_IN_POOL(self, ptr.data)) {
+		return FREE(self->inside_methods, ptr);
+	}
+
+	slot = guard_slot_of(self, ptr.data);
+	if (slot == GUARD_SLOT_NONE) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	if (self->slots[slot].live && self->slots[slot].allocation.data == ptr.data) {
+		guard_retire(self, slot);
+		res.status = ERROR_OK;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// A sampled block can change size as long as it still fits its page; its
+// end then no longer touches the guard
+function Result guard_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	GuardAllocator *self;
+	unsigned int slot;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (!GUARD_IN_POOL(self, ptr.data)) {
+		return RESIZE(self->inside_methods, ptr, size);
+	}
+
+	slot = guard_slot_of(self, ptr.data);
+	if (slot == GUARD_SLOT_NONE) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	if (
+		self->slots[slot].live && self->slots[slot].allocation.data == ptr.data &&
+		(uint8_t *) ptr.data + size <= guard_slot_page(self, slot) + self->page_size
+	) {
+		self->slots[slot].allocation.length = size;
+		res.data = self->slots[slot].allocation;
+		res.status = ERROR_OK;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result guard_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	GuardAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (!GUARD_IN_POOL(self, ptr.data)) {
+		return REALLOC(self->inside_methods, ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+// Retires the sampled blocks, the only ones the allocator keeps itself
+function Result guard_freeall(Allocator *allocator) {
+	Result res;
+	GuardAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	for (unsigned int slot = 0; slot < self->fresh; slot++) {
+		if (self->slots[slot].live) {
+			guard_retire(self, slot);
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result guard_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	GuardAllocator *self;
+	unsigned int slot;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (GuardAllocator *) allocator;
+	if (!GUARD_IN_POOL(self, ptr.data)) {
+		return OWNS(self->inside_methods, ptr);
+	}
+
+	slot = guard_slot_of(self, ptr.data);
+	if (slot == GUARD_SLOT_NONE) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	if (self->slots[slot].live && SLICE_WITHIN(self->slots[slot].allocation, ptr)) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// A guard page is blamed on the live block that ends against it, failing
+// that on the one starting after it. Inside a slot, a freed block means a
+// dangling pointer and a live one a stray access into its padding.
+Result guard_allocator_describe(GuardAllocator *self, void *address, GuardReport *report) {
+	Result res;
+	GuardSlot *slot;
+	size_t page;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || report == 0 || !GUARD_IN_POOL(self, address)) {
+		return res;
+	}
+
+	report->fault = GUARD_FAULT_UNKNOWN;
+	SET_NULL_SLICE(report->allocation);
+
+	page = ((uint8_t *) address - (uint8_t *) self->pool.data) / self->page_size;
+	if ((page & 1) == 0) {
+		if (page > 0 && self->slots[page / 2 - 1].live) {
+			report->fault = GUARD_FAULT_OVERFLOW;
+			report->allocation = self->slots[page / 2 - 1].allocation;
+		} else if (page / 2 < self->slot_count && self->slots[page / 2].live) {
+			report->fault = GUARD_FAULT_UNDERFLOW;
+			report->allocation = self->slots[page / 2].allocation;
+		}
+	} else {
+		slot = &self->slots[page / 2];
+		if (slot->allocation.data != 0) {
+			report->allocation = slot->allocation;
+			if (!slot->live) {
+				report->fault = GUARD_FAULT_USE_AFTER_FREE;
+			} else if ((uint8_t *) address < (uint8_t *) slot->allocation.data) {
+				report->fault = GUARD_FAULT_UNDERFLOW;
+			} else if ((uint8_t *) address >= (uint8_t *) slot->allocation.data + slot->allocation.length) {
+				report->fault = GUARD_FAULT_OVERFLOW;
+			}
+		}
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = report;
+	res.data.length = sizeof(GuardReport);
+	return res;
+}
+
+Result new_guard_allocator(Allocator *allocator, unsigned int sample_rate, unsigned int slot_count) {
+	Result res;
+	GuardAllocator *self;
+	unsigned int length;
+	size_t page_size;
+	void *pool;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sample_rate == 0 || slot_count == 0) {
+		return res;
+	}
+	if (slot_count > (UINT32_MAX - sizeof(GuardAllocator)) / sizeof(GuardSlot)) {
+		return res;
+	}
+
+	// Every slot starts and stays PROT_NONE until it is handed out
+	page_size = sysconf(_SC_PAGESIZE);
+	pool = mmap(
+		0, (2 * (size_t) slot_count + 1) * page_size, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+	);
+	if (pool == MAP_FAILED) {
+		return res;
+	}
+
+	length = sizeof(GuardAllocator) + slot_count * sizeof(GuardSlot);
+	res = ALLOC(allocator, length);
+	if (res.status != ERROR_OK) {
+		munmap(pool, (2 * (size_t) slot_count + 1) * page_size);
+		return res;
+	}
+	if (res.data.length != length) {
+		FREE(allocator, res.data);
+		munmap(pool, (2 * (size_t) slot_count + 1) * page_size);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (GuardAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->pool.data = pool;
+	self->pool.length = (2 * (size_t) slot_count + 1) * page_size;
+	self->page_size = page_size;
+	self->sample_rate = sample_rate;
+	self->slot_count = slot_count;
+	self->fresh = 0;
+	self->quarantine_head = GUARD_SLOT_NONE;
+	self->quarantine_tail = GUARD_SLOT_NONE;
+	self->sampled = 0;
+	pthread_mutex_init(&self->lock, 0);
+	for (unsigned int slot = 0; slot < slot_count; slot++) {
+		SET_NULL_SLICE(self->slots[slot].allocation);
+		self->slots[slot].next = GUARD_SLOT_NONE;
+		self->slots[slot].live = 0;
+	}
+
+	self->outside_methods.alloc = guard_alloc;
+	self->outside_methods.alloc_aligned = guard_alloc_aligned;
+	self->outside_methods.alloc_zeroed = guard_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = guard_realloc;
+	self->outside_methods.resize = guard_resize;
+	self->outside_methods.free = guard_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = guard_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = guard_owns;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Blocks the parent served are the caller's to free; sampled ones go with
+// the pool
+Result deinit_guard_allocator(GuardAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	if (munmap(self->pool.data, self->pool.length) != 0) {
+		return res;
+	}
+	pthread_mutex_destroy(&self->lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(GuardAllocator) + self->slot_count * sizeof(GuardSlot);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Slot indices are unsigned ints; this one marks the end of the quarantine
+#define GUARD_SLOT_NONE UINT32_MAX
+
+// A sampled block owns the page of its slot. `allocation` is kept after the
+// free so a fault in the slot can still be attributed to it.
+typedef struct guard_slot_s GuardSlot;
+struct guard_slot_s {
+	Slice allocation;
+	unsigned int next;
+	int live;
+};
+
+// The pool alternates guard pages and slot pages, starting and ending with
+// a guard: slot n is page 2n + 1. Freed slots are queued oldest first and
+// only handed out again once no fresh slot is left.
+struct guard_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Slice pool;
+	size_t page_size;
+	unsigned int sample_rate;
+	unsigned int slot_count;
+	unsigned int fresh;
+	unsigned int quarantine_head;
+	unsigned int quarantine_tail;
+	pthread_mutex_t lock;
+	size_t sampled;
+	GuardSlot slots[];
+};
@@ -4,6 +4,11 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 // This function assumes that FREE might fail and destroy data, but not a valid reference
 Result standard_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
@@ -15,6 +20,11 @@ Result standard_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
 		return res;
 	}
 
+	res = RESIZE(allocator, ptr, size);
+	if (res.status == ERROR_OK) {
+		return res;
+	}
+
 	res = ALLOC(allocator, size);
 	if (res.status != ERROR_OK) {
 		return res;
@@ -26,7 +36,7 @@ Result standard_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
 	}
 	new_mem = res.data;	
 
-	res = slice_copy(new_mem, ptr);
+	res = slice_copy(new_mem, slice_sub(ptr, 0, size < ptr.length ? size : ptr.length));
 	if (res.status != ERROR_OK) {
 		FREE(allocator, new_mem);
 		return res;
@@ -45,6 +55,152 @@ Result standard_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
 	return res;
 }
 
+// Allocators without a way to place blocks can only hand out what happens
+// to be aligned already.
+Result standard_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	res = ALLOC(allocator, size);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (((uintptr_t) res.data.data & (alignment - 1)) != 0) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+	}
+
+	return res;
+}
+
+// Like standard_realloc, but a moved allocation keeps the alignment
+Result standard_realloc_aligned(Allocator *allocator, Slice ptr, unsigned int size, unsigned int alignment) {
+	Result res;
+	Slice new_mem;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0 || ptr.length == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	res = RESIZE(allocator, ptr, size);
+	if (res.status == ERROR_OK) {
+		return res;
+	}
+
+	res = ALLOC_ALIGNED(allocator, size, alignment);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	new_mem = res.data;
+
+	memcpy(new_mem.data, ptr.data, size < ptr.length ? size : ptr.length);
+
+	res = FREE(allocator, ptr);
+	if (res.status != ERROR_OK) {
+		FREE(allocator, new_mem);
+		return res;
+	}
+
+	res.data = new_mem;
+	return res;
+}
+
+// Allocators that cannot resize in place only accept resizing to the same length
+Result standard_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0 || ptr.length == 0 || size == 0) {
+		return res;
+	}
+
+	if (size == ptr.length) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+
+	return res;
+}
+
+Result standard_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, size);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	memset(res.data.data, 0, res.data.length);
+
+	return res;
+}
+
+Result standard_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+		return res;
+	}
+
+	for (unsigned int index = 0; index < count; index++) {
+		if (sizes[index] == 0) {
+			BASE_ERROR_RESULT(res);
+		} else {
+			res = ALLOC(allocator, sizes[index]);
+		}
+		if (res.status == ERROR_OK && res.data.length != sizes[index]) {
+			FREE(allocator, res.data);
+			res.status = ERROR_ERR;
+		}
+		if (res.status != ERROR_OK) {
+			if (index > 0) {
+				FREE_BATCH(allocator, out, index);
+			}
+			BASE_ERROR_RESULT(res);
+			return res;
+		}
+		out[index] = res.data;
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = out;
+	res.data.length = count * sizeof(Slice);
+	return res;
+}
+
+// Keeps going past a failed free so one bad Slice does not leak the rest
+Result standard_free_batch(Allocator *allocator, Slice *ptrs, unsigned int count) {
+	Result res;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptrs == 0 || count == 0) {
+		return res;
+	}
+
+	for (unsigned int index = count; index-- > 0;) {
+		if (FREE(allocator, ptrs[index]).status != ERROR_OK) {
+			failed = 1;
+		}
+	}
+
+	BASE_ERROR_RESULT(res);
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
+
 function Result array_list_push_slice(ArrayList *al, Slice whole, unsigned int index, unsigned int last_offset) {
 	Result res;
 	#ifdef DEBUG_SET
@@ -164,6 +320,82 @@ Result standard_slice_split(Allocator *allocator, Slice whole, Slice part) {
 	return res;
 }
 
+// Only pages that lie entirely inside ptr are touched, so the buffer may
+// come from malloc() and share its first and last pages with other data.
+Result trim_pages(Slice ptr, enum trim_advice advice) {
+	Result res;
+	uintptr_t page, start, end;
+	int flag;
+	BASE_ERROR_RESULT(res);
+
+	if (ptr.data == 0) {
+		return res;
+	}
+
+	page = (uintptr_t) sysconf(_SC_PAGESIZE);
+	start = ((uintptr_t) ptr.data + page - 1) & ~(page - 1);
+	end = ((uintptr_t) ptr.data + ptr.length) & ~(page - 1);
+
+	res.status = ERROR_OK;
+	SET_NULL_SLICE(res.data);
+	if (end <= start) {
+		return res;
+	}
+
+	flag = MADV_DONTNEED;
+	#ifdef MADV_FREE
+	if (advice == TRIM_LAZY) {
+		flag = MADV_FREE;
+	}
+	#endif
+	if (madvise((void*) start, end - start, flag) != 0) {
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	res.data.data = (void*) start;
+	res.data.length = end - start;
+	return res;
+}
+
+int trim_policy_due(TrimPolicy *policy, unsigned int *idle, size_t high_water) {
+	if (policy == 0 || idle == 0) {
+		return 0;
+	}
+
+	switch (policy->mode) {
+	case TRIM_NEVER:
+		return 0;
+	case TRIM_ON_RESET:
+		return high_water > policy->retain;
+	case TRIM_WHEN_IDLE: {
+		unsigned int limit = policy->idle_resets > 0 ? policy->idle_resets : 1;
+
+		if (high_water > policy->retain) {
+			*idle = 0;
+			return 0;
+		}
+		// Stops counting at the limit so each spike is trimmed only once
+		if (*idle >= limit) {
+			return 0;
+		}
+		return ++(*idle) == limit;
+	}
+	}
+
+	return 0;
+}
+
+// Allocators that do not track their memory cannot claim anything
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+Result standard_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+	return res;
+}
+#pragma GCC diagnostic pop
+
 Result standard_clone(Allocator *allocator, Slice ptr) {
 	Result res;
 	Slice new_mem;
@@ -211,6 +443,48 @@ function Result raw_heap_alloc(Allocator* allocator, unsigned int length) {
 	return res;
 }
 
+function Result raw_heap_alloc_aligned(Allocator* allocator, unsigned int length, unsigned int alignment) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || length == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	// posix_memalign() also wants a multiple of sizeof(void*)
+	if (alignment < sizeof(void*)) {
+		alignment = sizeof(void*);
+	}
+	if (posix_memalign(&res.data.data, alignment, length) != 0) {
+		res.data.data = 0;
+		return res;
+	}
+	res.data.length = length;
+	res.status = ERROR_OK;
+
+	return res;
+}
+
+// calloc() knows when its memory is already zero, e.g. fresh mmap() pages
+// behind large requests, and skips clearing it.
+function Result raw_heap_alloc_zeroed(Allocator* allocator, unsigned int length) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || length == 0) {
+		return res;
+	}
+
+	res.data.data = calloc(1, length);
+	if (res.data.data == 0) {
+		return res;
+	}
+	res.data.length = length;
+	res.status = ERROR_OK;
+
+	return res;
+}
+
 function Result raw_heap_realloc(Allocator* allocator, Slice ptr, unsigned int length) {
 	Result res;
 	BASE_ERROR_RESULT(res);
@@ -229,6 +503,32 @@ function Result raw_heap_realloc(Allocator* allocator, Slice ptr, unsigned int l
 	return res;
 }
 
+// glibc reports the real size of a chunk, so anything within it is in place
+function Result raw_heap_resize(Allocator* allocator, Slice ptr, unsigned int length) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || length == 0) {
+		return res;
+	}
+
+	#ifdef __GLIBC__
+	if (malloc_usable_size(ptr.data) < length) {
+		return res;
+	}
+	#else
+	if (ptr.length != length) {
+		return res;
+	}
+	#endif
+
+	res.data.data = ptr.data;
+	res.data.length = length;
+	res.status = ERROR_OK;
+
+	return res;
+}
+
 function Result raw_heap_free(Allocator* allocator, Slice ptr) {
 	Result res;
 	BASE_ERROR_RESULT(res);
@@ -271,9 +571,10 @@ function Result raw_heap_clone(Allocator *allocator, Slice ptr) {
 }
 
 function Allocator raw_heap_allocator = {
-	raw_heap_alloc, raw_heap_realloc,
-	raw_heap_free,  raw_heap_freeall,
-	raw_heap_clone, standard_slice_split
+	raw_heap_alloc,   raw_heap_alloc_aligned, raw_heap_alloc_zeroed, standard_alloc_batch,
+	raw_heap_realloc, raw_heap_resize,
+	raw_heap_free,    standard_free_batch,    raw_heap_freeall,
+	raw_heap_clone,   standard_slice_split,   standard_owns
 };
 
 Allocator *get_raw_heap_allocator(void) {
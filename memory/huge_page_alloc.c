@@ -0,0 +1,386 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <stdio.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_ROUND(size) (((size_t)(size) + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1))
+
+// Explicit huge pages first; without a hugetlb pool, over-map to find a
+// 2 MiB boundary and ask for transparent huge pages instead.
+function void *huge_page_map(size_t length, enum huge_page_backing *backing) {
+	uint8_t *mapping, *aligned;
+
+	#ifdef MAP_HUGETLB
+	mapping = (uint8_t *) mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mapping != MAP_FAILED) {
+		*backing = HUGE_PAGE_HUGETLB;
+		return mapping;
+	}
+	#endif
+
+	mapping = (uint8_t *) mmap(0, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) {
+		return 0;
+	}
+
+	aligned = (uint8_t *) HUGE_PAGE_ROUND((uintptr_t) mapping);
+	if (aligned != mapping) {
+		munmap(mapping, aligned - mapping);
+	}
+	munmap(aligned + length, mapping + HUGE_PAGE_SIZE - aligned);
+
+	#ifdef MADV_HUGEPAGE
+	madvise(aligned, length, MADV_HUGEPAGE);
+	#endif
+
+	*backing = HUGE_PAGE_ADVISED;
+	return aligned;
+}
+
+function Result huge_page_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	HugePageAllocator *self;
+	HugePageRegion *region;
+	enum huge_page_backing backing;
+	size_t length;
+	void *mapping;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	if (size < HUGE_PAGE_THRESHOLD) {
+		return ALLOC(self->inside_methods, size);
+	}
+
+	res = ALLOC(self->inside_methods, sizeof(HugePageRegion));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(HugePageRegion)) {
+		FREE(self->inside_methods, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	region = (HugePageRegion *) res.data.data;
+
+	length = HUGE_PAGE_ROUND(size);
+	mapping = huge_page_map(length, &backing);
+	if (mapping == 0) {
+		FREE(self->inside_methods, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	region->mapping.data = mapping;
+	region->mapping.length = length;
+	region->backing = backing;
+	region->next = self->regions;
+	self->regions = region;
+
+	self->region_count++;
+	self->bytes_mapped += length;
+	if (backing == HUGE_PAGE_HUGETLB) {
+		self->bytes_hugetlb += length;
+	} else {
+		self->bytes_advised += length;
+	}
+
+	res.data.data = mapping;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Regions start on a huge page, which covers any smaller alignment
+function Result huge_page_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	HugePageAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	if (size < HUGE_PAGE_THRESHOLD) {
+		return ALLOC_ALIGNED(self->inside_methods, size, alignment);
+	}
+	if (alignment > HUGE_PAGE_SIZE) {
+		return res;
+	}
+
+	return huge_page_alloc(allocator, size);
+}
+
+// Fresh mappings are already zero
+function Result huge_page_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	HugePageAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	if (size < HUGE_PAGE_THRESHOLD) {
+		return ALLOC_ZEROED(self->inside_methods, size);
+	}
+
+	return huge_page_alloc(allocator, size);
+}
+
+function HugePageRegion **huge_page_find(HugePageAllocator *self, void *data) {
+	HugePageRegion **link = &self->regions;
+
+	while (*link != 0 && (*link)->mapping.data != data) {
+		link = &(*link)->next;
+	}
+
+	return link;
+}
+
+function Result huge_page_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	HugePageAllocator *self;
+	HugePageRegion **link, *region;
+	Slice record;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	if (ptr.length < HUGE_PAGE_THRESHOLD) {
+		return FREE(self->inside_methods, ptr);
+	}
+
+	link = huge_page_find(self, ptr.data);
+	region = *link;
+	if (region == 0 || region->mapping.length < ptr.length) {
+		return res;
+	}
+	if (munmap(region->mapping.data, region->mapping.length) != 0) {
+		return res;
+	}
+	*link = region->next;
+
+	self->region_count--;
+	self->bytes_mapped -= region->mapping.length;
+	if (region->backing == HUGE_PAGE_HUGETLB) {
+		self->bytes_hugetlb -= region->mapping.length;
+	} else {
+		self->bytes_advised -= region->mapping.length;
+	}
+
+	record.data = region;
+	record.length = sizeof(HugePageRegion);
+	return FREE(self->inside_methods, record);
+}
+
+// Sizes within the same run of huge pages keep their mapping
+function Result huge_page_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	HugePageAllocator *self;
+	HugePageRegion *region;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	if (ptr.length < HUGE_PAGE_THRESHOLD && size < HUGE_PAGE_THRESHOLD) {
+		return RESIZE(self->inside_methods, ptr, size);
+	}
+	if (ptr.length < HUGE_PAGE_THRESHOLD || size < HUGE_PAGE_THRESHOLD) {
+		return res;
+	}
+
+	region = *huge_page_find(self, ptr.data);
+	if (region == 0 || region->mapping.length != HUGE_PAGE_ROUND(size)) {
+		return res;
+	}
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Unmaps every region. Small allocations were served by the parent and must
+// still be freed individually.
+function Result huge_page_freeall(Allocator *allocator) {
+	Result res;
+	HugePageAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	while (self->regions != 0) {
+		res.data = self->regions->mapping;
+		res = huge_page_free(allocator, res.data);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Transparent huge pages are granted by the kernel at fault time, so the
+// only way to know how many were granted is to ask it.
+function size_t huge_page_thp_backed(HugePageAllocator *self) {
+	FILE *smaps;
+	char line[256];
+	unsigned long start, end, kilobytes;
+	uintptr_t region_start, region_end;
+	size_t backed, overlap;
+
+	smaps = fopen("/proc/self/smaps", "r");
+	if (smaps == 0) {
+		return 0;
+	}
+
+	backed = 0;
+	start = 0;
+	end = 0;
+	while (fgets(line, sizeof(line), smaps) != 0) {
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			continue;
+		}
+		if (sscanf(line, "AnonHugePages: %lu kB", &kilobytes) != 1 || kilobytes == 0) {
+			continue;
+		}
+
+		for (HugePageRegion *region = self->regions; region != 0; region = region->next) {
+			if (region->backing != HUGE_PAGE_ADVISED) {
+				continue;
+			}
+			region_start = (uintptr_t) region->mapping.data;
+			region_end = region_start + region->mapping.length;
+			if (region_end <= start || region_start >= end) {
+				continue;
+			}
+			overlap = (region_end < end ? region_end : end) - (region_start > start ? region_start : start);
+			backed += kilobytes * 1024 < overlap ? kilobytes * 1024 : overlap;
+		}
+	}
+
+	fclose(smaps);
+	return backed;
+}
+
+Result huge_page_allocator_stats(HugePageAllocator *self, HugePageStats *stats) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || stats == 0) {
+		return res;
+	}
+
+	stats->regions = self->region_count;
+	stats->bytes_mapped = self->bytes_mapped;
+	stats->bytes_hugetlb = self->bytes_hugetlb;
+	stats->bytes_advised = self->bytes_advised;
+	stats->bytes_thp_backed = huge_page_thp_backed(self);
+
+	res.status = ERROR_OK;
+	res.data.data = stats;
+	res.data.length = sizeof(HugePageStats);
+	return res;
+}
+
+function Result huge_page_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	HugePageAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (HugePageAllocator *) allocator;
+	for (HugePageRegion *region = self->regions; region != 0; region = region->next) {
+		if (SLICE_WITHIN(region->mapping, ptr)) {
+			res.status = ERROR_OK;
+			res.data = ptr;
+			return res;
+		}
+	}
+	return OWNS(self->inside_methods, ptr);
+}
+
+Result new_huge_page_allocator(Allocator *allocator) {
+	Result res;
+	HugePageAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(HugePageAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(HugePageAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (HugePageAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->regions = 0;
+	self->region_count = 0;
+	self->bytes_mapped = 0;
+	self->bytes_hugetlb = 0;
+	self->bytes_advised = 0;
+
+	self->outside_methods.alloc = huge_page_alloc;
+	self->outside_methods.alloc_aligned = huge_page_alloc_aligned;
+	self->outside_methods.alloc_zeroed = huge_page_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = huge_page_resize;
+	self->outside_methods.free = huge_page_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = huge_page_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = huge_page_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(HugePageAllocator);
+	return res;
+}
+
+Result deinit_huge_page_allocator(HugePageAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = huge_page_freeall((Allocator *) self);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(HugePageAllocator);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define HUGE_PAGE_SIZE (2u * 1024 * 1024)
+
+// Requests below this are not worth a huge page and go to the parent
+#define HUGE_PAGE_THRESHOLD (HUGE_PAGE_SIZE / 2)
+
+enum huge_page_backing {
+	HUGE_PAGE_HUGETLB,
+	HUGE_PAGE_ADVISED
+};
+
+typedef struct huge_page_region_s HugePageRegion;
+struct huge_page_region_s {
+	HugePageRegion *next;
+	Slice mapping;
+	enum huge_page_backing backing;
+};
+
+struct huge_page_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	HugePageRegion *regions;
+	unsigned int region_count;
+	size_t bytes_mapped;
+	size_t bytes_hugetlb;
+	size_t bytes_advised;
+};
@@ -0,0 +1,243 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+
+function int inline_in_buffer(InlineAllocator *self, Slice ptr) {
+	return (uint8_t *) ptr.data >= (uint8_t *) self->buffer.data &&
+		(uint8_t *) ptr.data < (uint8_t *) self->buffer.data + self->buffer.length;
+}
+
+function int inline_is_last(InlineAllocator *self, Slice ptr) {
+	return (uint8_t *) ptr.data + ptr.length == (uint8_t *) self->buffer.data + self->used;
+}
+
+// Carves from the caller's buffer, failing if the request does not fit
+function Result inline_bump(InlineAllocator *self, unsigned int size, unsigned int alignment) {
+	Result res;
+	uintptr_t address;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	address = (uintptr_t) self->buffer.data + self->used;
+	offset = self->used + (unsigned int)(((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+	if (offset > self->buffer.length || self->buffer.length - offset < size) {
+		return res;
+	}
+
+	self->used = offset + size;
+	res.data.data = (void*)((uint8_t *) self->buffer.data + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result inline_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	res = inline_bump(self, size, INLINE_ALLOC_ALIGN);
+	if (res.status != ERROR_OK) {
+		return ALLOC(self->inside_methods, size);
+	}
+
+	return res;
+}
+
+function Result inline_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	res = inline_bump(self, size, alignment);
+	if (res.status != ERROR_OK) {
+		return ALLOC_ALIGNED(self->inside_methods, size, alignment);
+	}
+
+	return res;
+}
+
+// The buffer is reused after frees, so only the parent can skip clearing
+function Result inline_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	res = inline_bump(self, size, INLINE_ALLOC_ALIGN);
+	if (res.status != ERROR_OK) {
+		return ALLOC_ZEROED(self->inside_methods, size);
+	}
+	memset(res.data.data, 0, res.data.length);
+
+	return res;
+}
+
+// Buffer allocations other than the last one are only reclaimed by FREEALL
+function Result inline_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	if (!inline_in_buffer(self, ptr)) {
+		return FREE(self->inside_methods, ptr);
+	}
+
+	if (inline_is_last(self, ptr)) {
+		self->used = (uint8_t *) ptr.data - (uint8_t *) self->buffer.data;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result inline_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	InlineAllocator *self;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	if (!inline_in_buffer(self, ptr)) {
+		return RESIZE(self->inside_methods, ptr, size);
+	}
+
+	if (inline_is_last(self, ptr)) {
+		offset = (uint8_t *) ptr.data - (uint8_t *) self->buffer.data;
+		if (self->buffer.length - offset < size) {
+			return res;
+		}
+		self->used = offset + size;
+	} else if (size > ptr.length) {
+		return res;
+	}
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Memory that has already moved to the parent stays there
+function Result inline_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	if (!inline_in_buffer(self, ptr)) {
+		return REALLOC(self->inside_methods, ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+// Only resets the buffer. Allocations that overflowed to the parent must
+// still be freed individually.
+function Result inline_freeall(Allocator *allocator) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	((InlineAllocator *) allocator)->used = 0;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result inline_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	InlineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (InlineAllocator *) allocator;
+	if (!SLICE_WITHIN(self->buffer, ptr)) {
+		return OWNS(self->inside_methods, ptr);
+	}
+
+	res.status = ERROR_OK;
+	res.data = ptr;
+	return res;
+}
+
+Result new_inline_allocator(InlineAllocator *self, Slice buffer, Allocator *parent) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || parent == 0 || buffer.data == 0) {
+		return res;
+	}
+
+	self->inside_methods = parent;
+	self->buffer = buffer;
+	self->used = 0;
+
+	self->outside_methods.alloc = inline_alloc;
+	self->outside_methods.alloc_aligned = inline_alloc_aligned;
+	self->outside_methods.alloc_zeroed = inline_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = inline_realloc;
+	self->outside_methods.resize = inline_resize;
+	self->outside_methods.free = inline_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = inline_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = inline_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(InlineAllocator);
+	return res;
+}
+
+Result deinit_inline_allocator(InlineAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	self->used = 0;
+	SET_NULL_SLICE(self->buffer);
+
+	res.status = ERROR_OK;
+	return res;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define INLINE_ALLOC_ALIGN 8
+
+struct inline_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Slice buffer;
+	unsigned int used;
+};
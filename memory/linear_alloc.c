@@ -25,29 +25,120 @@ function Result basic_linear_alloc(Allocator* allocator, unsigned int size) {
     return res;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-function Result basic_linear_realloc(Allocator* allocator, Slice ptr, unsigned int size) {
-    // TODO: implement more result statuses
+// The padding in front of an aligned allocation is skipped over
+function Result basic_linear_alloc_aligned(Allocator* allocator, unsigned int size, unsigned int alignment) {
     Result res;
+    BasicLinearAllocator *linear;
+    unsigned int padding;
+    BASE_ERROR_RESULT(res);
+
+    if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+        return res;
+    }
+
+    linear = (BasicLinearAllocator*) allocator;
+    padding = (alignment - ((uintptr_t)linear->current.data & (alignment - 1))) & (alignment - 1);
+    if (padding > linear->current.length || size > linear->current.length - padding) {
+        return res;
+    }
+
+    linear->current.length -= padding;
+    linear->current.data = (void*)((uint8_t*)linear->current.data + padding);
+    return basic_linear_alloc(allocator, size);
+}
+
+// Claims the whole batch with one bump and carves it up front to back
+function Result basic_linear_alloc_batch(Allocator* allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+    Result res;
+    BasicLinearAllocator *linear;
+    unsigned int total;
+    BASE_ERROR_RESULT(res);
+
+    if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+        return res;
+    }
+
+    linear = (BasicLinearAllocator*) allocator;
+    total = 0;
+    for (unsigned int index = 0; index < count; index++) {
+        if (sizes[index] == 0 || sizes[index] > linear->current.length - total) {
+            return res;
+        }
+        total += sizes[index];
+    }
+
+    for (unsigned int index = 0; index < count; index++) {
+        out[index] = slice_sub(linear->current, 0, sizes[index]);
+        linear->current.length -= sizes[index];
+        linear->current.data = (void*)((uint8_t*)linear->current.data + sizes[index]);
+    }
+
     res.status = ERROR_OK;
-		SET_NULL_SLICE(res.data);
+    res.data.data = out;
+    res.data.length = count * sizeof(Slice);
+    return res;
+}
+
+function void basic_linear_touch(BasicLinearAllocator *linear) {
+    unsigned int used = linear->buffer.length - linear->current.length;
 
+    if (used > linear->high_water) {
+        linear->high_water = used;
+    }
+}
+
+// Only the most recent allocation can grow; any allocation can shrink, but
+// only the most recent one gives its tail back.
+function Result basic_linear_resize(Allocator* allocator, Slice ptr, unsigned int size) {
+    Result res;
+    BasicLinearAllocator *linear;
+    BASE_ERROR_RESULT(res);
+
+    if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+        return res;
+    }
+
+    linear = (BasicLinearAllocator*) allocator;
+    if ((uint8_t*)ptr.data + ptr.length == (uint8_t*)linear->current.data) {
+        if (size > ptr.length && size - ptr.length > linear->current.length) {
+            return res;
+        }
+        basic_linear_touch(linear);
+        linear->current.data = (void*)((uint8_t*)ptr.data + size);
+        linear->current.length = linear->current.length + ptr.length - size;
+    } else if (size > ptr.length) {
+        return res;
+    }
+
+    res.data.data = ptr.data;
+    res.data.length = size;
+    res.status = ERROR_OK;
     return res;
 }
-#pragma GCC diagnostic pop
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
+// Only the most recent allocation is given back; freeing any other one is
+// a no-op until FREEALL.
 function Result basic_linear_free(Allocator* allocator, Slice ptr) {
-    // TODO: implement more result statuses
     Result res;
-    res.status = ERROR_OK;
-		SET_NULL_SLICE(res.data);
+    BasicLinearAllocator *linear;
+    BASE_ERROR_RESULT(res);
+
+    if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+        return res;
+    }
+
+    linear = (BasicLinearAllocator*) allocator;
+    if ((uint8_t*)ptr.data + ptr.length == (uint8_t*)linear->current.data &&
+        SLICE_WITHIN(linear->buffer, ptr)) {
+        basic_linear_touch(linear);
+        linear->current.data = ptr.data;
+        linear->current.length += ptr.length;
+    }
 
+    SET_NULL_SLICE(res.data);
+    res.status = ERROR_OK;
     return res;
 }
-#pragma GCC diagnostic pop
 
 function Result basic_linear_freeall(Allocator *allocator) {
     Result res;
@@ -59,7 +150,12 @@ function Result basic_linear_freeall(Allocator *allocator) {
     }
 
     linear = (BasicLinearAllocator*) allocator;
+    basic_linear_touch(linear);
     linear->current = linear->buffer;
+    if (trim_policy_due(&linear->trim, &linear->idle_resets, linear->high_water)) {
+        basic_linear_trim(linear);
+    }
+    linear->high_water = 0;
 
     res.status = ERROR_OK;
 
@@ -83,6 +179,85 @@ function Result basic_linear_clone(Allocator *allocator, Slice ptr) {
     return res;
 }
 
+function Result basic_linear_owns(Allocator* allocator, Slice ptr) {
+    Result res;
+    BasicLinearAllocator *linear;
+    BASE_ERROR_RESULT(res);
+
+    if (allocator == 0 || ptr.data == 0) {
+        return res;
+    }
+
+    linear = (BasicLinearAllocator*) allocator;
+    if (SLICE_WITHIN(linear->buffer, ptr)) {
+        res.status = ERROR_OK;
+        res.data = ptr;
+    }
+    return res;
+}
+
+ArenaMark basic_linear_mark(BasicLinearAllocator *linear) {
+    ArenaMark mark = { 0, 0 };
+
+    if (linear == 0) {
+        return mark;
+    }
+
+    mark.used = linear->buffer.length - linear->current.length;
+    return mark;
+}
+
+Result basic_linear_rewind(BasicLinearAllocator *linear, ArenaMark mark) {
+    Result res;
+    BASE_ERROR_RESULT(res);
+
+    if (linear == 0 || mark.used > linear->buffer.length) {
+        return res;
+    }
+
+    basic_linear_touch(linear);
+    linear->current.data = (void*)((uint8_t*)linear->buffer.data + mark.used);
+    linear->current.length = linear->buffer.length - mark.used;
+
+    res.status = ERROR_OK;
+    return res;
+}
+
+Result basic_linear_set_trim_policy(BasicLinearAllocator *linear, TrimPolicy policy) {
+    Result res;
+    BASE_ERROR_RESULT(res);
+
+    if (linear == 0) {
+        return res;
+    }
+
+    linear->trim = policy;
+    linear->idle_resets = 0;
+
+    res.status = ERROR_OK;
+    return res;
+}
+
+Result basic_linear_trim(BasicLinearAllocator *linear) {
+    Result res;
+    Slice unused;
+    size_t used;
+    BASE_ERROR_RESULT(res);
+
+    if (linear == 0) {
+        return res;
+    }
+
+    used = linear->buffer.length - linear->current.length;
+    if (used < linear->trim.retain) {
+        used = linear->trim.retain < linear->buffer.length ? linear->trim.retain : linear->buffer.length;
+    }
+
+    unused.data = (void*)((uint8_t*)linear->buffer.data + used);
+    unused.length = linear->buffer.length - used;
+    return trim_pages(unused, linear->trim.advice);
+}
+
 Result new_basic_linear_allocator(Allocator* allocator, unsigned int max_size) {
     Result res;
     BasicLinearAllocator *linear;
@@ -118,13 +293,22 @@ Result new_basic_linear_allocator(Allocator* allocator, unsigned int max_size) {
     linear->buffer = res.data;
     linear->current = res.data;
     linear->inside_methods = allocator;
+    memset(&linear->trim, 0, sizeof(TrimPolicy));
+    linear->high_water = 0;
+    linear->idle_resets = 0;
 
     linear->outside_methods.alloc = basic_linear_alloc;
-    linear->outside_methods.realloc = basic_linear_realloc;
+    linear->outside_methods.alloc_aligned = basic_linear_alloc_aligned;
+    linear->outside_methods.alloc_zeroed = standard_alloc_zeroed;
+    linear->outside_methods.alloc_batch = basic_linear_alloc_batch;
+    linear->outside_methods.realloc = standard_realloc;
+    linear->outside_methods.resize = basic_linear_resize;
     linear->outside_methods.free = basic_linear_free;
+    linear->outside_methods.free_batch = standard_free_batch;
     linear->outside_methods.freeall = basic_linear_freeall;
     linear->outside_methods.clone = basic_linear_clone;
     linear->outside_methods.slice_split = standard_slice_split;
+    linear->outside_methods.owns = basic_linear_owns;
 
     res.data.data = linear;
     res.data.length = sizeof(BasicLinearAllocator);
@@ -155,65 +339,303 @@ Result deinit_basic_linear_allocator(BasicLinearAllocator* linear) {
     return res;
 }
 
-#define SET_LINEAR_BLOCK(block, ptr) \
-block->mem = ptr;\
-block->next = 0
+function unsigned int linear_block_priority(LinearBlock *block) {
+	uint64_t key = (uint64_t)(uintptr_t) block;
 
-typedef struct linear_block_s LinearBlock;
-struct linear_block_s {
-	Slice mem;
-	LinearBlock *next;
-};
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (unsigned int) key;
+}
 
-typedef struct {
-	Allocator outside_methods;
-	Allocator *inside_methods;
-	Slice buffer;
-	LinearBlock *available;
-} LinearAllocator;
+function int linear_block_before(enum linear_tree tree, LinearBlock *a, LinearBlock *b) {
+	if (tree == LINEAR_BY_SIZE && a->length != b->length) {
+		return a->length < b->length;
+	}
+	return a < b;
+}
 
-function Result linear_allocation_from_block(LinearBlock *self, unsigned int size) {
-	Result res;
-	BASE_ERROR_RESULT(res);
+// Treap helpers: both trees share the nodes, each through its own children.
+function void linear_tree_split(enum linear_tree tree, LinearBlock *root, LinearBlock *key, LinearBlock **left, LinearBlock **right) {
+	if (root == 0) {
+		*left = 0;
+		*right = 0;
+		return;
+	}
 
-	if (self->mem.length >= size) {
-		res.data.length = size;
-		res.data.data = self->mem.data;
-		res.status = ERROR_OK;
+	if (linear_block_before(tree, root, key)) {
+		linear_tree_split(tree, root->children[tree][1], key, &root->children[tree][1], right);
+		*left = root;
+	} else {
+		linear_tree_split(tree, root->children[tree][0], key, left, &root->children[tree][0]);
+		*right = root;
+	}
+}
 
-		self->mem.data = (void*)((uint8_t *)self->mem.data + size);
-		self->mem.length -= size;
+function LinearBlock *linear_tree_merge(enum linear_tree tree, LinearBlock *left, LinearBlock *right) {
+	if (left == 0) {
+		return right;
+	}
+	if (right == 0) {
+		return left;
 	}
 
-	return res;
+	if (left->priority > right->priority) {
+		left->children[tree][1] = linear_tree_merge(tree, left->children[tree][1], right);
+		return left;
+	}
+	right->children[tree][0] = linear_tree_merge(tree, left, right->children[tree][0]);
+	return right;
+}
+
+function void linear_tree_insert(LinearAllocator *self, enum linear_tree tree, LinearBlock *block) {
+	LinearBlock *left, *right;
+
+	block->children[tree][0] = 0;
+	block->children[tree][1] = 0;
+	linear_tree_split(tree, self->roots[tree], block, &left, &right);
+	self->roots[tree] = linear_tree_merge(tree, linear_tree_merge(tree, left, block), right);
+}
+
+function void linear_tree_remove(LinearAllocator *self, enum linear_tree tree, LinearBlock *block) {
+	LinearBlock **link = &self->roots[tree];
+
+	while (*link != 0 && *link != block) {
+		link = &(*link)->children[tree][linear_block_before(tree, block, *link) ? 0 : 1];
+	}
+	if (*link == 0) {
+		return;
+	}
+
+	*link = linear_tree_merge(tree, block->children[tree][0], block->children[tree][1]);
+}
+
+// Smallest free block of at least `length` bytes
+function LinearBlock *linear_best_fit(LinearAllocator *self, unsigned int length) {
+	LinearBlock *node = self->roots[LINEAR_BY_SIZE];
+	LinearBlock *best = 0;
+
+	while (node != 0) {
+		if (node->length >= length) {
+			best = node;
+			node = node->children[LINEAR_BY_SIZE][0];
+		} else {
+			node = node->children[LINEAR_BY_SIZE][1];
+		}
+	}
+
+	return best;
+}
+
+function void linear_reset(LinearAllocator *self) {
+	LinearBlock *block = (LinearBlock *) self->memory.data;
+
+	block->length = self->memory.length;
+	block->priority = linear_block_priority(block);
+	self->roots[LINEAR_BY_ADDRESS] = 0;
+	self->roots[LINEAR_BY_SIZE] = 0;
+	linear_tree_insert(self, LINEAR_BY_ADDRESS, block);
+	linear_tree_insert(self, LINEAR_BY_SIZE, block);
+
+	self->bytes_requested = 0;
+	self->bytes_reserved = 0;
+	self->free_blocks = 1;
+}
+
+function void linear_note_peak(LinearAllocator *self) {
+	if (self->bytes_reserved > self->peak_reserved) {
+		self->peak_reserved = self->bytes_reserved;
+	}
 }
 
 function Result linear_alloc(Allocator *allocator, unsigned int size) {
 	Result res;
 	LinearAllocator *self;
+	LinearBlock *block;
+	unsigned int length;
 	BASE_ERROR_RESULT(res);
 
-	if (allocator == 0 || size == 0) {
+	if (allocator == 0 || size == 0 || size > UINT32_MAX - 2 * sizeof(LinearBlock)) {
 		return res;
 	}
 
 	self = (LinearAllocator*) allocator;
-	LinearBlock *current = self->available;
-	while (current != 0) {
-		if (current->mem.length >= size) {
-			return linear_allocation_from_block(current, size);
+	length = LINEAR_BLOCK_LENGTH(size);
+
+	// A remainder must be able to hold its own node, otherwise it would be lost
+	block = linear_best_fit(self, length);
+	if (block != 0 && block->length != length && block->length - length < sizeof(LinearBlock)) {
+		block = linear_best_fit(self, length + sizeof(LinearBlock));
+	}
+	if (block == 0) {
+		return res;
+	}
+
+	linear_tree_remove(self, LINEAR_BY_SIZE, block);
+	if (block->length == length) {
+		linear_tree_remove(self, LINEAR_BY_ADDRESS, block);
+		self->free_blocks--;
+		res.data.data = (void*) block;
+	} else {
+		// Carve from the tail so the node keeps its place in the address tree
+		block->length -= length;
+		linear_tree_insert(self, LINEAR_BY_SIZE, block);
+		res.data.data = (void*)((uint8_t *) block + block->length);
+	}
+	self->bytes_requested += size;
+	self->bytes_reserved += length;
+	linear_note_peak(self);
+
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Closest free neighbours on either side of an address
+function void linear_neighbours(LinearAllocator *self, uint8_t *address, LinearBlock **previous, LinearBlock **next) {
+	LinearBlock *node = self->roots[LINEAR_BY_ADDRESS];
+
+	*previous = 0;
+	*next = 0;
+	while (node != 0) {
+		if ((uint8_t *) node < address) {
+			*previous = node;
+			node = node->children[LINEAR_BY_ADDRESS][1];
+		} else {
+			*next = node;
+			node = node->children[LINEAR_BY_ADDRESS][0];
 		}
-		current = current->next;
 	}
-	
+}
+
+// Returns a range to the free trees, coalescing it with adjacent neighbours.
+// The successor is unlinked first as a short range's node may overlap it.
+function void linear_release(LinearAllocator *self, uint8_t *start, unsigned int length, LinearBlock *previous, LinearBlock *next) {
+	LinearBlock *block;
+
+	if (next != 0 && (uint8_t *) next == start + length) {
+		linear_tree_remove(self, LINEAR_BY_ADDRESS, next);
+		linear_tree_remove(self, LINEAR_BY_SIZE, next);
+		length += next->length;
+		self->free_blocks--;
+	}
+
+	if (previous != 0 && (uint8_t *) previous + previous->length == start) {
+		block = previous;
+		linear_tree_remove(self, LINEAR_BY_SIZE, block);
+		block->length += length;
+	} else {
+		block = (LinearBlock *) start;
+		block->length = length;
+		block->priority = linear_block_priority(block);
+		linear_tree_insert(self, LINEAR_BY_ADDRESS, block);
+		self->free_blocks++;
+	}
+	linear_tree_insert(self, LINEAR_BY_SIZE, block);
+}
+
+function int linear_owns_range(LinearAllocator *self, uint8_t *start, unsigned int length) {
+	uint8_t *memory_min = (uint8_t *) self->memory.data;
+	uint8_t *memory_max = memory_min + self->memory.length;
+
+	return start >= memory_min && start + length <= memory_max && (start - memory_min) % LINEAR_GRANULE == 0;
+}
+
+// Places an aligned allocation as high in the block as a whole remainder
+// allows, returning its start or 0 if the block cannot hold it.
+function uint8_t *linear_aligned_start(LinearBlock *block, unsigned int length, unsigned int alignment) {
+	uintptr_t end, start;
+
+	if (block == 0 || block->length < length) {
+		return 0;
+	}
+
+	end = (uintptr_t) block + block->length;
+	start = (end - length) & ~(uintptr_t)(alignment - 1);
+	if (end - start - length != 0 && end - start - length < sizeof(LinearBlock)) {
+		if (end - (uintptr_t) block < length + sizeof(LinearBlock)) {
+			return 0;
+		}
+		start = (end - length - sizeof(LinearBlock)) & ~(uintptr_t)(alignment - 1);
+	}
+
+	if (start < (uintptr_t) block) {
+		return 0;
+	}
+	if (start != (uintptr_t) block && start - (uintptr_t) block < sizeof(LinearBlock)) {
+		return 0;
+	}
+
+	return (uint8_t *) start;
+}
+
+function Result linear_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	LinearAllocator *self;
+	LinearBlock *block, *rest;
+	uint8_t *start, *end;
+	unsigned int length;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+	if (alignment <= LINEAR_GRANULE) {
+		return linear_alloc(allocator, size);
+	}
+	if (size > UINT32_MAX - 2 * sizeof(LinearBlock) - alignment) {
+		return res;
+	}
+
+	self = (LinearAllocator *) allocator;
+	length = LINEAR_BLOCK_LENGTH(size);
+
+	// The best fit may be misaligned; a block with room for the worst
+	// padding on both sides always works.
+	block = linear_best_fit(self, length);
+	start = linear_aligned_start(block, length, alignment);
+	if (start == 0) {
+		block = linear_best_fit(self, length + alignment + 2 * sizeof(LinearBlock));
+		start = linear_aligned_start(block, length, alignment);
+	}
+	if (start == 0) {
+		return res;
+	}
+
+	end = (uint8_t *) block + block->length;
+	linear_tree_remove(self, LINEAR_BY_SIZE, block);
+	if (start == (uint8_t *) block) {
+		linear_tree_remove(self, LINEAR_BY_ADDRESS, block);
+		self->free_blocks--;
+	} else {
+		block->length = start - (uint8_t *) block;
+		linear_tree_insert(self, LINEAR_BY_SIZE, block);
+	}
+
+	if (start + length != end) {
+		rest = (LinearBlock *)(start + length);
+		rest->length = end - (start + length);
+		rest->priority = linear_block_priority(rest);
+		linear_tree_insert(self, LINEAR_BY_ADDRESS, rest);
+		linear_tree_insert(self, LINEAR_BY_SIZE, rest);
+		self->free_blocks++;
+	}
+	self->bytes_requested += size;
+	self->bytes_reserved += length;
+	linear_note_peak(self);
+
+	res.data.data = (void*) start;
+	res.data.length = size;
+	res.status = ERROR_OK;
 	return res;
 }
 
 function Result linear_free(Allocator *allocator, Slice ptr) {
 	Result res;
 	LinearAllocator *self;
-	uint8_t *buffer_min, *buffer_max, *ptr_min, *ptr_max;
-	uint8_t *current_min, *current_max;
+	LinearBlock *previous, *next;
+	uint8_t *ptr_min, *ptr_max;
+	unsigned int length;
 	BASE_ERROR_RESULT(res);
 
 	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
@@ -221,181 +643,318 @@ function Result linear_free(Allocator *allocator, Slice ptr) {
 	}
 
 	self = (LinearAllocator *) allocator;
+	length = LINEAR_BLOCK_LENGTH(ptr.length);
 	ptr_min = (uint8_t*) ptr.data;
-	ptr_max = ptr_min + ptr.length;
-	buffer_min = (uint8_t*) self->buffer.data;
-	buffer_max = buffer_min + self->buffer.length;
+	ptr_max = ptr_min + length;
+	if (!linear_owns_range(self, ptr_min, length)) {
+		return res;
+	}
 
-	if (ptr_min < buffer_min || ptr_max > buffer_max) {
+	// Overlapping a free block means a double or invalid free
+	linear_neighbours(self, ptr_min, &previous, &next);
+	if (previous != 0 && (uint8_t *) previous + previous->length > ptr_min) {
+		return res;
+	}
+	if (next != 0 && (uint8_t *) next < ptr_max) {
 		return res;
 	}
 
-	LinearBlock *current = self->available;
-	current_min = (uint8_t *) current->mem.data;
-	current_max = current_min + current->mem.length;
-	while (current != 0) {
-		if (current_min == ptr_max) {
-			// ptr is to the left of current
-			current->mem.data = ptr.data;
-			current->mem.length += ptr.length;
-			res.status = ERROR_OK;
-			return res;
-		} else if (current_max == ptr_min) {
-			// ptr is to the right of current
-			current->mem.length += ptr.length;
-			res.status = ERROR_OK;
-			return res;
-		}
-		current = current->next;
+	linear_release(self, ptr_min, length, previous, next);
+	self->bytes_requested -= ptr.length;
+	self->bytes_reserved -= length;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Grows into the free block that directly follows the allocation, and
+// shrinks when the released tail can stand as (or join) a free block.
+function Result linear_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	LinearAllocator *self;
+	LinearBlock *previous, *next, *rest;
+	uint8_t *ptr_min, *ptr_max;
+	unsigned int length, new_length, delta;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0 || size > UINT32_MAX - 2 * sizeof(LinearBlock)) {
+		return res;
 	}
-	// ptr does not fit nicely into any other blocks
 
-	LinearBlock *new_block;
-	current = self->available;
-	res = ALLOC(allocator, sizeof(LinearBlock));
-	if (res.status != ERROR_OK) {
+	self = (LinearAllocator *) allocator;
+	length = LINEAR_BLOCK_LENGTH(ptr.length);
+	new_length = LINEAR_BLOCK_LENGTH(size);
+	ptr_min = (uint8_t*) ptr.data;
+	ptr_max = ptr_min + length;
+	if (!linear_owns_range(self, ptr_min, length)) {
 		return res;
 	}
-	if (res.data.length != sizeof(LinearBlock)) {
-		// TODO: this case will leak memory!
-		BASE_ERROR_RESULT(res);
+
+	linear_neighbours(self, ptr_min, &previous, &next);
+	if (next != 0 && (uint8_t *) next < ptr_max) {
 		return res;
 	}
+	if (next != 0 && (uint8_t *) next != ptr_max) {
+		next = 0;
+	}
 
-	new_block = (LinearBlock *) res.data.data;
-	BASE_ERROR_RESULT(res);
-	SET_LINEAR_BLOCK(new_block, ptr);
-
-	while (current->next != 0) {
-		current_min = (uint8_t *) current->mem.data;
-		current_max = current_min + current->mem.length;
-		if (ptr_min < current_min) {
-			self->available = new_block;
-			new_block->next = current;
-			res.status = ERROR_OK;
+	if (new_length > length) {
+		delta = new_length - length;
+		if (next == 0 || next->length < delta || (next->length != delta && next->length - delta < sizeof(LinearBlock))) {
 			return res;
 		}
 
-		current = current->next;
+		linear_tree_remove(self, LINEAR_BY_ADDRESS, next);
+		linear_tree_remove(self, LINEAR_BY_SIZE, next);
+		if (next->length == delta) {
+			self->free_blocks--;
+		} else {
+			rest = (LinearBlock *)((uint8_t *) next + delta);
+			rest->length = next->length - delta;
+			rest->priority = linear_block_priority(rest);
+			linear_tree_insert(self, LINEAR_BY_ADDRESS, rest);
+			linear_tree_insert(self, LINEAR_BY_SIZE, rest);
+		}
+	} else if (new_length < length) {
+		delta = length - new_length;
+		if (next == 0 && delta < sizeof(LinearBlock)) {
+			return res;
+		}
+		linear_release(self, ptr_min + new_length, delta, 0, next);
 	}
 
-	current_min = (uint8_t *) current->mem.data;
-	current_max = current_min + current->mem.length;
-	if (ptr_min < current_min) {
-		self->available = new_block;
-		new_block->next = current;
-		res.status = ERROR_OK;
+	self->bytes_requested += size - ptr.length;
+	self->bytes_reserved += new_length - length;
+	linear_note_peak(self);
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Blocks are carved from the tail of the free space, so the retained bytes
+// are the last ones of the buffer. Block headers are never released.
+function int linear_trim_blocks(LinearAllocator *self, LinearBlock *node, uint8_t *limit) {
+	Slice interior;
+	uint8_t *end;
+	int failed;
+
+	if (node == 0) {
+		return 0;
+	}
+
+	failed = linear_trim_blocks(self, node->children[LINEAR_BY_ADDRESS][0], limit);
+	failed |= linear_trim_blocks(self, node->children[LINEAR_BY_ADDRESS][1], limit);
+
+	interior.data = (void*)&node[1];
+	end = (uint8_t *) node + node->length;
+	if (end > limit) {
+		end = limit;
+	}
+	if (end > (uint8_t *) interior.data) {
+		interior.length = end - (uint8_t *) interior.data;
+		failed |= trim_pages(interior, self->trim.advice).status != ERROR_OK;
+	}
+
+	return failed;
+}
+
+Result linear_allocator_trim(Allocator *allocator) {
+	Result res;
+	LinearAllocator *self;
+	uint8_t *limit;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
 		return res;
 	}
 
-	if (ptr_min > (uint8_t *) current->mem.data) {
-		new_block->next = 0;
-		current->next = new_block;
-		res.status = ERROR_OK;
+	self = (LinearAllocator *) allocator;
+	limit = (uint8_t *) self->memory.data;
+	if (self->trim.retain < self->memory.length) {
+		limit += self->memory.length - self->trim.retain;
+	}
+	if (linear_trim_blocks(self, self->roots[LINEAR_BY_ADDRESS], limit)) {
 		return res;
 	}
 
+	res.status = ERROR_OK;
+	SET_NULL_SLICE(res.data);
+	return res;
+}
+
+Result linear_allocator_set_trim_policy(Allocator *allocator, TrimPolicy policy) {
+	Result res;
+	LinearAllocator *self;
 	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (LinearAllocator *) allocator;
+	self->trim = policy;
+	self->idle_resets = 0;
+
+	res.status = ERROR_OK;
 	return res;
 }
 
 function Result linear_freeall(Allocator *allocator) {
 	Result res;
+	LinearAllocator *self;
+	int due;
 	BASE_ERROR_RESULT(res);
 
 	if (allocator == 0) {
 		return res;
 	}
 
-	LinearAllocator *self = (LinearAllocator *) allocator;
-	self->available->mem.length = self->buffer.length - sizeof(LinearBlock);
-	self->available->mem.data = (void*)((uint8_t *)self->buffer.data + sizeof(LinearBlock));
-	self->available->next = 0;
+	self = (LinearAllocator *) allocator;
+	due = trim_policy_due(&self->trim, &self->idle_resets, self->peak_reserved);
+	linear_reset(self);
+	self->peak_reserved = 0;
+	if (due) {
+		linear_allocator_trim(allocator);
+	}
 
 	res.status = ERROR_OK;
 	return res;
 }
 
-Result init_linear_allocator(Allocator* allocator, unsigned int max_size) {
-    Result res;
-		LinearAllocator *self;
-		unsigned int buffer_size;
-    BASE_ERROR_RESULT(res);
+Result linear_allocator_stats(Allocator *allocator, FragmentationStats *stats) {
+	Result res;
+	LinearAllocator *self;
+	LinearBlock *node;
+	BASE_ERROR_RESULT(res);
 
-    if (allocator == 0 || max_size == 0) {
-        return res;
-    }
+	if (allocator == 0 || stats == 0) {
+		return res;
+	}
 
-		res = ALLOC(allocator, sizeof(LinearAllocator));
-		if (res.status != ERROR_OK) {
-			return res;
-		}
-		if (res.data.length != sizeof(LinearAllocator)) {
-			FREE(allocator, res.data);
-			BASE_ERROR_RESULT(res);
-			return res;
-		}
+	self = (LinearAllocator *) allocator;
+	stats->capacity = self->memory.length;
+	stats->bytes_requested = self->bytes_requested;
+	stats->bytes_reserved = self->bytes_reserved;
+	stats->bytes_free = self->memory.length - self->bytes_reserved;
+	stats->free_blocks = self->free_blocks;
+	stats->largest_free_block = 0;
+	for (node = self->roots[LINEAR_BY_SIZE]; node != 0; node = node->children[LINEAR_BY_SIZE][1]) {
+		stats->largest_free_block = node->length;
+	}
 
-		self = (LinearAllocator *) res.data.data;
-		self->inside_methods = allocator;
+	res.status = ERROR_OK;
+	res.data.data = stats;
+	res.data.length = sizeof(FragmentationStats);
+	return res;
+}
 
-		// Get the buffer
-		buffer_size = max_size + sizeof(LinearBlock); 
-		res = ALLOC(allocator, buffer_size);
-		if (res.status != ERROR_OK) {
-			res.data.data = self;
-			res.data.length = sizeof(LinearAllocator);
-			FREE(allocator, res.data);
-			return res;
-		}
-		if (res.data.length != buffer_size) {
-			FREE(allocator, res.data);
-			res.data.data = self;
-			res.data.length = sizeof(LinearAllocator);
-			FREE(allocator, res.data);
-			BASE_ERROR_RESULT(res);
-			return res;
-		}
-		self->buffer = res.data;
-
-		LinearBlock *low_block = (LinearBlock *) self->buffer.data;
-		low_block->mem.length = max_size;
-		low_block->mem.data = (void*)&low_block[1];
-		low_block->next = 0;
-		self->available = low_block;
-
-		self->outside_methods.alloc = linear_alloc;
-		self->outside_methods.free = linear_free;
-		self->outside_methods.realloc = standard_realloc;
-		self->outside_methods.freeall = linear_freeall;
-		self->outside_methods.clone = standard_clone;
-		self->outside_methods.slice_split = standard_slice_split;
-
-		// Linear allocator created successfully.
+function Result linear_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	if (linear_owns_range((LinearAllocator *) allocator, (uint8_t *) ptr.data, ptr.length)) {
 		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result init_linear_allocator(Allocator* allocator, unsigned int max_size) {
+	Result res;
+	LinearAllocator *self;
+	unsigned int memory_size, buffer_size;
+	uintptr_t start;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || max_size == 0 || max_size > UINT32_MAX - 2 * LINEAR_GRANULE) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(LinearAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(LinearAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (LinearAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	memset(&self->trim, 0, sizeof(TrimPolicy));
+	self->peak_reserved = 0;
+	self->idle_resets = 0;
+
+	// Get the buffer, with room to align the first block
+	memory_size = LINEAR_BLOCK_LENGTH(max_size);
+	buffer_size = memory_size + LINEAR_GRANULE;
+	res = ALLOC(allocator, buffer_size);
+	if (res.status != ERROR_OK) {
+		res.data.data = self;
 		res.data.length = sizeof(LinearAllocator);
-		res.data.data = (void*)self;
-    return res;
+		FREE(allocator, res.data);
+		return res;
+	}
+	if (res.data.length != buffer_size) {
+		FREE(allocator, res.data);
+		res.data.data = self;
+		res.data.length = sizeof(LinearAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->buffer = res.data;
+
+	start = ((uintptr_t) self->buffer.data + LINEAR_GRANULE - 1) & ~(uintptr_t)(LINEAR_GRANULE - 1);
+	self->memory.data = (void*) start;
+	self->memory.length = memory_size;
+	linear_reset(self);
+
+	self->outside_methods.alloc = linear_alloc;
+	self->outside_methods.alloc_aligned = linear_alloc_aligned;
+	self->outside_methods.alloc_zeroed = standard_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.free = linear_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = linear_resize;
+	self->outside_methods.freeall = linear_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = linear_owns;
+
+	// Linear allocator created successfully.
+	res.status = ERROR_OK;
+	res.data.length = sizeof(LinearAllocator);
+	res.data.data = (void*)self;
+	return res;
 }
 
 Result deinit_linear_allocator(Allocator* linear) {
-    Result res;
-		LinearAllocator *self;
-    BASE_ERROR_RESULT(res);
+	Result res;
+	LinearAllocator *self;
+	BASE_ERROR_RESULT(res);
 
-    if (linear == 0) {
-        return res;
-    }
+	if (linear == 0) {
+		return res;
+	}
 
-		self = (LinearAllocator *) linear;
-	
-		res = FREE(self->inside_methods, self->buffer);
-		if (res.status != ERROR_OK)	{
-			return res;
-		}
+	self = (LinearAllocator *) linear;
 
-		res.data.data = (void*) self;
-		res.data.length = sizeof(LinearAllocator);
-		res = FREE(self->inside_methods, res.data);
+	res = FREE(self->inside_methods, self->buffer);
+	if (res.status != ERROR_OK)	{
 		return res;
+	}
+
+	res.data.data = (void*) self;
+	res.data.length = sizeof(LinearAllocator);
+	res = FREE(self->inside_methods, res.data);
+	return res;
 }
@@ -8,12 +8,44 @@ struct basic_linear_alloc_s {
   Allocator *inside_methods;
   Slice buffer;
   Slice current;
+  TrimPolicy trim;
+  // Most bytes in use since the last reset; only caught up when the bump
+  // pointer moves back, since that is the only time it can be lost
+  unsigned int high_water;
+  unsigned int idle_resets;
 };
 
+// Free blocks live inside the buffer and are indexed twice: by address to
+// find neighbours when coalescing, and by (length, address) for best fit.
+enum linear_tree {
+  LINEAR_BY_ADDRESS,
+  LINEAR_BY_SIZE,
+};
+
+typedef struct linear_block_s LinearBlock;
+struct linear_block_s {
+  LinearBlock *children[2][2];
+  unsigned int length;
+  unsigned int priority;
+};
+
+// Allocations are rounded to the granule and never smaller than a block, so
+// every freed range can hold its own tree node.
+#define LINEAR_GRANULE 8
+#define LINEAR_BLOCK_LENGTH(size) \
+  ((size) < sizeof(LinearBlock) ? sizeof(LinearBlock) : \
+  (((size) + LINEAR_GRANULE - 1) & ~(LINEAR_GRANULE - 1)))
+
 struct linear_alloc_s {
   Allocator outside_methods;
   Allocator *inside_methods;
   Slice buffer;
-  unsigned int position;
-  ArrayList free_blocks;
+  Slice memory;
+  LinearBlock *roots[2];
+  unsigned int bytes_requested;
+  unsigned int bytes_reserved;
+  unsigned int free_blocks;
+  TrimPolicy trim;
+  unsigned int peak_reserved;
+  unsigned int idle_resets;
 };
@@ -0,0 +1,613 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// All functions taking the depot or the parent allocator expect self->lock
+// to be held by the caller.
+function Magazine *magazine_take_empty(MagazineAllocator *self, MagazineDepot *depot) {
+	Result res;
+	Magazine *magazine;
+
+	magazine = depot->empty;
+	if (magazine != 0) {
+		depot->empty = magazine->next;
+		return magazine;
+	}
+
+	res = ALLOC(self->inside_methods, sizeof(Magazine));
+	if (res.status != ERROR_OK) {
+		return 0;
+	}
+	if (res.data.length != sizeof(Magazine)) {
+		FREE(self->inside_methods, res.data);
+		return 0;
+	}
+
+	magazine = (Magazine *) res.data.data;
+	magazine->next = 0;
+	magazine->count = 0;
+	return magazine;
+}
+
+function void magazine_drain(MagazineAllocator *self, Magazine *magazine, unsigned int class_length) {
+	Slice round;
+
+	round.length = class_length;
+	while (magazine->count > 0) {
+		round.data = magazine->rounds[--magazine->count];
+		FREE(self->inside_methods, round);
+	}
+}
+
+function void magazine_destroy_list(MagazineAllocator *self, Magazine *magazine, unsigned int class_length) {
+	Magazine *next;
+	Slice s;
+
+	while (magazine != 0) {
+		next = magazine->next;
+		magazine_drain(self, magazine, class_length);
+		s.data = magazine;
+		s.length = sizeof(Magazine);
+		FREE(self->inside_methods, s);
+		magazine = next;
+	}
+}
+
+// Hands a thread's magazines back to the depot, draining the ones the depot
+// has no room for.
+function void magazine_cache_flush(MagazineAllocator *self, MagazineCache *cache) {
+	MagazineDepot *depot;
+	Magazine *magazines[2];
+
+	for (unsigned int index = 0; index < SIZE_CLASS_COUNT; index++) {
+		depot = &self->depots[index];
+		magazines[0] = cache->loaded[index];
+		magazines[1] = cache->previous[index];
+		cache->loaded[index] = 0;
+		cache->previous[index] = 0;
+
+		for (unsigned int slot = 0; slot < 2; slot++) {
+			if (magazines[slot] == 0) {
+				continue;
+			}
+			if (magazines[slot]->count > 0 && depot->full_count < MAGAZINE_DEPOT_LIMIT) {
+				magazines[slot]->next = depot->full;
+				depot->full = magazines[slot];
+				depot->full_count++;
+			} else {
+				magazine_drain(self, magazines[slot], size_class_length(index));
+				magazines[slot]->next = depot->empty;
+				depot->empty = magazines[slot];
+			}
+		}
+	}
+}
+
+function void magazine_cache_destroy(void *data) {
+	MagazineCache *cache, **link;
+	MagazineAllocator *self;
+	Slice s;
+
+	cache = (MagazineCache *) data;
+	self = cache->owner;
+
+	pthread_mutex_lock(&self->lock);
+	magazine_cache_flush(self, cache);
+	for (link = &self->caches; *link != 0; link = &(*link)->next) {
+		if (*link == cache) {
+			*link = cache->next;
+			break;
+		}
+	}
+	s.data = cache;
+	s.length = sizeof(MagazineCache);
+	FREE(self->inside_methods, s);
+	pthread_mutex_unlock(&self->lock);
+}
+
+function MagazineCache *magazine_get_cache(MagazineAllocator *self) {
+	Result res;
+	MagazineCache *cache;
+
+	cache = (MagazineCache *) pthread_getspecific(self->key);
+	if (cache != 0) {
+		return cache;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	res = ALLOC(self->inside_methods, sizeof(MagazineCache));
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+	if (res.data.length != sizeof(MagazineCache)) {
+		FREE(self->inside_methods, res.data);
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	cache = (MagazineCache *) res.data.data;
+	memset(cache, 0, sizeof(MagazineCache));
+	cache->owner = self;
+
+	// Bound before it is registered, so a failed bind leaves nothing behind
+	if (pthread_setspecific(self->key, cache) != 0) {
+		FREE(self->inside_methods, res.data);
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+	cache->next = self->caches;
+	self->caches = cache;
+	pthread_mutex_unlock(&self->lock);
+
+	return cache;
+}
+
+// Swaps an empty loaded magazine for a full one from the depot, or fills it
+// from the parent with a whole magazine worth of rounds under one lock.
+function Magazine *magazine_reload(MagazineAllocator *self, MagazineCache *cache, unsigned int index) {
+	Result res;
+	MagazineDepot *depot;
+	Magazine *loaded;
+	unsigned int class_length;
+
+	pthread_mutex_lock(&self->lock);
+	depot = &self->depots[index];
+	loaded = cache->loaded[index];
+
+	if (depot->full != 0) {
+		if (loaded != 0) {
+			loaded->next = depot->empty;
+			depot->empty = loaded;
+		}
+		loaded = depot->full;
+		depot->full = loaded->next;
+		depot->full_count--;
+		cache->loaded[index] = loaded;
+		pthread_mutex_unlock(&self->lock);
+		return loaded;
+	}
+
+	if (loaded == 0) {
+		loaded = magazine_take_empty(self, depot);
+		if (loaded == 0) {
+			pthread_mutex_unlock(&self->lock);
+			return 0;
+		}
+		cache->loaded[index] = loaded;
+	}
+
+	class_length = size_class_length(index);
+	while (loaded->count < MAGAZINE_ROUNDS) {
+		res = ALLOC(self->inside_methods, class_length);
+		if (res.status != ERROR_OK) {
+			break;
+		}
+		if (res.data.length != class_length) {
+			FREE(self->inside_methods, res.data);
+			break;
+		}
+		loaded->rounds[loaded->count++] = res.data.data;
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	return loaded->count > 0 ? loaded : 0;
+}
+
+// Swaps a full loaded magazine for an empty one, parking the full one in the
+// depot or draining it to the parent once the depot is at its limit.
+function Magazine *magazine_unload(MagazineAllocator *self, MagazineCache *cache, unsigned int index) {
+	MagazineDepot *depot;
+	Magazine *loaded;
+
+	pthread_mutex_lock(&self->lock);
+	depot = &self->depots[index];
+	loaded = cache->loaded[index];
+
+	if (loaded != 0) {
+		if (depot->full_count >= MAGAZINE_DEPOT_LIMIT) {
+			magazine_drain(self, loaded, size_class_length(index));
+			pthread_mutex_unlock(&self->lock);
+			return loaded;
+		}
+		loaded->next = depot->full;
+		depot->full = loaded;
+		depot->full_count++;
+	}
+
+	loaded = magazine_take_empty(self, depot);
+	cache->loaded[index] = loaded;
+	pthread_mutex_unlock(&self->lock);
+
+	return loaded;
+}
+
+function Result magazine_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	MagazineAllocator *self;
+	MagazineCache *cache;
+	Magazine *loaded, *previous;
+	unsigned int index;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	if (size > SIZE_CLASS_MAX) {
+		pthread_mutex_lock(&self->lock);
+		res = ALLOC(self->inside_methods, size);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	cache = magazine_get_cache(self);
+	if (cache == 0) {
+		return res;
+	}
+
+	index = size_class_index(size);
+	loaded = cache->loaded[index];
+	if (loaded == 0 || loaded->count == 0) {
+		previous = cache->previous[index];
+		if (previous != 0 && previous->count > 0) {
+			cache->previous[index] = loaded;
+			cache->loaded[index] = previous;
+			loaded = previous;
+		} else {
+			loaded = magazine_reload(self, cache, index);
+			if (loaded == 0) {
+				return res;
+			}
+		}
+	}
+
+	res.data.data = loaded->rounds[--loaded->count];
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result magazine_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	MagazineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	if (size > SIZE_CLASS_MAX) {
+		pthread_mutex_lock(&self->lock);
+		res = ALLOC_ZEROED(self->inside_methods, size);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	return standard_alloc_zeroed(allocator, size);
+}
+
+function Result magazine_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	MagazineAllocator *self;
+	MagazineCache *cache;
+	Magazine *loaded, *previous;
+	unsigned int index;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX) {
+		pthread_mutex_lock(&self->lock);
+		res = FREE(self->inside_methods, ptr);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	index = size_class_index(ptr.length);
+	cache = magazine_get_cache(self);
+	loaded = cache == 0 ? 0 : cache->loaded[index];
+	if (cache != 0 && (loaded == 0 || loaded->count == MAGAZINE_ROUNDS)) {
+		previous = cache->previous[index];
+		if (previous != 0 && previous->count < MAGAZINE_ROUNDS) {
+			cache->previous[index] = loaded;
+			cache->loaded[index] = previous;
+			loaded = previous;
+		} else {
+			loaded = magazine_unload(self, cache, index);
+		}
+	}
+
+	if (loaded == 0) {
+		ptr.length = size_class_length(index);
+		pthread_mutex_lock(&self->lock);
+		res = FREE(self->inside_methods, ptr);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	loaded->rounds[loaded->count++] = ptr.data;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Small sizes come from the thread's magazines; the large ones go to the
+// parent under a single acquisition of the lock.
+function Result magazine_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+	Result res;
+	MagazineAllocator *self;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	for (unsigned int index = 0; index < count; index++) {
+		SET_NULL_SLICE(out[index]);
+	}
+
+	for (unsigned int index = 0; index < count && !failed; index++) {
+		if (sizes[index] <= SIZE_CLASS_MAX) {
+			res = magazine_alloc(allocator, sizes[index]);
+			failed = res.status != ERROR_OK;
+			out[index] = res.data;
+		}
+	}
+
+	pthread_mutex_lock(&self->lock);
+	for (unsigned int index = 0; index < count && !failed; index++) {
+		if (sizes[index] > SIZE_CLASS_MAX) {
+			res = ALLOC(self->inside_methods, sizes[index]);
+			failed = res.status != ERROR_OK || res.data.length != sizes[index];
+			if (res.status == ERROR_OK) {
+				out[index] = res.data;
+			}
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	if (failed) {
+		for (unsigned int index = 0; index < count; index++) {
+			if (out[index].data != 0) {
+				magazine_free(allocator, out[index]);
+			}
+		}
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = out;
+	res.data.length = count * sizeof(Slice);
+	return res;
+}
+
+function Result magazine_free_batch(Allocator *allocator, Slice *ptrs, unsigned int count) {
+	Result res;
+	MagazineAllocator *self;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptrs == 0 || count == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	for (unsigned int index = count; index-- > 0;) {
+		if (ptrs[index].length <= SIZE_CLASS_MAX && magazine_free(allocator, ptrs[index]).status != ERROR_OK) {
+			failed = 1;
+		}
+	}
+
+	pthread_mutex_lock(&self->lock);
+	for (unsigned int index = count; index-- > 0;) {
+		if (ptrs[index].length > SIZE_CLASS_MAX && FREE(self->inside_methods, ptrs[index]).status != ERROR_OK) {
+			failed = 1;
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	BASE_ERROR_RESULT(res);
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
+
+function Result magazine_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	MagazineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX && size > SIZE_CLASS_MAX) {
+		pthread_mutex_lock(&self->lock);
+		res = RESIZE(self->inside_methods, ptr, size);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	if (
+		ptr.length <= SIZE_CLASS_MAX && size <= SIZE_CLASS_MAX &&
+		size_class_index(ptr.length) == size_class_index(size)
+	) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	}
+
+	return res;
+}
+
+function Result magazine_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	MagazineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX && size > SIZE_CLASS_MAX) {
+		pthread_mutex_lock(&self->lock);
+		res = REALLOC(self->inside_methods, ptr, size);
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+// Drains every cached round back to the parent, one FREE each. Worker
+// threads must not be using the allocator while this runs.
+function Result magazine_freeall(Allocator *allocator) {
+	Result res;
+	MagazineAllocator *self;
+	MagazineCache *cache;
+	MagazineDepot *depot;
+	Magazine *magazine;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	for (cache = self->caches; cache != 0; cache = cache->next) {
+		magazine_cache_flush(self, cache);
+	}
+	for (unsigned int index = 0; index < SIZE_CLASS_COUNT; index++) {
+		depot = &self->depots[index];
+		while (depot->full != 0) {
+			magazine = depot->full;
+			depot->full = magazine->next;
+			magazine_drain(self, magazine, size_class_length(index));
+			magazine->next = depot->empty;
+			depot->empty = magazine;
+		}
+		depot->full_count = 0;
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Every round, cached or not, is a parent allocation
+function Result magazine_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	MagazineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (MagazineAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res = OWNS(self->inside_methods, ptr);
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+Result new_magazine_allocator(Allocator *allocator) {
+	Result res;
+	MagazineAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(MagazineAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(MagazineAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (MagazineAllocator *) res.data.data;
+	if (pthread_key_create(&self->key, magazine_cache_destroy) != 0) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	pthread_mutex_init(&self->lock, 0);
+	self->inside_methods = allocator;
+	self->caches = 0;
+	memset(self->depots, 0, sizeof(self->depots));
+
+	self->outside_methods.alloc = magazine_alloc;
+	self->outside_methods.alloc_aligned = standard_alloc_aligned;
+	self->outside_methods.alloc_zeroed = magazine_alloc_zeroed;
+	self->outside_methods.alloc_batch = magazine_alloc_batch;
+	self->outside_methods.realloc = magazine_realloc;
+	self->outside_methods.resize = magazine_resize;
+	self->outside_methods.free = magazine_free;
+	self->outside_methods.free_batch = magazine_free_batch;
+	self->outside_methods.freeall = magazine_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = magazine_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(MagazineAllocator);
+	return res;
+}
+
+// Worker threads must have stopped using the allocator; caches of threads
+// that are still alive are released here instead of at thread exit.
+Result deinit_magazine_allocator(MagazineAllocator *self) {
+	Result res;
+	MagazineCache *cache;
+	unsigned int class_length;
+	Slice s;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	pthread_key_delete(self->key);
+
+	pthread_mutex_lock(&self->lock);
+	while (self->caches != 0) {
+		cache = self->caches;
+		self->caches = cache->next;
+		magazine_cache_flush(self, cache);
+		s.data = cache;
+		s.length = sizeof(MagazineCache);
+		FREE(self->inside_methods, s);
+	}
+	for (unsigned int index = 0; index < SIZE_CLASS_COUNT; index++) {
+		class_length = size_class_length(index);
+		magazine_destroy_list(self, self->depots[index].full, class_length);
+		magazine_destroy_list(self, self->depots[index].empty, class_length);
+	}
+	pthread_mutex_unlock(&self->lock);
+	pthread_mutex_destroy(&self->lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(MagazineAllocator);
+	return FREE(self->inside_methods, res.data);
+}
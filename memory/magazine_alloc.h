@@ -0,0 +1,39 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define MAGAZINE_ROUNDS 32
+#define MAGAZINE_DEPOT_LIMIT 8
+
+typedef struct magazine_s Magazine;
+struct magazine_s {
+	Magazine *next;
+	unsigned int count;
+	void *rounds[MAGAZINE_ROUNDS];
+};
+
+typedef struct {
+	Magazine *full;
+	Magazine *empty;
+	unsigned int full_count;
+} MagazineDepot;
+
+typedef struct magazine_cache_s MagazineCache;
+struct magazine_cache_s {
+	MagazineCache *next;
+	MagazineAllocator *owner;
+	Magazine *loaded[SIZE_CLASS_COUNT];
+	Magazine *previous[SIZE_CLASS_COUNT];
+};
+
+struct magazine_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	pthread_mutex_t lock;
+	pthread_key_t key;
+	MagazineCache *caches;
+	MagazineDepot depots[SIZE_CLASS_COUNT];
+};
@@ -0,0 +1,384 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// From <linux/mempolicy.h>, which is not always installed
+#define NUMA_MPOL_PREFERRED 1
+
+#define NUMA_ROUND(size, page) (((size_t)(size) + (page) - 1) & ~((size_t)(page) - 1))
+
+local int numa_nodes;
+local pthread_once_t numa_nodes_once = PTHREAD_ONCE_INIT;
+
+local _Atomic(NumaAllocator *) numa_registry[NUMA_MAX_NODES];
+local pthread_mutex_t numa_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The online list looks like "0-1,3"; node ids are dense enough in practice
+// that the highest one bounds the count.
+function void numa_discover_nodes(void) {
+	FILE *online;
+	int first, last;
+	char separator;
+
+	numa_nodes = 1;
+	online = fopen("/sys/devices/system/node/online", "r");
+	if (online == 0) {
+		return;
+	}
+
+	while (fscanf(online, "%d", &first) == 1) {
+		last = first;
+		separator = (char) fgetc(online);
+		if (separator == '-') {
+			if (fscanf(online, "%d", &last) != 1) {
+				break;
+			}
+			separator = (char) fgetc(online);
+		}
+		if (last >= numa_nodes) {
+			numa_nodes = last + 1;
+		}
+		if (separator != ',') {
+			break;
+		}
+	}
+	fclose(online);
+
+	if (numa_nodes > NUMA_MAX_NODES) {
+		numa_nodes = NUMA_MAX_NODES;
+	}
+}
+
+int numa_node_count(void) {
+	pthread_once(&numa_nodes_once, numa_discover_nodes);
+	return numa_nodes;
+}
+
+int numa_current_node(void) {
+	#ifdef SYS_getcpu
+	unsigned int cpu, node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, 0) == 0 && node < (unsigned int) numa_node_count()) {
+		return (int) node;
+	}
+	#endif
+
+	return 0;
+}
+
+// Preferred rather than strict binding: the pages are only faulted in
+// later, and a full node should spill over instead of killing the process.
+function void numa_bind(NumaAllocator *self, void *data, size_t length) {
+	if (!self->bind) {
+		return;
+	}
+
+	#ifdef SYS_mbind
+	unsigned long mask = 1ul << self->node;
+
+	if (syscall(SYS_mbind, data, length, NUMA_MPOL_PREFERRED, &mask, NUMA_MAX_NODES + 1, 0) == 0) {
+		return;
+	}
+	#endif
+
+	self->bind = 0;
+}
+
+function Result numa_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	NumaAllocator *self;
+	NumaRegion *region;
+	size_t length;
+	void *mapping;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (NumaAllocator *) allocator;
+	length = NUMA_ROUND(size, sysconf(_SC_PAGESIZE));
+	mapping = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	res = ALLOC(self->inside_methods, sizeof(NumaRegion));
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&self->lock);
+		munmap(mapping, length);
+		return res;
+	}
+	if (res.data.length != sizeof(NumaRegion)) {
+		FREE(self->inside_methods, res.data);
+		pthread_mutex_unlock(&self->lock);
+		munmap(mapping, length);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	numa_bind(self, mapping, length);
+
+	region = (NumaRegion *) res.data.data;
+	region->mapping.data = mapping;
+	region->mapping.length = length;
+	region->next = self->regions;
+	self->regions = region;
+	self->bytes_mapped += length;
+	pthread_mutex_unlock(&self->lock);
+
+	res.data.data = mapping;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Mappings start on a page, which covers any smaller alignment
+function Result numa_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+	if (alignment > (unsigned long) sysconf(_SC_PAGESIZE)) {
+		return res;
+	}
+
+	return numa_alloc(allocator, size);
+}
+
+function NumaRegion **numa_find(NumaAllocator *self, void *data) {
+	NumaRegion **link = &self->regions;
+
+	while (*link != 0 && (*link)->mapping.data != data) {
+		link = &(*link)->next;
+	}
+
+	return link;
+}
+
+// Callers hold the lock
+function Result numa_unmap(NumaAllocator *self, NumaRegion **link) {
+	Result res;
+	NumaRegion *region = *link;
+	BASE_ERROR_RESULT(res);
+
+	if (munmap(region->mapping.data, region->mapping.length) != 0) {
+		return res;
+	}
+	*link = region->next;
+	self->bytes_mapped -= region->mapping.length;
+
+	res.data.data = region;
+	res.data.length = sizeof(NumaRegion);
+	return FREE(self->inside_methods, res.data);
+}
+
+function Result numa_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	NumaAllocator *self;
+	NumaRegion **link;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (NumaAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	link = numa_find(self, ptr.data);
+	if (*link != 0 && (*link)->mapping.length >= ptr.length) {
+		res = numa_unmap(self, link);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// Sizes within the same run of pages keep their mapping
+function Result numa_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	NumaAllocator *self;
+	NumaRegion *region;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (NumaAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	region = *numa_find(self, ptr.data);
+	if (region != 0 && region->mapping.length >= ptr.length && region->mapping.length >= size) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result numa_freeall(Allocator *allocator) {
+	Result res;
+	NumaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (NumaAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res.status = ERROR_OK;
+	while (self->regions != 0 && res.status == ERROR_OK) {
+		res = numa_unmap(self, &self->regions);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result numa_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	NumaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (NumaAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	for (NumaRegion *region = self->regions; region != 0; region = region->next) {
+		if (SLICE_WITHIN(region->mapping, ptr)) {
+			res.status = ERROR_OK;
+			res.data = ptr;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+Result new_numa_allocator(Allocator *allocator, int node) {
+	Result res;
+	NumaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || node >= numa_node_count()) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(NumaAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(NumaAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (NumaAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->regions = 0;
+	self->node = node < 0 ? numa_current_node() : node;
+	self->bind = numa_node_count() > 1;
+	self->bytes_mapped = 0;
+	pthread_mutex_init(&self->lock, 0);
+
+	self->outside_methods.alloc = numa_alloc;
+	self->outside_methods.alloc_aligned = numa_alloc_aligned;
+	self->outside_methods.alloc_zeroed = numa_alloc;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = numa_resize;
+	self->outside_methods.free = numa_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = numa_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = numa_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(NumaAllocator);
+	return res;
+}
+
+Result deinit_numa_allocator(NumaAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = numa_freeall((Allocator *) self);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	pthread_mutex_destroy(&self->lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(NumaAllocator);
+	return FREE(self->inside_methods, res.data);
+}
+
+Allocator *numa_node_allocator(int node) {
+	NumaAllocator *self;
+	Result res;
+
+	if (node < 0 || node >= numa_node_count()) {
+		return 0;
+	}
+
+	self = atomic_load_explicit(&numa_registry[node], memory_order_acquire);
+	if (self != 0) {
+		return (Allocator *) self;
+	}
+
+	pthread_mutex_lock(&numa_registry_lock);
+	self = atomic_load_explicit(&numa_registry[node], memory_order_relaxed);
+	if (self == 0) {
+		res = new_numa_allocator(get_raw_heap_allocator(), node);
+		if (res.status == ERROR_OK) {
+			self = (NumaAllocator *) res.data.data;
+			atomic_store_explicit(&numa_registry[node], self, memory_order_release);
+		}
+	}
+	pthread_mutex_unlock(&numa_registry_lock);
+
+	return (Allocator *) self;
+}
+
+Allocator *numa_local_allocator(void) {
+	return numa_node_allocator(numa_current_node());
+}
+
+Result release_numa_allocators(void) {
+	Result res;
+	NumaAllocator *self;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	pthread_mutex_lock(&numa_registry_lock);
+	for (int node = 0; node < NUMA_MAX_NODES; node++) {
+		self = atomic_exchange_explicit(&numa_registry[node], 0, memory_order_acq_rel);
+		if (self != 0 && deinit_numa_allocator(self).status != ERROR_OK) {
+			failed = 1;
+		}
+	}
+	pthread_mutex_unlock(&numa_registry_lock);
+
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Node ids the allocator can bind to; one bit each in an mbind() mask
+#define NUMA_MAX_NODES 64
+
+typedef struct numa_region_s NumaRegion;
+struct numa_region_s {
+	NumaRegion *next;
+	Slice mapping;
+};
+
+struct numa_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	NumaRegion *regions;
+	pthread_mutex_t lock;
+	int node;
+	// Cleared on single-node machines, and when the kernel refuses mbind()
+	int bind;
+	size_t bytes_mapped;
+};
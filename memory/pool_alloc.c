@@ -0,0 +1,547 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+
+#define POOL_ROUND(size) (((size) + POOL_OBJECT_ALIGN - 1) & ~(POOL_OBJECT_ALIGN - 1))
+
+// The pool this thread used last and its cache, so most calls skip
+// pthread_getspecific. Ids are never reused: a new pool at the address of
+// one that was deinit does not match.
+local _Atomic uint64_t pool_ids;
+local _Thread_local PoolAllocator *pool_last;
+local _Thread_local uint64_t pool_last_id;
+local _Thread_local PoolCache *pool_last_cache;
+
+function _Atomic uint32_t *pool_link(PoolAllocator *self, uint32_t index) {
+	uint32_t zero_based = index - 1;
+	Slice chunk = self->chunks[zero_based >> self->chunk_shift];
+
+	return (_Atomic uint32_t *)((uint8_t *) chunk.data +
+		(size_t)(zero_based & ((1u << self->chunk_shift) - 1)) * self->object_size);
+}
+
+// Pushes the chain first..last, which is already linked, in one CAS
+function void pool_push_chain(PoolAllocator *self, uint32_t first, uint32_t last) {
+	uint64_t head, next;
+
+	head = atomic_load_explicit(&self->head, memory_order_relaxed);
+	do {
+		atomic_store_explicit(pool_link(self, last), POOL_HEAD_INDEX(head), memory_order_relaxed);
+		next = POOL_HEAD(POOL_HEAD_GENERATION(head) + 1, first);
+	} while (!atomic_compare_exchange_weak_explicit(
+		&self->head, &head, next, memory_order_release, memory_order_relaxed
+	));
+}
+
+function uint32_t pool_map_slot(uintptr_t span) {
+	return (uint32_t)(((uint64_t) span * 0x9E3779B97F4A7C15ull) >> (64 - POOL_MAP_BITS));
+}
+
+// A chunk is no longer than a span, so it touches at most two. Only called
+// under the refill lock, before the chunk's objects are published.
+function void pool_map_insert(PoolAllocator *self, unsigned int chunk) {
+	uintptr_t start = (uintptr_t) self->chunks[chunk].data;
+	uintptr_t first = start >> self->span_shift;
+	uintptr_t last = (start + ((size_t) self->object_size << self->chunk_shift) - 1) >> self->span_shift;
+	uint32_t slot;
+
+	for (uintptr_t span = first; span <= last; span++) {
+		slot = pool_map_slot(span);
+		while (atomic_load_explicit(&self->map[slot], memory_order_relaxed) != 0) {
+			slot = (slot + 1) & (POOL_MAP_SLOTS - 1);
+		}
+		atomic_store_explicit(&self->map[slot], (uint16_t)(chunk + 1), memory_order_release);
+	}
+}
+
+// Adds a whole chunk of objects at once; the lock only keeps concurrent
+// refills from racing for the same chunk slot.
+function int pool_refill(PoolAllocator *self) {
+	Result res;
+	unsigned int chunk, objects;
+	uint32_t first;
+
+	pthread_mutex_lock(&self->refill_lock);
+	if (POOL_HEAD_INDEX(atomic_load_explicit(&self->head, memory_order_acquire)) != 0) {
+		pthread_mutex_unlock(&self->refill_lock);
+		return 1;
+	}
+
+	chunk = atomic_load_explicit(&self->chunk_count, memory_order_relaxed);
+	if (chunk == POOL_MAX_CHUNKS) {
+		pthread_mutex_unlock(&self->refill_lock);
+		return 0;
+	}
+
+	objects = 1u << self->chunk_shift;
+	res = ALLOC(self->inside_methods, objects * self->object_size);
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&self->refill_lock);
+		return 0;
+	}
+	self->chunks[chunk] = res.data;
+	pool_map_insert(self, chunk);
+	atomic_store_explicit(&self->chunk_count, chunk + 1, memory_order_release);
+
+	first = chunk * objects + 1;
+	for (uint32_t index = first; index < first + objects - 1; index++) {
+		atomic_store_explicit(pool_link(self, index), index + 1, memory_order_relaxed);
+	}
+	pool_push_chain(self, first, first + objects - 1);
+
+	pthread_mutex_unlock(&self->refill_lock);
+	return 1;
+}
+
+function int pool_pop(PoolAllocator *self, uint32_t *index) {
+	uint64_t head, next;
+
+	head = atomic_load_explicit(&self->head, memory_order_acquire);
+	for (;;) {
+		*index = POOL_HEAD_INDEX(head);
+		if (*index == 0) {
+			if (!pool_refill(self)) {
+				return 0;
+			}
+			head = atomic_load_explicit(&self->head, memory_order_acquire);
+			continue;
+		}
+
+		next = POOL_HEAD(POOL_HEAD_GENERATION(head) + 1,
+			atomic_load_explicit(pool_link(self, *index), memory_order_relaxed));
+		if (atomic_compare_exchange_weak_explicit(
+			&self->head, &head, next, memory_order_acquire, memory_order_acquire
+		)) {
+			return 1;
+		}
+	}
+}
+
+// Links the oldest `count` cached objects and publishes them with one CAS
+function void pool_cache_flush(PoolAllocator *self, PoolCache *cache, unsigned int count) {
+	if (count == 0) {
+		return;
+	}
+
+	for (unsigned int slot = 0; slot + 1 < count; slot++) {
+		atomic_store_explicit(
+			pool_link(self, cache->indexes[slot]), cache->indexes[slot + 1], memory_order_relaxed
+		);
+	}
+	pool_push_chain(self, cache->indexes[0], cache->indexes[count - 1]);
+
+	cache->count -= count;
+	memmove(cache->indexes, cache->indexes + count, cache->count * sizeof(uint32_t));
+}
+
+function void pool_cache_destroy(void *data) {
+	PoolCache *cache, **link;
+	PoolAllocator *self;
+	Slice s;
+
+	cache = (PoolCache *) data;
+	self = cache->owner;
+	if (pool_last_cache == cache) {
+		pool_last = 0;
+	}
+
+	pthread_mutex_lock(&self->cache_lock);
+	pool_cache_flush(self, cache, cache->count);
+	for (link = &self->caches; *link != 0; link = &(*link)->next) {
+		if (*link == cache) {
+			*link = cache->next;
+			break;
+		}
+	}
+	s.data = cache;
+	s.length = sizeof(PoolCache);
+	FREE(self->inside_methods, s);
+	pthread_mutex_unlock(&self->cache_lock);
+}
+
+// Without a cache the thread goes straight to the shared free list
+function PoolCache *pool_get_cache(PoolAllocator *self) {
+	Result res;
+	PoolCache *cache;
+
+	if (pool_last == self && pool_last_id == self->id) {
+		return pool_last_cache;
+	}
+
+	cache = (PoolCache *) pthread_getspecific(self->key);
+	if (cache != 0) {
+		pool_last = self;
+		pool_last_id = self->id;
+		pool_last_cache = cache;
+		return cache;
+	}
+
+	pthread_mutex_lock(&self->cache_lock);
+	res = ALLOC(self->inside_methods, sizeof(PoolCache));
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&self->cache_lock);
+		return 0;
+	}
+	if (res.data.length != sizeof(PoolCache)) {
+		FREE(self->inside_methods, res.data);
+		pthread_mutex_unlock(&self->cache_lock);
+		return 0;
+	}
+
+	cache = (PoolCache *) res.data.data;
+	cache->owner = self;
+	cache->count = 0;
+	if (pthread_setspecific(self->key, cache) != 0) {
+		FREE(self->inside_methods, res.data);
+		pthread_mutex_unlock(&self->cache_lock);
+		return 0;
+	}
+	cache->next = self->caches;
+	self->caches = cache;
+	pthread_mutex_unlock(&self->cache_lock);
+
+	pool_last = self;
+	pool_last_id = self->id;
+	pool_last_cache = cache;
+	return cache;
+}
+
+function Result pool_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	PoolAllocator *self;
+	PoolCache *cache;
+	uint32_t index;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	if (size > self->object_size) {
+		return ALLOC(self->inside_methods, size);
+	}
+
+	cache = pool_get_cache(self);
+	if (cache != 0 && cache->count > 0) {
+		index = cache->indexes[--cache->count];
+	} else if (!pool_pop(self, &index)) {
+		return res;
+	}
+
+	res.data.data = (void*) pool_link(self, index);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result pool_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	PoolAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	if (size > self->object_size) {
+		return ALLOC_ZEROED(self->inside_methods, size);
+	}
+
+	return standard_alloc_zeroed(allocator, size);
+}
+
+// Finds the 1-based index of an object, or 0 if it is not one of ours
+function uint32_t pool_index(PoolAllocator *self, void *data) {
+	size_t chunk_length = (size_t) self->object_size << self->chunk_shift;
+	uint32_t slot = pool_map_slot((uintptr_t) data >> self->span_shift);
+	unsigned int chunk;
+	uint32_t object;
+	uintptr_t offset;
+
+	// Other spans share the probe run, so every entry is checked by range
+	while ((chunk = atomic_load_explicit(&self->map[slot], memory_order_acquire)) != 0) {
+		chunk--;
+		offset = (uintptr_t) data - (uintptr_t) self->chunks[chunk].data;
+		if (offset < chunk_length) {
+			// Chunks are under 4 GiB, so one multiply divides the offset exactly
+			object = (uint32_t)(((unsigned __int128) self->object_inverse * offset) >> 64);
+			if ((size_t) object * self->object_size == offset) {
+				return (chunk << self->chunk_shift) + object + 1;
+			}
+		}
+		slot = (slot + 1) & (POOL_MAP_SLOTS - 1);
+	}
+
+	return 0;
+}
+
+function Result pool_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	PoolAllocator *self;
+	PoolCache *cache;
+	uint32_t index;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	if (ptr.length > self->object_size) {
+		return FREE(self->inside_methods, ptr);
+	}
+
+	index = pool_index(self, ptr.data);
+	if (index == 0) {
+		return res;
+	}
+
+	// A full cache hands its older half back to the shared list
+	cache = pool_get_cache(self);
+	if (cache == 0) {
+		pool_push_chain(self, index, index);
+	} else {
+		if (cache->count == POOL_CACHE_OBJECTS) {
+			pool_cache_flush(self, cache, POOL_CACHE_OBJECTS / 2);
+		}
+		cache->indexes[cache->count++] = index;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Links the pool's objects privately and publishes them with one CAS
+function Result pool_free_batch(Allocator *allocator, Slice *ptrs, unsigned int count) {
+	Result res;
+	PoolAllocator *self;
+	uint32_t index, first, last;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptrs == 0 || count == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	first = 0;
+	last = 0;
+	for (unsigned int slot = 0; slot < count; slot++) {
+		if (ptrs[slot].length == 0 || ptrs[slot].data == 0) {
+			failed = 1;
+			continue;
+		}
+		if (ptrs[slot].length > self->object_size) {
+			failed |= FREE(self->inside_methods, ptrs[slot]).status != ERROR_OK;
+			continue;
+		}
+
+		index = pool_index(self, ptrs[slot].data);
+		if (index == 0) {
+			failed = 1;
+			continue;
+		}
+		atomic_store_explicit(pool_link(self, index), first, memory_order_relaxed);
+		if (first == 0) {
+			last = index;
+		}
+		first = index;
+	}
+	if (first != 0) {
+		pool_push_chain(self, first, last);
+	}
+
+	BASE_ERROR_RESULT(res);
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
+
+function Result pool_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	PoolAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	if (ptr.length > self->object_size && size > self->object_size) {
+		return RESIZE(self->inside_methods, ptr, size);
+	}
+	if (ptr.length <= self->object_size && size <= self->object_size) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	}
+
+	return res;
+}
+
+// Releases every chunk. No other thread may be using the pool meanwhile.
+function Result pool_freeall(Allocator *allocator) {
+	Result res;
+	PoolAllocator *self;
+	PoolCache *cache;
+	unsigned int chunks;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	pthread_mutex_lock(&self->cache_lock);
+	for (cache = self->caches; cache != 0; cache = cache->next) {
+		cache->count = 0;
+	}
+	pthread_mutex_unlock(&self->cache_lock);
+
+	chunks = atomic_load_explicit(&self->chunk_count, memory_order_acquire);
+	for (unsigned int chunk = 0; chunk < chunks; chunk++) {
+		res = FREE(self->inside_methods, self->chunks[chunk]);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+		SET_NULL_SLICE(self->chunks[chunk]);
+	}
+	for (unsigned int slot = 0; slot < POOL_MAP_SLOTS; slot++) {
+		atomic_store_explicit(&self->map[slot], 0, memory_order_relaxed);
+	}
+	atomic_store_explicit(&self->chunk_count, 0, memory_order_relaxed);
+	atomic_store_explicit(
+		&self->head, POOL_HEAD(POOL_HEAD_GENERATION(atomic_load(&self->head)) + 1, 0), memory_order_release
+	);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result pool_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	PoolAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (PoolAllocator *) allocator;
+	if (ptr.length > self->object_size) {
+		return OWNS(self->inside_methods, ptr);
+	}
+
+	if (pool_index(self, ptr.data) != 0) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result new_pool_allocator(Allocator *allocator, unsigned int object_size, unsigned int batch_count) {
+	Result res;
+	PoolAllocator *self;
+	unsigned int shift;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || object_size == 0 || object_size > UINT32_MAX / 2 || batch_count == 0) {
+		return res;
+	}
+
+	// Batches are a power of two so an index splits into chunk and slot
+	shift = batch_count <= 1 ? 0 : 32 - __builtin_clz(batch_count - 1);
+	object_size = POOL_ROUND(object_size);
+	if (shift > 20 || ((uint64_t) object_size << shift) > UINT32_MAX) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(PoolAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(PoolAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (PoolAllocator *) res.data.data;
+	if (pthread_key_create(&self->key, pool_cache_destroy) != 0) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->inside_methods = allocator;
+	self->id = atomic_fetch_add_explicit(&pool_ids, 1, memory_order_relaxed) + 1;
+	self->object_size = object_size;
+	self->chunk_shift = shift;
+	self->object_inverse = UINT64_MAX / object_size + 1;
+	self->span_shift = 64 - __builtin_clzll(((uint64_t) object_size << shift) - 1);
+	atomic_init(&self->head, POOL_HEAD(0, 0));
+	atomic_init(&self->chunk_count, 0);
+	pthread_mutex_init(&self->refill_lock, 0);
+	pthread_mutex_init(&self->cache_lock, 0);
+	self->caches = 0;
+	for (unsigned int slot = 0; slot < POOL_MAP_SLOTS; slot++) {
+		atomic_init(&self->map[slot], 0);
+	}
+
+	self->outside_methods.alloc = pool_alloc;
+	self->outside_methods.alloc_aligned = standard_alloc_aligned;
+	self->outside_methods.alloc_zeroed = pool_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = pool_resize;
+	self->outside_methods.free = pool_free;
+	self->outside_methods.free_batch = pool_free_batch;
+	self->outside_methods.freeall = pool_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = pool_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(PoolAllocator);
+	return res;
+}
+
+// Caches of threads that are still alive are released here instead of at
+// thread exit.
+Result deinit_pool_allocator(PoolAllocator *self) {
+	Result res;
+	PoolCache *cache;
+	Slice s;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = pool_freeall((Allocator *) self);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	pthread_key_delete(self->key);
+	pthread_mutex_lock(&self->cache_lock);
+	while (self->caches != 0) {
+		cache = self->caches;
+		self->caches = cache->next;
+		s.data = cache;
+		s.length = sizeof(PoolCache);
+		FREE(self->inside_methods, s);
+	}
+	pthread_mutex_unlock(&self->cache_lock);
+	pthread_mutex_destroy(&self->cache_lock);
+	pthread_mutex_destroy(&self->refill_lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(PoolAllocator);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define POOL_MAX_CHUNKS 1024
+#define POOL_OBJECT_ALIGN 8
+
+// The free list head packs a generation above a 1-based object index, so
+// a CAS fails if the head was popped and pushed back in between (ABA).
+#define POOL_HEAD(generation, index) (((uint64_t)(generation) << 32) | (uint32_t)(index))
+#define POOL_HEAD_GENERATION(head) ((uint32_t)((head) >> 32))
+#define POOL_HEAD_INDEX(head) ((uint32_t)(head))
+
+// Each chunk is entered in the map under the one or two spans of
+// 2^span_shift bytes it touches, so a free finds its chunk in a few probes.
+#define POOL_MAP_BITS 12
+#define POOL_MAP_SLOTS (1u << POOL_MAP_BITS)
+
+#define POOL_CACHE_OBJECTS 64
+
+// Objects the thread freed, oldest first, handed out again without touching
+// the shared head. Only the owning thread uses `indexes`.
+typedef struct pool_cache_s PoolCache;
+struct pool_cache_s {
+	PoolCache *next;
+	PoolAllocator *owner;
+	unsigned int count;
+	uint32_t indexes[POOL_CACHE_OBJECTS];
+};
+
+// Chunks are only released by FREEALL, so a racing pop can always read the
+// link of an object another thread has just taken.
+struct pool_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	uint64_t id;
+	unsigned int object_size;
+	uint64_t object_inverse;
+	unsigned int chunk_shift;
+	unsigned int span_shift;
+	_Atomic uint64_t head;
+	_Atomic unsigned int chunk_count;
+	pthread_mutex_t refill_lock;
+	pthread_mutex_t cache_lock;
+	pthread_key_t key;
+	PoolCache *caches;
+	Slice chunks[POOL_MAX_CHUNKS];
+	_Atomic uint16_t map[POOL_MAP_SLOTS];
+};
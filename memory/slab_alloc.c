@@ -0,0 +1,303 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+unsigned int size_class_index(unsigned int size) {
+	unsigned int shift;
+
+	if (size <= 32) {
+		return size <= 8 ? 0 : (size - 1) >> 3;
+	}
+
+	shift = 29 - __builtin_clz(size - 1);
+	return 4 + ((shift - 3) << 2) + (((size - 1) >> shift) & 3);
+}
+
+unsigned int size_class_length(unsigned int index) {
+	unsigned int shift;
+
+	if (index < 4) {
+		return (index + 1) << 3;
+	}
+
+	shift = 3 + ((index - 4) >> 2);
+	return (4u << shift) + ((((index - 4) & 3) + 1) << shift);
+}
+
+function Result slab_new_page(SlabAllocator *self, SlabClass *class) {
+	Result res;
+	SlabPage *page;
+	BASE_ERROR_RESULT(res);
+
+	res = ALLOC(self->inside_methods, self->page_size);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != self->page_size) {
+		FREE(self->inside_methods, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	page = (SlabPage *) res.data.data;
+	page->mem = res.data;
+	page->next = self->pages;
+	self->pages = page;
+
+	class->current.data = (void*) &page[1];
+	class->current.length = self->page_size - sizeof(SlabPage);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result slab_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	SlabAllocator *self;
+	SlabClass *class;
+	unsigned int class_length;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (size > SIZE_CLASS_MAX) {
+		return ALLOC(self->inside_methods, size);
+	}
+
+	class = &self->classes[size_class_index(size)];
+	if (class->free_list != 0) {
+		res.data.data = (void*) class->free_list;
+		res.data.length = size;
+		res.status = ERROR_OK;
+		class->free_list = class->free_list->next;
+		return res;
+	}
+
+	class_length = size_class_length(size_class_index(size));
+	if (class->current.length < class_length) {
+		res = slab_new_page(self, class);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+	}
+
+	res.data.data = class->current.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+
+	class->current.data = (void*)((uint8_t *)class->current.data + class_length);
+	class->current.length -= class_length;
+
+	return res;
+}
+
+function Result slab_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	SlabAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (size > SIZE_CLASS_MAX) {
+		return ALLOC_ZEROED(self->inside_methods, size);
+	}
+
+	return standard_alloc_zeroed(allocator, size);
+}
+
+// Objects carry no header: the length of the Slice selects the size class
+function Result slab_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	SlabAllocator *self;
+	SlabClass *class;
+	SlabObject *object;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX) {
+		return FREE(self->inside_methods, ptr);
+	}
+
+	class = &self->classes[size_class_index(ptr.length)];
+	object = (SlabObject *) ptr.data;
+	object->next = class->free_list;
+	class->free_list = object;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result slab_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	SlabAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX && size > SIZE_CLASS_MAX) {
+		return RESIZE(self->inside_methods, ptr, size);
+	}
+
+	if (
+		ptr.length <= SIZE_CLASS_MAX && size <= SIZE_CLASS_MAX &&
+		size_class_index(ptr.length) == size_class_index(size)
+	) {
+		res.data.data = ptr.data;
+		res.data.length = size;
+		res.status = ERROR_OK;
+	}
+
+	return res;
+}
+
+function Result slab_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	SlabAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX && size > SIZE_CLASS_MAX) {
+		return REALLOC(self->inside_methods, ptr, size);
+	}
+
+	return standard_realloc(allocator, ptr, size);
+}
+
+// Returns every page to the parent. Allocations larger than SIZE_CLASS_MAX
+// were served by the parent directly and must still be freed individually.
+function Result slab_freeall(Allocator *allocator) {
+	Result res;
+	SlabAllocator *self;
+	SlabPage *page;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	while (self->pages != 0) {
+		page = self->pages;
+		self->pages = page->next;
+		res = FREE(self->inside_methods, page->mem);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+	}
+
+	for (unsigned int index = 0; index < SIZE_CLASS_COUNT; index++) {
+		self->classes[index].free_list = 0;
+		SET_NULL_SLICE(self->classes[index].current);
+	}
+
+	res.status = ERROR_OK;
+	SET_NULL_SLICE(res.data);
+	return res;
+}
+
+// Large allocations were made by the parent, so it gets asked about those
+function Result slab_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	SlabAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (SlabAllocator *) allocator;
+	if (ptr.length > SIZE_CLASS_MAX) {
+		return OWNS(self->inside_methods, ptr);
+	}
+
+	for (SlabPage *page = self->pages; page != 0; page = page->next) {
+		if (SLICE_WITHIN(page->mem, ptr)) {
+			res.status = ERROR_OK;
+			res.data = ptr;
+			return res;
+		}
+	}
+	return res;
+}
+
+Result new_slab_allocator(Allocator *allocator, unsigned int page_size) {
+	Result res;
+	SlabAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || page_size < sizeof(SlabPage) + SIZE_CLASS_MAX) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(SlabAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(SlabAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (SlabAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->page_size = page_size;
+	self->pages = 0;
+	for (unsigned int index = 0; index < SIZE_CLASS_COUNT; index++) {
+		self->classes[index].free_list = 0;
+		SET_NULL_SLICE(self->classes[index].current);
+	}
+
+	self->outside_methods.alloc = slab_alloc;
+	self->outside_methods.alloc_aligned = standard_alloc_aligned;
+	self->outside_methods.alloc_zeroed = slab_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = slab_realloc;
+	self->outside_methods.resize = slab_resize;
+	self->outside_methods.free = slab_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = slab_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = slab_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(SlabAllocator);
+	return res;
+}
+
+Result deinit_slab_allocator(SlabAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = slab_freeall((Allocator *) self);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(SlabAllocator);
+	return FREE(self->inside_methods, res.data);
+}
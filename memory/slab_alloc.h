@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Size classes: steps of 8 up to 32, then quarter steps between powers of two
+#define SIZE_CLASS_COUNT 16
+#define SIZE_CLASS_MAX 256
+
+typedef struct slab_page_s SlabPage;
+struct slab_page_s {
+	SlabPage *next;
+	Slice mem;
+};
+
+typedef struct slab_object_s SlabObject;
+struct slab_object_s {
+	SlabObject *next;
+};
+
+typedef struct {
+	SlabObject *free_list;
+	Slice current;
+} SlabClass;
+
+struct slab_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	unsigned int page_size;
+	SlabPage *pages;
+	SlabClass classes[SIZE_CLASS_COUNT];
+};
@@ -0,0 +1,298 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#define STATS_ADD(counter, value) atomic_fetch_add_explicit(&(counter), value, memory_order_relaxed)
+#define STATS_SUB(counter, value) atomic_fetch_sub_explicit(&(counter), value, memory_order_relaxed)
+#define STATS_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define STATS_STORE(counter, value) atomic_store_explicit(&(counter), value, memory_order_relaxed)
+
+function void stats_record_live(StatsAllocator *self, uint64_t added, uint64_t removed) {
+	uint64_t live, peak;
+
+	if (added >= removed) {
+		live = STATS_ADD(self->bytes_live, added - removed) + (added - removed);
+	} else {
+		live = STATS_SUB(self->bytes_live, removed - added) - (removed - added);
+	}
+
+	peak = STATS_LOAD(self->bytes_peak);
+	while (live > peak && !atomic_compare_exchange_weak_explicit(
+		&self->bytes_peak, &peak, live, memory_order_relaxed, memory_order_relaxed
+	)) {
+	}
+}
+
+// Bucket n counts requests of [2^n, 2^(n+1)) bytes
+function void stats_record_size(StatsAllocator *self, unsigned int size) {
+	STATS_ADD(self->histogram[31 - __builtin_clz(size)], 1);
+}
+
+function Result stats_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = ALLOC(self->inside_methods, size);
+	if (res.status != ERROR_OK) {
+		STATS_ADD(self->failures, 1);
+		return res;
+	}
+
+	STATS_ADD(self->allocs, 1);
+	stats_record_size(self, size);
+	stats_record_live(self, res.data.length, 0);
+	return res;
+}
+
+function Result stats_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = ALLOC_ALIGNED(self->inside_methods, size, alignment);
+	if (res.status != ERROR_OK) {
+		STATS_ADD(self->failures, 1);
+		return res;
+	}
+
+	STATS_ADD(self->allocs, 1);
+	stats_record_size(self, size);
+	stats_record_live(self, res.data.length, 0);
+	return res;
+}
+
+function Result stats_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = ALLOC_ZEROED(self->inside_methods, size);
+	if (res.status != ERROR_OK) {
+		STATS_ADD(self->failures, 1);
+		return res;
+	}
+
+	STATS_ADD(self->allocs, 1);
+	stats_record_size(self, size);
+	stats_record_live(self, res.data.length, 0);
+	return res;
+}
+
+function Result stats_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = REALLOC(self->inside_methods, ptr, size);
+	if (res.status != ERROR_OK) {
+		STATS_ADD(self->failures, 1);
+		return res;
+	}
+
+	STATS_ADD(self->reallocs, 1);
+	stats_record_size(self, size);
+	stats_record_live(self, res.data.length, ptr.length);
+	return res;
+}
+
+// A failed resize is an expected answer, not an allocation failure
+function Result stats_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = RESIZE(self->inside_methods, ptr, size);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	STATS_ADD(self->resizes, 1);
+	stats_record_live(self, res.data.length, ptr.length);
+	return res;
+}
+
+function Result stats_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	res = FREE(self->inside_methods, ptr);
+	if (res.status != ERROR_OK) {
+		STATS_ADD(self->failures, 1);
+		return res;
+	}
+
+	STATS_ADD(self->frees, 1);
+	stats_record_live(self, 0, ptr.length);
+	return res;
+}
+
+// Keeps no blocks of its own, so there is nothing to release
+function Result stats_freeall(Allocator *allocator) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result stats_allocator_snapshot(StatsAllocator *self, AllocatorStats *stats) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || stats == 0) {
+		return res;
+	}
+
+	stats->allocs = STATS_LOAD(self->allocs);
+	stats->reallocs = STATS_LOAD(self->reallocs);
+	stats->resizes = STATS_LOAD(self->resizes);
+	stats->frees = STATS_LOAD(self->frees);
+	stats->failures = STATS_LOAD(self->failures);
+	stats->bytes_live = STATS_LOAD(self->bytes_live);
+	stats->bytes_peak = STATS_LOAD(self->bytes_peak);
+	for (unsigned int bucket = 0; bucket < ALLOCATOR_HISTOGRAM_BUCKETS; bucket++) {
+		stats->histogram[bucket] = STATS_LOAD(self->histogram[bucket]);
+	}
+
+	res.status = ERROR_OK;
+	res.data.data = stats;
+	res.data.length = sizeof(AllocatorStats);
+	return res;
+}
+
+// Live bytes describe outstanding allocations and survive a reset; the peak
+// restarts from them.
+Result stats_allocator_reset(StatsAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	STATS_STORE(self->allocs, 0);
+	STATS_STORE(self->reallocs, 0);
+	STATS_STORE(self->resizes, 0);
+	STATS_STORE(self->frees, 0);
+	STATS_STORE(self->failures, 0);
+	STATS_STORE(self->bytes_peak, STATS_LOAD(self->bytes_live));
+	for (unsigned int bucket = 0; bucket < ALLOCATOR_HISTOGRAM_BUCKETS; bucket++) {
+		STATS_STORE(self->histogram[bucket], 0);
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result stats_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (StatsAllocator *) allocator;
+	return OWNS(self->inside_methods, ptr);
+}
+
+Result new_stats_allocator(Allocator *allocator) {
+	Result res;
+	StatsAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(StatsAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(StatsAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (StatsAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	atomic_init(&self->allocs, 0);
+	atomic_init(&self->reallocs, 0);
+	atomic_init(&self->resizes, 0);
+	atomic_init(&self->frees, 0);
+	atomic_init(&self->failures, 0);
+	atomic_init(&self->bytes_live, 0);
+	atomic_init(&self->bytes_peak, 0);
+	for (unsigned int bucket = 0; bucket < ALLOCATOR_HISTOGRAM_BUCKETS; bucket++) {
+		atomic_init(&self->histogram[bucket], 0);
+	}
+
+	self->outside_methods.alloc = stats_alloc;
+	self->outside_methods.alloc_aligned = stats_alloc_aligned;
+	self->outside_methods.alloc_zeroed = stats_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = stats_realloc;
+	self->outside_methods.resize = stats_resize;
+	self->outside_methods.free = stats_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = stats_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = stats_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(StatsAllocator);
+	return res;
+}
+
+Result deinit_stats_allocator(StatsAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(StatsAllocator);
+	return FREE(self->inside_methods, res.data);
+}
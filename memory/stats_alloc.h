@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Counters are independent relaxed atomics: each one is exact, but a
+// snapshot taken during concurrent use is not a single point in time.
+struct stats_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	_Atomic uint64_t allocs;
+	_Atomic uint64_t reallocs;
+	_Atomic uint64_t resizes;
+	_Atomic uint64_t frees;
+	_Atomic uint64_t failures;
+	_Atomic uint64_t bytes_live;
+	_Atomic uint64_t bytes_peak;
+	_Atomic uint64_t histogram[ALLOCATOR_HISTOGRAM_BUCKETS];
+};
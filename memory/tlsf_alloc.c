@@ -0,0 +1,396 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#define TLSF_NEXT_PHYSICAL(block) \
+((TlsfBlock *)((uint8_t *)(block) + TLSF_HEADER_SIZE + (block)->size))
+
+function unsigned int tlsf_fls(unsigned int value) {
+	return 31 - __builtin_clz(value);
+}
+
+function void tlsf_mapping_insert(unsigned int size, unsigned int *fl, unsigned int *sl) {
+	unsigned int first;
+
+	if (size < TLSF_SMALL_BLOCK) {
+		*fl = 0;
+		*sl = size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT);
+		return;
+	}
+
+	first = tlsf_fls(size);
+	*sl = (size >> (first - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+	*fl = first - (TLSF_FL_SHIFT - 1);
+}
+
+// Rounds the request up to the next list boundary so that any block found in
+// the resulting list is large enough, keeping the search free of loops.
+function void tlsf_mapping_search(unsigned int size, unsigned int *fl, unsigned int *sl) {
+	if (size >= TLSF_SMALL_BLOCK) {
+		size += (1u << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+	}
+	tlsf_mapping_insert(size, fl, sl);
+}
+
+function TlsfBlock *tlsf_find_suitable(TlsfAllocator *self, unsigned int *fl, unsigned int *sl) {
+	uint32_t sl_map, fl_map;
+
+	sl_map = self->sl_bitmap[*fl] & (~0u << *sl);
+	if (sl_map == 0) {
+		fl_map = self->fl_bitmap & (~0u << (*fl + 1));
+		if (fl_map == 0) {
+			return 0;
+		}
+		*fl = __builtin_ctz(fl_map);
+		sl_map = self->sl_bitmap[*fl];
+	}
+	*sl = __builtin_ctz(sl_map);
+
+	return self->blocks[*fl][*sl];
+}
+
+function void tlsf_remove_free(TlsfAllocator *self, TlsfBlock *block) {
+	unsigned int fl, sl;
+
+	tlsf_mapping_insert(block->size, &fl, &sl);
+	if (block->previous_free != 0) {
+		block->previous_free->next_free = block->next_free;
+	} else {
+		self->blocks[fl][sl] = block->next_free;
+		if (block->next_free == 0) {
+			self->sl_bitmap[fl] &= ~(1u << sl);
+			if (self->sl_bitmap[fl] == 0) {
+				self->fl_bitmap &= ~(1u << fl);
+			}
+		}
+	}
+	if (block->next_free != 0) {
+		block->next_free->previous_free = block->previous_free;
+	}
+}
+
+function void tlsf_insert_free(TlsfAllocator *self, TlsfBlock *block) {
+	unsigned int fl, sl;
+	TlsfBlock *next;
+
+	tlsf_mapping_insert(block->size, &fl, &sl);
+	block->flags |= TLSF_BLOCK_FREE;
+	block->previous_free = 0;
+	block->next_free = self->blocks[fl][sl];
+	if (block->next_free != 0) {
+		block->next_free->previous_free = block;
+	}
+	self->blocks[fl][sl] = block;
+	self->sl_bitmap[fl] |= 1u << sl;
+	self->fl_bitmap |= 1u << fl;
+
+	next = TLSF_NEXT_PHYSICAL(block);
+	next->previous_physical = block;
+	next->flags |= TLSF_PREVIOUS_FREE;
+}
+
+function void tlsf_reset(TlsfAllocator *self) {
+	TlsfBlock *block, *sentinel;
+
+	self->fl_bitmap = 0;
+	for (unsigned int fl = 0; fl < TLSF_FL_COUNT; fl++) {
+		self->sl_bitmap[fl] = 0;
+		for (unsigned int sl = 0; sl < TLSF_SL_COUNT; sl++) {
+			self->blocks[fl][sl] = 0;
+		}
+	}
+
+	block = (TlsfBlock *) self->memory.data;
+	block->previous_physical = 0;
+	block->size = self->memory.length - 2 * TLSF_HEADER_SIZE;
+	block->flags = 0;
+
+	// Zero sized, permanently used block that stops coalescing at the end
+	sentinel = TLSF_NEXT_PHYSICAL(block);
+	sentinel->size = 0;
+	sentinel->flags = 0;
+
+	tlsf_insert_free(self, block);
+}
+
+function Result tlsf_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	TlsfAllocator *self;
+	TlsfBlock *block, *remainder;
+	unsigned int adjusted, fl, sl;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TlsfAllocator *) allocator;
+	if (size > self->memory.length) {
+		return res;
+	}
+
+	adjusted = (size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+	if (adjusted < TLSF_MIN_PAYLOAD) {
+		adjusted = TLSF_MIN_PAYLOAD;
+	}
+
+	tlsf_mapping_search(adjusted, &fl, &sl);
+	if (fl >= TLSF_FL_COUNT) {
+		return res;
+	}
+	block = tlsf_find_suitable(self, &fl, &sl);
+	if (block == 0) {
+		return res;
+	}
+	tlsf_remove_free(self, block);
+
+	if (block->size >= adjusted + sizeof(TlsfBlock)) {
+		remainder = (TlsfBlock *)((uint8_t *) block + TLSF_HEADER_SIZE + adjusted);
+		remainder->size = block->size - adjusted - TLSF_HEADER_SIZE;
+		remainder->flags = 0;
+		block->size = adjusted;
+		tlsf_insert_free(self, remainder);
+	} else {
+		TLSF_NEXT_PHYSICAL(block)->flags &= ~TLSF_PREVIOUS_FREE;
+	}
+	block->flags &= ~TLSF_BLOCK_FREE;
+
+	res.data.data = (void*)((uint8_t *) block + TLSF_HEADER_SIZE);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result tlsf_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	TlsfAllocator *self;
+	TlsfBlock *block, *next;
+	uint8_t *memory_min, *memory_max;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (TlsfAllocator *) allocator;
+	memory_min = (uint8_t *) self->memory.data;
+	memory_max = memory_min + self->memory.length;
+	if ((uint8_t *) ptr.data < memory_min + TLSF_HEADER_SIZE || (uint8_t *) ptr.data >= memory_max) {
+		return res;
+	}
+
+	block = (TlsfBlock *)((uint8_t *) ptr.data - TLSF_HEADER_SIZE);
+	if ((block->flags & TLSF_BLOCK_FREE) != 0 || block->size < ptr.length) {
+		return res;
+	}
+
+	if ((block->flags & TLSF_PREVIOUS_FREE) != 0) {
+		TlsfBlock *previous = block->previous_physical;
+		tlsf_remove_free(self, previous);
+		previous->size += TLSF_HEADER_SIZE + block->size;
+		block = previous;
+	}
+
+	next = TLSF_NEXT_PHYSICAL(block);
+	if ((next->flags & TLSF_BLOCK_FREE) != 0) {
+		tlsf_remove_free(self, next);
+		block->size += TLSF_HEADER_SIZE + next->size;
+	}
+
+	tlsf_insert_free(self, block);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Grows into a free physical successor and gives back any tail large enough
+// to hold a block of its own.
+function Result tlsf_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	TlsfAllocator *self;
+	TlsfBlock *block, *next, *remainder;
+	uint8_t *memory_min, *memory_max;
+	unsigned int adjusted;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TlsfAllocator *) allocator;
+	memory_min = (uint8_t *) self->memory.data;
+	memory_max = memory_min + self->memory.length;
+	if ((uint8_t *) ptr.data < memory_min + TLSF_HEADER_SIZE || (uint8_t *) ptr.data >= memory_max) {
+		return res;
+	}
+	if (size > self->memory.length) {
+		return res;
+	}
+
+	block = (TlsfBlock *)((uint8_t *) ptr.data - TLSF_HEADER_SIZE);
+	if ((block->flags & TLSF_BLOCK_FREE) != 0 || block->size < ptr.length) {
+		return res;
+	}
+
+	adjusted = (size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+	if (adjusted < TLSF_MIN_PAYLOAD) {
+		adjusted = TLSF_MIN_PAYLOAD;
+	}
+
+	if (adjusted > block->size) {
+		next = TLSF_NEXT_PHYSICAL(block);
+		if ((next->flags & TLSF_BLOCK_FREE) == 0 || block->size + TLSF_HEADER_SIZE + next->size < adjusted) {
+			return res;
+		}
+		tlsf_remove_free(self, next);
+		block->size += TLSF_HEADER_SIZE + next->size;
+		TLSF_NEXT_PHYSICAL(block)->flags &= ~TLSF_PREVIOUS_FREE;
+	}
+
+	if (block->size >= adjusted + sizeof(TlsfBlock)) {
+		remainder = (TlsfBlock *)((uint8_t *) block + TLSF_HEADER_SIZE + adjusted);
+		remainder->size = block->size - adjusted - TLSF_HEADER_SIZE;
+		remainder->flags = 0;
+		block->size = adjusted;
+
+		next = TLSF_NEXT_PHYSICAL(remainder);
+		if ((next->flags & TLSF_BLOCK_FREE) != 0) {
+			tlsf_remove_free(self, next);
+			remainder->size += TLSF_HEADER_SIZE + next->size;
+		}
+		tlsf_insert_free(self, remainder);
+	}
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result tlsf_freeall(Allocator *allocator) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	tlsf_reset((TlsfAllocator *) allocator);
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result tlsf_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	TlsfAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (TlsfAllocator *) allocator;
+	if (SLICE_WITHIN(self->memory, ptr)) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result init_tlsf_allocator(Allocator *allocator, unsigned int max_size) {
+	Result res;
+	TlsfAllocator *self;
+	unsigned int memory_size, buffer_size;
+	uintptr_t start;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || max_size == 0 || max_size > (UINT32_MAX >> 1)) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(TlsfAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(TlsfAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (TlsfAllocator *) res.data.data;
+	self->inside_methods = allocator;
+
+	// The initial block must sit in the list a max_size search starts from,
+	// and the buffer also holds its tag and the end sentinel.
+	memory_size = (max_size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+	if (memory_size < TLSF_MIN_PAYLOAD) {
+		memory_size = TLSF_MIN_PAYLOAD;
+	}
+	if (memory_size >= TLSF_SMALL_BLOCK) {
+		memory_size += (1u << (tlsf_fls(memory_size) - TLSF_SL_LOG2)) - 1;
+		memory_size &= ~((1u << (tlsf_fls(memory_size) - TLSF_SL_LOG2)) - 1);
+	}
+	memory_size += 2 * TLSF_HEADER_SIZE;
+	buffer_size = memory_size + TLSF_ALIGN;
+	res = ALLOC(allocator, buffer_size);
+	if (res.status != ERROR_OK) {
+		res.data.data = self;
+		res.data.length = sizeof(TlsfAllocator);
+		FREE(allocator, res.data);
+		return res;
+	}
+	if (res.data.length != buffer_size) {
+		FREE(allocator, res.data);
+		res.data.data = self;
+		res.data.length = sizeof(TlsfAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->buffer = res.data;
+
+	start = ((uintptr_t) self->buffer.data + TLSF_ALIGN - 1) & ~(uintptr_t)(TLSF_ALIGN - 1);
+	self->memory.data = (void*) start;
+	self->memory.length = memory_size;
+	tlsf_reset(self);
+
+	self->outside_methods.alloc = tlsf_alloc;
+	self->outside_methods.alloc_aligned = standard_alloc_aligned;
+	self->outside_methods.alloc_zeroed = standard_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = tlsf_resize;
+	self->outside_methods.free = tlsf_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = tlsf_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = tlsf_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(TlsfAllocator);
+	return res;
+}
+
+Result deinit_tlsf_allocator(Allocator *allocator) {
+	Result res;
+	TlsfAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (TlsfAllocator *) allocator;
+	res = FREE(self->inside_methods, self->buffer);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	res.data.data = self;
+	res.data.length = sizeof(TlsfAllocator);
+	return FREE(self->inside_methods, res.data);
+}
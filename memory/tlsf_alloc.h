@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+// Second level lists per power of two, and the first level index covering
+// every size an unsigned int can describe.
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+#define TLSF_ALIGN_LOG2 3
+#define TLSF_ALIGN (1 << TLSF_ALIGN_LOG2)
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK (1 << TLSF_FL_SHIFT)
+#define TLSF_FL_COUNT (32 - TLSF_FL_SHIFT + 1)
+
+#define TLSF_BLOCK_FREE 1
+#define TLSF_PREVIOUS_FREE 2
+
+// Every block starts with a boundary tag; the free list links overlap the
+// payload and only exist while the block is free.
+typedef struct tlsf_block_s TlsfBlock;
+struct tlsf_block_s {
+	TlsfBlock *previous_physical;
+	unsigned int size;
+	unsigned int flags;
+	TlsfBlock *next_free;
+	TlsfBlock *previous_free;
+};
+
+#define TLSF_HEADER_SIZE offsetof(TlsfBlock, next_free)
+#define TLSF_MIN_PAYLOAD (sizeof(TlsfBlock) - TLSF_HEADER_SIZE)
+
+struct tlsf_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	Slice buffer;
+	Slice memory;
+	uint32_t fl_bitmap;
+	uint32_t sl_bitmap[TLSF_FL_COUNT];
+	TlsfBlock *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+};
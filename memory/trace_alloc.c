@@ -0,0 +1,584 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRACE_ENTRIES(self) ((TraceEntry *)(self)->table.data)
+
+function unsigned int trace_hash(void *data, unsigned int capacity) {
+	uint64_t key = (uint64_t)(uintptr_t) data >> 3;
+
+	key *= 0x9e3779b97f4a7c15ULL;
+	return (unsigned int)(key >> 32) & (capacity - 1);
+}
+
+function TraceEntry *trace_find(TraceAllocator *self, void *data) {
+	TraceEntry *entries = TRACE_ENTRIES(self);
+	unsigned int index = trace_hash(data, self->capacity);
+
+	while (entries[index].data != 0) {
+		if (entries[index].data == data) {
+			return &entries[index];
+		}
+		index = (index + 1) & (self->capacity - 1);
+	}
+
+	return 0;
+}
+
+function void trace_place(TraceEntry *entries, unsigned int capacity, TraceEntry entry) {
+	unsigned int index = trace_hash(entry.data, capacity);
+
+	while (entries[index].data != 0) {
+		index = (index + 1) & (capacity - 1);
+	}
+	entries[index] = entry;
+}
+
+function int trace_grow(TraceAllocator *self) {
+	Result res;
+	TraceEntry *old_entries, *new_entries;
+	unsigned int capacity;
+
+	capacity = self->capacity << 1;
+	res = ALLOC_ZEROED(self->inside_methods, capacity * sizeof(TraceEntry));
+	if (res.status != ERROR_OK) {
+		return 0;
+	}
+
+	old_entries = TRACE_ENTRIES(self);
+	new_entries = (TraceEntry *) res.data.data;
+	for (unsigned int index = 0; index < self->capacity; index++) {
+		if (old_entries[index].data != 0) {
+			trace_place(new_entries, capacity, old_entries[index]);
+		}
+	}
+
+	FREE(self->inside_methods, self->table);
+	self->table = res.data;
+	self->capacity = capacity;
+	return 1;
+}
+
+function int trace_insert(TraceAllocator *self, Slice ptr, void *site) {
+	TraceEntry entry;
+
+	if ((self->count + 1) * 4 > self->capacity * 3 && !trace_grow(self)) {
+		return 0;
+	}
+
+	entry.data = ptr.data;
+	entry.length = ptr.length;
+	entry.site = site;
+	trace_place(TRACE_ENTRIES(self), self->capacity, entry);
+	self->count++;
+	return 1;
+}
+
+function void trace_remove(TraceAllocator *self, TraceEntry *entry) {
+	TraceEntry *entries = TRACE_ENTRIES(self);
+	unsigned int hole, index, home;
+
+	hole = entry - entries;
+	index = hole;
+	for (;;) {
+		index = (index + 1) & (self->capacity - 1);
+		if (entries[index].data == 0) {
+			break;
+		}
+
+		// Entries whose home lies cyclically in (hole, index] stay put
+		home = trace_hash(entries[index].data, self->capacity);
+		if (hole <= index ? (hole < home && home <= index) : (hole < home || home <= index)) {
+			continue;
+		}
+		entries[hole] = entries[index];
+		hole = index;
+	}
+
+	entries[hole].data = 0;
+	self->count--;
+}
+
+// Records an allocation the parent made for `site`, handing it back if the
+// table cannot grow to hold it.
+function Result trace_record(TraceAllocator *self, Result res, void *site) {
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (!trace_insert(self, res.data, site)) {
+		FREE(self->inside_methods, res.data);
+		BASE_ERROR_RESULT(res);
+	}
+	return res;
+}
+
+function Result trace_alloc(Allocator *allocator, unsigned int size) {
+	Result res;
+	TraceAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res = trace_record(self, ALLOC(self->inside_methods, size), __builtin_return_address(0));
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result trace_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	TraceAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res = trace_record(self, ALLOC_ALIGNED(self->inside_methods, size, alignment), __builtin_return_address(0));
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result trace_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	TraceAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res = trace_record(self, ALLOC_ZEROED(self->inside_methods, size), __builtin_return_address(0));
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// The call site is taken here rather than in standard_alloc_batch, which
+// would otherwise be blamed for every block of the batch
+function Result trace_alloc_batch(Allocator *allocator, const unsigned int *sizes, Slice *out, unsigned int count) {
+	Result res;
+	TraceAllocator *self;
+	void *site;
+	unsigned int made = 0;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || sizes == 0 || out == 0 || count == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	site = __builtin_return_address(0);
+	pthread_mutex_lock(&self->lock);
+	while (made < count && !failed) {
+		BASE_ERROR_RESULT(res);
+		if (sizes[made] != 0) {
+			res = trace_record(self, ALLOC(self->inside_methods, sizes[made]), site);
+		}
+		if (res.status != ERROR_OK) {
+			failed = 1;
+			break;
+		}
+		out[made++] = res.data;
+		failed = res.data.length != sizes[made - 1];
+	}
+
+	if (failed) {
+		while (made-- > 0) {
+			if (FREE(self->inside_methods, out[made]).status == ERROR_OK) {
+				trace_remove(self, trace_find(self, out[made].data));
+			}
+		}
+		pthread_mutex_unlock(&self->lock);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	res.status = ERROR_OK;
+	res.data.data = out;
+	res.data.length = count * sizeof(Slice);
+	return res;
+}
+
+function Result trace_clone(Allocator *allocator, Slice ptr) {
+	Result res;
+	TraceAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	res = trace_record(self, ALLOC(self->inside_methods, ptr.length), __builtin_return_address(0));
+	pthread_mutex_unlock(&self->lock);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	memcpy(res.data.data, ptr.data, ptr.length < res.data.length ? ptr.length : res.data.length);
+	return res;
+}
+
+function Result trace_realloc(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	TraceAllocator *self;
+	TraceEntry *entry, moved;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	entry = trace_find(self, ptr.data);
+	if (entry == 0) {
+		self->invalid_frees++;
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	// Make room first so that recording the result cannot fail
+	if ((self->count + 1) * 4 > self->capacity * 3) {
+		if (!trace_grow(self)) {
+			pthread_mutex_unlock(&self->lock);
+			return res;
+		}
+		entry = trace_find(self, ptr.data);
+	}
+
+	res = REALLOC(self->inside_methods, ptr, size);
+	if (res.status == ERROR_OK) {
+		trace_remove(self, entry);
+		moved.data = res.data.data;
+		moved.length = res.data.length;
+		moved.site = __builtin_return_address(0);
+		trace_place(TRACE_ENTRIES(self), self->capacity, moved);
+		self->count++;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+function Result trace_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	TraceAllocator *self;
+	TraceEntry *entry;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	entry = trace_find(self, ptr.data);
+	if (entry != 0) {
+		res = RESIZE(self->inside_methods, ptr, size);
+		if (res.status == ERROR_OK) {
+			entry->length = res.data.length;
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// Frees of untracked memory are counted and refused rather than forwarded
+function Result trace_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	TraceAllocator *self;
+	TraceEntry *entry;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	entry = trace_find(self, ptr.data);
+	if (entry == 0 || entry->length != ptr.length) {
+		self->invalid_frees++;
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+
+	res = FREE(self->inside_methods, ptr);
+	if (res.status == ERROR_OK) {
+		trace_remove(self, entry);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+// Frees every block the wrapper still tracks, one FREE each
+function Result trace_freeall(Allocator *allocator) {
+	Result res;
+	TraceAllocator *self;
+	TraceEntry *entry;
+	Slice ptr;
+	int failed = 0;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	// A removal can shift the next entry of the run into the same index, so
+	// the index only advances past empty slots and blocks the parent refused
+	for (unsigned int index = 0; index < self->capacity;) {
+		entry = &TRACE_ENTRIES(self)[index];
+		if (entry->data == 0) {
+			index++;
+			continue;
+		}
+
+		ptr.data = entry->data;
+		ptr.length = entry->length;
+		if (FREE(self->inside_methods, ptr).status == ERROR_OK) {
+			trace_remove(self, entry);
+		} else {
+			failed = 1;
+			index++;
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	if (!failed) {
+		res.status = ERROR_OK;
+	}
+	return res;
+}
+
+function int trace_site_address_cmp(const void *a, const void *b) {
+	uintptr_t site_a = (uintptr_t)((const TraceSite *) a)->site;
+	uintptr_t site_b = (uintptr_t)((const TraceSite *) b)->site;
+
+	return site_a < site_b ? -1 : site_a > site_b;
+}
+
+function int trace_site_bytes_cmp(const void *a, const void *b) {
+	const TraceSite *site_a = (const TraceSite *) a;
+	const TraceSite *site_b = (const TraceSite *) b;
+
+	if (site_a->bytes != site_b->bytes) {
+		return site_a->bytes < site_b->bytes ? 1 : -1;
+	}
+	return site_a->allocations < site_b->allocations ? 1 : site_a->allocations > site_b->allocations ? -1 : 0;
+}
+
+// Fills `sites` with the outstanding allocations grouped by call site,
+// largest first. Sites that do not fit are dropped from the tail.
+Result trace_allocator_report(TraceAllocator *self, TraceSite *sites, unsigned int capacity) {
+	Result res;
+	TraceEntry *entries;
+	TraceSite *grouped;
+	unsigned int count, merged;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || (sites == 0 && capacity != 0)) {
+		return res;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	res = ALLOC(self->inside_methods, (self->count + 1) * sizeof(TraceSite));
+	if (res.status != ERROR_OK) {
+		pthread_mutex_unlock(&self->lock);
+		return res;
+	}
+	grouped = (TraceSite *) res.data.data;
+
+	count = 0;
+	entries = TRACE_ENTRIES(self);
+	for (unsigned int index = 0; index < self->capacity; index++) {
+		if (entries[index].data != 0) {
+			grouped[count].site = entries[index].site;
+			grouped[count].allocations = 1;
+			grouped[count].bytes = entries[index].length;
+			count++;
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	// Sorting by site brings each site's allocations together
+	qsort(grouped, count, sizeof(TraceSite), trace_site_address_cmp);
+	merged = 0;
+	for (unsigned int index = 0; index < count; index++) {
+		if (merged != 0 && grouped[merged - 1].site == grouped[index].site) {
+			grouped[merged - 1].allocations++;
+			grouped[merged - 1].bytes += grouped[index].bytes;
+		} else {
+			grouped[merged++] = grouped[index];
+		}
+	}
+	qsort(grouped, merged, sizeof(TraceSite), trace_site_bytes_cmp);
+
+	if (merged > capacity) {
+		merged = capacity;
+	}
+	if (merged != 0) {
+		memcpy(sites, grouped, merged * sizeof(TraceSite));
+	}
+	FREE(self->inside_methods, res.data);
+
+	res.status = ERROR_OK;
+	res.data.data = sites;
+	res.data.length = merged * sizeof(TraceSite);
+	return res;
+}
+
+Result trace_allocator_dump(TraceAllocator *self, int fd, unsigned int max_sites) {
+	Result res;
+	TraceSite *sites;
+	unsigned int count, live, invalid_frees;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || max_sites == 0) {
+		return res;
+	}
+
+	res = ALLOC(self->inside_methods, max_sites * sizeof(TraceSite));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	sites = (TraceSite *) res.data.data;
+
+	res = trace_allocator_report(self, sites, max_sites);
+	if (res.status != ERROR_OK) {
+		res.data.data = sites;
+		res.data.length = max_sites * sizeof(TraceSite);
+		FREE(self->inside_methods, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	count = res.data.length / sizeof(TraceSite);
+	pthread_mutex_lock(&self->lock);
+	live = self->count;
+	invalid_frees = self->invalid_frees;
+	pthread_mutex_unlock(&self->lock);
+
+	dprintf(fd, "%u live allocations, %u invalid frees\n", live, invalid_frees);
+	for (unsigned int index = 0; index < count; index++) {
+		dprintf(
+			fd, "  %p: %u allocations, %lu bytes\n",
+			sites[index].site, sites[index].allocations, (unsigned long) sites[index].bytes
+		);
+	}
+
+	res.data.data = sites;
+	res.data.length = max_sites * sizeof(TraceSite);
+	return FREE(self->inside_methods, res.data);
+}
+
+// Exact: only live allocations made through this wrapper are claimed
+function Result trace_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	TraceAllocator *self;
+	TraceEntry *entry;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (TraceAllocator *) allocator;
+	pthread_mutex_lock(&self->lock);
+	entry = trace_find(self, ptr.data);
+	if (entry != 0 && entry->length == ptr.length) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	pthread_mutex_unlock(&self->lock);
+	return res;
+}
+
+Result new_trace_allocator(Allocator *allocator) {
+	Result res;
+	TraceAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	res = ALLOC(allocator, sizeof(TraceAllocator));
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	if (res.data.length != sizeof(TraceAllocator)) {
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+
+	self = (TraceAllocator *) res.data.data;
+	self->inside_methods = allocator;
+	self->capacity = TRACE_INITIAL_CAPACITY;
+	self->count = 0;
+	self->invalid_frees = 0;
+
+	res = ALLOC_ZEROED(allocator, TRACE_INITIAL_CAPACITY * sizeof(TraceEntry));
+	if (res.status != ERROR_OK) {
+		res.data.data = self;
+		res.data.length = sizeof(TraceAllocator);
+		FREE(allocator, res.data);
+		BASE_ERROR_RESULT(res);
+		return res;
+	}
+	self->table = res.data;
+	pthread_mutex_init(&self->lock, 0);
+
+	self->outside_methods.alloc = trace_alloc;
+	self->outside_methods.alloc_aligned = trace_alloc_aligned;
+	self->outside_methods.alloc_zeroed = trace_alloc_zeroed;
+	self->outside_methods.alloc_batch = trace_alloc_batch;
+	self->outside_methods.realloc = trace_realloc;
+	self->outside_methods.resize = trace_resize;
+	self->outside_methods.free = trace_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = trace_freeall;
+	self->outside_methods.clone = trace_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = trace_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(TraceAllocator);
+	return res;
+}
+
+// Outstanding allocations are left with the parent; report them first.
+Result deinit_trace_allocator(TraceAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	res = FREE(self->inside_methods, self->table);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+	pthread_mutex_destroy(&self->lock);
+
+	res.data.data = self;
+	res.data.length = sizeof(TraceAllocator);
+	return FREE(self->inside_methods, res.data);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define TRACE_INITIAL_CAPACITY 256
+
+// Open addressing with linear probing; removal shifts the run back so the
+// table never needs tombstones.
+typedef struct trace_entry_s TraceEntry;
+struct trace_entry_s {
+	void *data;
+	void *site;
+	unsigned int length;
+};
+
+struct trace_alloc_s {
+	Allocator outside_methods;
+	Allocator *inside_methods;
+	pthread_mutex_t lock;
+	Slice table;
+	unsigned int capacity;
+	unsigned int count;
+	unsigned int invalid_frees;
+};
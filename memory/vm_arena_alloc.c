@@ -0,0 +1,290 @@
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#define VM_ARENA_ROUND(size, to) (((size) + (to) - 1) & ~((size_t)(to) - 1))
+
+// Commits whole granules so the bump pointer rarely needs a system call
+function int vm_arena_commit(VmArenaAllocator *self, size_t end) {
+	size_t target;
+
+	if (end <= self->committed) {
+		return 1;
+	}
+
+	target = VM_ARENA_ROUND(end, VM_ARENA_COMMIT_GRANULE);
+	if (target > self->reserved) {
+		target = self->reserved;
+	}
+	if (end > target) {
+		return 0;
+	}
+	if (mprotect(self->base + self->committed, target - self->committed, PROT_READ | PROT_WRITE) != 0) {
+		return 0;
+	}
+
+	self->committed = target;
+	return 1;
+}
+
+function int vm_arena_is_last(VmArenaAllocator *self, Slice ptr) {
+	return (uint8_t *) ptr.data >= self->base &&
+		(uint8_t *) ptr.data + ptr.length == self->base + self->used;
+}
+
+function Result vm_arena_alloc_aligned(Allocator *allocator, unsigned int size, unsigned int alignment) {
+	Result res;
+	VmArenaAllocator *self;
+	size_t offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0 || !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
+	if (alignment < VM_ARENA_ALIGN) {
+		alignment = VM_ARENA_ALIGN;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	offset = VM_ARENA_ROUND((uintptr_t)(self->base + self->used), alignment) - (uintptr_t) self->base;
+	if (offset > self->reserved || self->reserved - offset < size) {
+		return res;
+	}
+	if (!vm_arena_commit(self, offset + size)) {
+		return res;
+	}
+	self->used = offset + size;
+	if (self->used > self->dirty) {
+		self->dirty = self->used;
+	}
+
+	res.data.data = (void*)(self->base + offset);
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result vm_arena_alloc(Allocator *allocator, unsigned int size) {
+	return vm_arena_alloc_aligned(allocator, size, VM_ARENA_ALIGN);
+}
+
+function Result vm_arena_alloc_zeroed(Allocator *allocator, unsigned int size) {
+	Result res;
+	VmArenaAllocator *self;
+	size_t dirty, offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || size == 0) {
+		return res;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	dirty = self->dirty;
+	res = vm_arena_alloc_aligned(allocator, size, VM_ARENA_ALIGN);
+	if (res.status != ERROR_OK) {
+		return res;
+	}
+
+	offset = (uint8_t *) res.data.data - self->base;
+	if (offset < dirty) {
+		memset(res.data.data, 0, dirty - offset < size ? dirty - offset : size);
+	}
+
+	return res;
+}
+
+// Only the most recent allocation can be given back
+function Result vm_arena_free(Allocator *allocator, Slice ptr) {
+	Result res;
+	VmArenaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	if (vm_arena_is_last(self, ptr)) {
+		self->used = (uint8_t *) ptr.data - self->base;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+// The reservation never moves, so the last allocation can grow up to its end
+function Result vm_arena_resize(Allocator *allocator, Slice ptr, unsigned int size) {
+	Result res;
+	VmArenaAllocator *self;
+	size_t offset;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.length == 0 || ptr.data == 0 || size == 0) {
+		return res;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	if (vm_arena_is_last(self, ptr)) {
+		offset = (uint8_t *) ptr.data - self->base;
+		if (self->reserved - offset < size || !vm_arena_commit(self, offset + size)) {
+			return res;
+		}
+		self->used = offset + size;
+		if (self->used > self->dirty) {
+			self->dirty = self->used;
+		}
+	} else if (size > ptr.length) {
+		return res;
+	}
+
+	res.data.data = ptr.data;
+	res.data.length = size;
+	res.status = ERROR_OK;
+	return res;
+}
+
+// Pages past the kept granules go back to the system and fault in as
+// zeroes when they are committed again.
+function int vm_arena_decommit(VmArenaAllocator *self, size_t keep) {
+	keep = VM_ARENA_ROUND(keep, VM_ARENA_COMMIT_GRANULE);
+	if (keep < self->retain) {
+		keep = self->retain;
+	}
+	if (self->committed <= keep) {
+		return 1;
+	}
+
+	if (madvise(self->base + keep, self->committed - keep, MADV_DONTNEED) != 0) {
+		return 0;
+	}
+	if (mprotect(self->base + keep, self->committed - keep, PROT_NONE) != 0) {
+		return 0;
+	}
+	self->committed = keep;
+	if (self->dirty > keep) {
+		self->dirty = keep;
+	}
+	return 1;
+}
+
+function Result vm_arena_freeall(Allocator *allocator) {
+	Result res;
+	VmArenaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0) {
+		return res;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	self->used = sizeof(VmArenaAllocator);
+	if (!vm_arena_decommit(self, 0)) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+Result vm_arena_trim(VmArenaAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0 || !vm_arena_decommit(self, self->used)) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+function Result vm_arena_owns(Allocator *allocator, Slice ptr) {
+	Result res;
+	VmArenaAllocator *self;
+	BASE_ERROR_RESULT(res);
+
+	if (allocator == 0 || ptr.data == 0) {
+		return res;
+	}
+
+	self = (VmArenaAllocator *) allocator;
+	if ((uint8_t *) ptr.data >= self->base &&
+		(uint8_t *) ptr.data + ptr.length <= self->base + self->reserved) {
+		res.status = ERROR_OK;
+		res.data = ptr;
+	}
+	return res;
+}
+
+Result new_vm_arena_allocator(size_t reserve, size_t retain) {
+	Result res;
+	VmArenaAllocator *self;
+	uint8_t *base;
+	BASE_ERROR_RESULT(res);
+
+	if (reserve == 0 || reserve > SIZE_MAX - VM_ARENA_COMMIT_GRANULE) {
+		return res;
+	}
+
+	reserve = VM_ARENA_ROUND(reserve, VM_ARENA_COMMIT_GRANULE);
+	base = (uint8_t *) mmap(0, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED) {
+		return res;
+	}
+	if (mprotect(base, VM_ARENA_COMMIT_GRANULE, PROT_READ | PROT_WRITE) != 0) {
+		munmap(base, reserve);
+		return res;
+	}
+
+	if (retain < VM_ARENA_COMMIT_GRANULE) {
+		retain = VM_ARENA_COMMIT_GRANULE;
+	}
+	if (retain > reserve) {
+		retain = reserve;
+	}
+
+	self = (VmArenaAllocator *) base;
+	self->base = base;
+	self->reserved = reserve;
+	self->committed = VM_ARENA_COMMIT_GRANULE;
+	self->used = sizeof(VmArenaAllocator);
+	self->dirty = self->used;
+	self->retain = VM_ARENA_ROUND(retain, VM_ARENA_COMMIT_GRANULE);
+
+	self->outside_methods.alloc = vm_arena_alloc;
+	self->outside_methods.alloc_aligned = vm_arena_alloc_aligned;
+	self->outside_methods.alloc_zeroed = vm_arena_alloc_zeroed;
+	self->outside_methods.alloc_batch = standard_alloc_batch;
+	self->outside_methods.realloc = standard_realloc;
+	self->outside_methods.resize = vm_arena_resize;
+	self->outside_methods.free = vm_arena_free;
+	self->outside_methods.free_batch = standard_free_batch;
+	self->outside_methods.freeall = vm_arena_freeall;
+	self->outside_methods.clone = standard_clone;
+	self->outside_methods.slice_split = standard_slice_split;
+	self->outside_methods.owns = vm_arena_owns;
+
+	res.status = ERROR_OK;
+	res.data.data = self;
+	res.data.length = sizeof(VmArenaAllocator);
+	return res;
+}
+
+Result deinit_vm_arena_allocator(VmArenaAllocator *self) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (self == 0) {
+		return res;
+	}
+
+	if (munmap(self->base, self->reserved) != 0) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	return res;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../utilities.h"
+#include "../memory.h"
+
+#define VM_ARENA_ALIGN 8
+#define VM_ARENA_COMMIT_GRANULE (64 * 1024)
+
+// The allocator lives at the start of its own reservation, so the first
+// granule is always committed.
+struct vm_arena_alloc_s {
+	Allocator outside_methods;
+	uint8_t *base;
+	size_t reserved;
+	size_t committed;
+	size_t used;
+	// High-water mark of `used`; pages past it are still fresh zeroes
+	size_t dirty;
+	size_t retain;
+};
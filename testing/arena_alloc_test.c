@@ -0,0 +1,355 @@
+#include "arena_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+TestResult *arena_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[arena_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = new_arena_allocator(heap, 256, ARENA_RETAIN_ALL);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate arena allocator");
+		return result;
+	}
+
+	res = deinit_arena_allocator((ArenaAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit arena allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_growth(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	Result res;
+	unsigned int chunks;
+	INIT_RESULT(result, "[arena_alloc_growth] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_ALL).data.data;
+
+	for (unsigned int index = 0; index < 64; index++) {
+		res = ALLOC((Allocator *) arena, 100);
+		if (res.status != ERROR_OK || res.data.length != 100) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Allocation %u failed to grow the arena",
+				index
+			);
+			deinit_arena_allocator(arena);
+			return result;
+		}
+		memset(res.data.data, index, res.data.length);
+	}
+
+	res = ALLOC((Allocator *) arena, 100000);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Allocation larger than the next chunk failed");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	chunks = 0;
+	for (ArenaChunk *chunk = arena->first; chunk != 0; chunk = chunk->next) {
+		chunks++;
+	}
+	if (chunks > 8) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Chunks do not grow geometrically: %u chunks",
+			chunks
+		);
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_free_last(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	Slice a, b;
+	Result res;
+	INIT_RESULT(result, "[arena_alloc_free_last] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_ALL).data.data;
+
+	a = ALLOC((Allocator *) arena, 16).data;
+	b = ALLOC((Allocator *) arena, 16).data;
+	FREE((Allocator *) arena, b);
+
+	res = ALLOC((Allocator *) arena, 16);
+	if (res.status != ERROR_OK || res.data.data != b.data) {
+		MSG_PRINT(result, "Freeing the last allocation did not roll back");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	res = REALLOC((Allocator *) arena, res.data, 64);
+	if (res.status != ERROR_OK || res.data.data != b.data || res.data.length != 64) {
+		MSG_PRINT(result, "Last allocation did not grow in place");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	res = REALLOC((Allocator *) arena, a, 1024);
+	if (res.status != ERROR_OK || res.data.length != 1024) {
+		MSG_PRINT(result, "Unable to grow an earlier allocation");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_retention(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	ArenaChunk *largest;
+	Slice first;
+	INIT_RESULT(result, "[arena_alloc_retention] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_LARGEST).data.data;
+
+	first = ALLOC((Allocator *) arena, 200).data;
+	ALLOC((Allocator *) arena, 200);
+	ALLOC((Allocator *) arena, 2000);
+	largest = arena->current;
+
+	if (FREEALL((Allocator *) arena).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free all allocations");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	if (arena->first != largest || largest->next != 0) {
+		MSG_PRINT(result, "Only the largest chunk should be retained");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	if (ALLOC((Allocator *) arena, 200).data.data != (void*) ARENA_CHUNK_DATA(largest)) {
+		MSG_PRINT(result, "Retained chunk is not reused");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	deinit_arena_allocator(arena);
+
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_NONE).data.data;
+	ALLOC((Allocator *) arena, 200);
+	ALLOC((Allocator *) arena, 2000);
+	FREEALL((Allocator *) arena);
+	if (arena->first != 0 || arena->next_size != 256) {
+		MSG_PRINT(result, "Chunks retained with ARENA_RETAIN_NONE");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	if (IS_NULL_SLICE(ALLOC((Allocator *) arena, 8).data) || IS_NULL_SLICE(first)) {
+		MSG_PRINT(result, "Unable to allocate after releasing every chunk");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_mark_rewind(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	ArenaMark mark;
+	Slice kept, scratch;
+	Result res;
+	INIT_RESULT(result, "[arena_alloc_mark_rewind] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_ALL).data.data;
+
+	kept = ALLOC((Allocator *) arena, 100).data;
+	memset(kept.data, 5, kept.length);
+	mark = arena_mark(arena);
+
+	// Spill into further chunks before rewinding
+	scratch = ALLOC((Allocator *) arena, 64).data;
+	for (unsigned int index = 0; index < 16; index++) {
+		ALLOC((Allocator *) arena, 200);
+	}
+
+	if (arena_rewind(arena, mark).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to rewind to mark");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	res = ALLOC((Allocator *) arena, 64);
+	if (res.status != ERROR_OK || res.data.data != scratch.data) {
+		MSG_PRINT(result, "Rewind did not release scratch allocations");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	if (((uint8_t *) kept.data)[99] != 5) {
+		MSG_PRINT(result, "Rewind clobbered allocations before the mark");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_scratch(TestResult *result) {
+	Scratch outer, inner;
+	Slice first;
+	Result res;
+	INIT_RESULT(result, "[arena_alloc_scratch] ");
+
+	if (scratch_begin(&outer, 0).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to begin scratch");
+		return result;
+	}
+	first = ALLOC((Allocator *) outer.arena, 32).data;
+
+	// Nested scratch must avoid the arena the caller is building into
+	if (scratch_begin(&inner, (Allocator *) outer.arena).status != ERROR_OK || inner.arena == outer.arena) {
+		MSG_PRINT(result, "Nested scratch aliases the conflicting arena");
+		release_scratch_arenas();
+		return result;
+	}
+	ALLOC((Allocator *) inner.arena, 32);
+	scratch_end(&inner);
+	scratch_end(&outer);
+
+	if (scratch_begin(&outer, 0).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to begin scratch again");
+		release_scratch_arenas();
+		return result;
+	}
+	res = ALLOC((Allocator *) outer.arena, 32);
+	if (res.status != ERROR_OK || res.data.data != first.data) {
+		MSG_PRINT(result, "Ending the scratch did not rewind the arena");
+		release_scratch_arenas();
+		return result;
+	}
+	scratch_end(&outer);
+
+	release_scratch_arenas();
+	result->status = TEST_PASS;
+	return result;
+}
+
+function int arena_test_all_zero(Slice s) {
+	for (unsigned int index = 0; index < s.length; index++) {
+		if (((uint8_t *) s.data)[index] != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+TestResult *arena_alloc_zeroed(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	Slice dirty, zeroed;
+	ArrayList al;
+	INIT_RESULT(result, "[arena_alloc_zeroed] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 1024, ARENA_RETAIN_ALL).data.data;
+
+	dirty = ALLOC((Allocator *) arena, 100).data;
+	memset(dirty.data, 0xff, dirty.length);
+	FREEALL((Allocator *) arena);
+
+	// Straddles the high-water mark: the reused head must be cleared
+	zeroed = ALLOC_ZEROED((Allocator *) arena, 400).data;
+	if (zeroed.data != dirty.data || !arena_test_all_zero(zeroed)) {
+		MSG_PRINT(result, "Reused arena memory was not cleared");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+	memset(zeroed.data, 0xff, zeroed.length);
+
+	dirty = ALLOC((Allocator *) arena, 64).data;
+	memset(dirty.data, 0xff, dirty.length);
+	FREE((Allocator *) arena, dirty);
+	zeroed = ALLOC_ZEROED((Allocator *) arena, 128).data;
+	if (zeroed.data != dirty.data || !arena_test_all_zero(zeroed)) {
+		MSG_PRINT(result, "Memory given back by FREE was not cleared");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	// Array lists are built on ALLOC_ZEROED
+	FREEALL((Allocator *) arena);
+	new_array_list(&al, (Allocator *) arena, sizeof(uint64_t), 128);
+	if (!arena_test_all_zero(al.buffer)) {
+		MSG_PRINT(result, "A new array list on reused memory is not zeroed");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *arena_alloc_trim(TestResult *result) {
+	Allocator *heap;
+	ArenaAllocator *arena;
+	unsigned int chunks;
+	INIT_RESULT(result, "[arena_alloc_trim] ");
+
+	heap = get_raw_heap_allocator();
+	arena = (ArenaAllocator *) new_arena_allocator(heap, 256, ARENA_RETAIN_ALL).data.data;
+
+	for (unsigned int index = 0; index < 16; index++) {
+		ALLOC((Allocator *) arena, 200);
+	}
+	FREEALL((Allocator *) arena);
+	ALLOC((Allocator *) arena, 8);
+
+	if (arena_trim(arena).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to trim");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	chunks = 0;
+	for (ArenaChunk *chunk = arena->first; chunk != 0; chunk = chunk->next) {
+		chunks++;
+	}
+	if (chunks != 1 || arena->current != arena->first) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%u chunks survived the trim",
+			chunks
+		);
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	FREEALL((Allocator *) arena);
+	arena_trim(arena);
+	if (arena->first != 0 || IS_NULL_SLICE(ALLOC((Allocator *) arena, 8).data)) {
+		MSG_PRINT(result, "Unable to allocate after trimming every chunk");
+		deinit_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *arena_alloc_init_deinit(TestResult*);
+TestResult *arena_alloc_growth(TestResult*);
+TestResult *arena_alloc_free_last(TestResult*);
+TestResult *arena_alloc_retention(TestResult*);
+TestResult *arena_alloc_mark_rewind(TestResult*);
+TestResult *arena_alloc_scratch(TestResult*);
+TestResult *arena_alloc_zeroed(TestResult*);
+TestResult *arena_alloc_trim(TestResult*);
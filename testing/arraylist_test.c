@@ -453,3 +453,149 @@ TestResult *array_list_replace(TestResult *result) {
 		result->status = TEST_PASS;
     return result;
 }
+
+TestResult *array_list_aligned(TestResult *result) {
+    ArrayList al;
+    INIT_RESULT(result, "[array_list_aligned]");
+
+    Allocator *linear = (Allocator *) init_linear_allocator(get_raw_heap_allocator(), 16384).data.data;
+    Result res = new_array_list_aligned(&al, linear, sizeof(int), 4, 64);
+    if (res.status != ERROR_OK) {
+        MSG_PRINT(result, " Unable to create aligned ArrayList");
+        deinit_linear_allocator(linear);
+        return result;
+    }
+
+    // Something live behind the buffer forces the growth to move it
+    Slice fence = ALLOC(linear, 8).data;
+    for (int value = 0; value < 100; value++) {
+        Slice s = { &value, sizeof(int) };
+        if (LINEAR_PUSH(&al, s).status != ERROR_OK) {
+            MSG_PRINT(result, " Unable to push value");
+            deinit_linear_allocator(linear);
+            return result;
+        }
+        if (((uintptr_t) al.buffer.data & 63) != 0) {
+            MSG_PRINT(result, " Growth lost the buffer alignment");
+            deinit_linear_allocator(linear);
+            return result;
+        }
+    }
+    if (RESULT_UNWRAP(INDEXING_GET(&al, 0), int) != 0 || RESULT_UNWRAP(INDEXING_GET(&al, 99), int) != 99) {
+        MSG_PRINT(result, " Values were not kept across growth");
+        deinit_linear_allocator(linear);
+        return result;
+    }
+
+    FREE(linear, fence);
+    deinit_array_list(&al);
+    deinit_linear_allocator(linear);
+    result->status = TEST_PASS;
+    return result;
+}
+
+TestResult *array_list_deinit_items(TestResult *result) {
+    ArrayList al;
+    unsigned int sizes[8] = { 16, 16, 16, 16, 64, 64, 2048, 2048 };
+    Slice items[8];
+    INIT_RESULT(result, "[array_list_deinit_items]");
+
+    StatsAllocator *stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+    Allocator *magazine = (Allocator *) new_magazine_allocator((Allocator *) stats).data.data;
+    AllocatorStats snapshot;
+
+    Result res = new_array_list(&al, magazine, sizeof(Slice), 4);
+    if (res.status != ERROR_OK) {
+        MSG_PRINT(result, " Unable to create new ArrayList");
+        deinit_magazine_allocator((MagazineAllocator *) magazine);
+        deinit_stats_allocator(stats);
+        return result;
+    }
+
+    if (ALLOC_BATCH(magazine, sizes, items, 8).status != ERROR_OK) {
+        MSG_PRINT(result, " Unable to allocate the items");
+        deinit_array_list(&al);
+        deinit_magazine_allocator((MagazineAllocator *) magazine);
+        deinit_stats_allocator(stats);
+        return result;
+    }
+    for (unsigned int index = 0; index < 8; index++) {
+        Slice s = { &items[index], sizeof(Slice) };
+        LINEAR_PUSH(&al, s);
+    }
+
+    res = deinit_array_list_items(&al);
+    if (res.status != ERROR_OK || al.item_count != 0) {
+        MSG_PRINT(result, " Unable to deinit the items");
+        deinit_array_list(&al);
+        deinit_magazine_allocator((MagazineAllocator *) magazine);
+        deinit_stats_allocator(stats);
+        return result;
+    }
+    deinit_array_list(&al);
+    deinit_magazine_allocator((MagazineAllocator *) magazine);
+
+    // Every byte taken from the heap, items included, must have come back
+    stats_allocator_snapshot(stats, &snapshot);
+    if (snapshot.bytes_live != 0) {
+        sprintf(result->message + strlen(result->message), " %lu bytes were not freed", (unsigned long) snapshot.bytes_live);
+        deinit_stats_allocator(stats);
+        return result;
+    }
+
+    deinit_stats_allocator(stats);
+    result->status = TEST_PASS;
+    return result;
+}
+
+TestResult *array_list_shrink_capacity(TestResult *result) {
+    ArrayList al;
+    INIT_RESULT(result, "[array_list_shrink_capacity]");
+
+    Allocator *heap = get_raw_heap_allocator();
+    if (new_array_list(&al, heap, sizeof(int), 16).status != ERROR_OK) {
+        MSG_PRINT(result, " Unable to create new ArrayList");
+        return result;
+    }
+
+    for (int index = 0; index < 100; index++) {
+        Slice s = { &index, sizeof(int) };
+        LINEAR_PUSH(&al, s);
+    }
+    while (al.item_count > 3) {
+        LINEAR_POP(&al);
+    }
+
+    if (array_list_shrink(&al).status != ERROR_OK || al.buffer.length != 3 * sizeof(int)) {
+        MSG_PRINT(result, " Capacity was not dropped to the items held");
+        deinit_array_list(&al);
+        return result;
+    }
+    for (int index = 0; index < 3; index++) {
+        if (*(int *) INDEXING_GET(&al, index).data.data != index) {
+            MSG_PRINT(result, " Items changed while shrinking");
+            deinit_array_list(&al);
+            return result;
+        }
+    }
+
+    // The list can still grow from a single item
+    al.item_count = 0;
+    if (array_list_shrink(&al).status != ERROR_OK || al.buffer.length != sizeof(int)) {
+        MSG_PRINT(result, " Empty list did not keep room for one item");
+        deinit_array_list(&al);
+        return result;
+    }
+    for (int index = 0; index < 5; index++) {
+        Slice s = { &index, sizeof(int) };
+        if (LINEAR_PUSH(&al, s).status != ERROR_OK) {
+            MSG_PRINT(result, " Unable to push after shrinking");
+            deinit_array_list(&al);
+            return result;
+        }
+    }
+
+    deinit_array_list(&al);
+    result->status = TEST_PASS;
+    return result;
+}
@@ -11,3 +11,6 @@ TestResult *array_list_remove(TestResult *result);
 TestResult *array_list_insert(TestResult *result);
 TestResult *array_list_swap(TestResult *result);
 TestResult *array_list_replace(TestResult *result);
+TestResult *array_list_aligned(TestResult *result);
+TestResult *array_list_deinit_items(TestResult *result);
+TestResult *array_list_shrink_capacity(TestResult *result);
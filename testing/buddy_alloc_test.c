@@ -0,0 +1,205 @@
+#include "buddy_alloc_test.h"
+#include "../memory.h"
+
+TestResult *buddy_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[buddy_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = init_buddy_allocator(heap, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate buddy allocator");
+		return result;
+	}
+
+	res = deinit_buddy_allocator((Allocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit buddy allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *buddy_alloc_split_merge(TestResult *result) {
+	Allocator *heap, *buddy;
+	Slice a, b;
+	Result res;
+	INIT_RESULT(result, "[buddy_alloc_split_merge] ");
+
+	heap = get_raw_heap_allocator();
+	buddy = (Allocator *) init_buddy_allocator(heap, 4096).data.data;
+
+	a = ALLOC(buddy, 100).data;
+	b = ALLOC(buddy, 128).data;
+	if (IS_NULL_SLICE(a) || IS_NULL_SLICE(b)) {
+		MSG_PRINT(result, "Unable to allocate blocks");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+	if ((uint8_t *) b.data != (uint8_t *) a.data + 128) {
+		MSG_PRINT(result, "Second block is not the buddy of the first");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	if (ALLOC(buddy, 4096).status == ERROR_OK) {
+		MSG_PRINT(result, "Whole arena allocated while blocks are live");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	FREE(buddy, a);
+	if (FREE(buddy, a).status == ERROR_OK) {
+		MSG_PRINT(result, "Double free was accepted");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+	FREE(buddy, b);
+
+	res = ALLOC(buddy, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Buddies were not merged");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	deinit_buddy_allocator(buddy);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *buddy_alloc_realloc_in_place(TestResult *result) {
+	Allocator *heap, *buddy;
+	Slice a, fence;
+	Result res;
+	INIT_RESULT(result, "[buddy_alloc_realloc_in_place] ");
+
+	heap = get_raw_heap_allocator();
+	buddy = (Allocator *) init_buddy_allocator(heap, 4096).data.data;
+
+	a = ALLOC(buddy, 64).data;
+	memset(a.data, 3, a.length);
+
+	// Doubling absorbs the free buddies without moving
+	for (unsigned int size = 128; size <= 1024; size <<= 1) {
+		res = REALLOC(buddy, a, size);
+		if (res.status != ERROR_OK || res.data.data != a.data) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Realloc to %u bytes moved the block",
+				size
+			);
+			deinit_buddy_allocator(buddy);
+			return result;
+		}
+		a = res.data;
+	}
+
+	fence = ALLOC(buddy, 1024).data;
+	res = REALLOC(buddy, a, 2048);
+	if (res.status != ERROR_OK || res.data.data == a.data || ((uint8_t *) res.data.data)[63] != 3) {
+		MSG_PRINT(result, "Realloc past a used buddy did not copy");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	FREE(buddy, res.data);
+	FREE(buddy, fence);
+	deinit_buddy_allocator(buddy);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *buddy_alloc_stats(TestResult *result) {
+	Allocator *heap, *buddy, *linear;
+	FragmentationStats stats;
+	Slice a;
+	INIT_RESULT(result, "[buddy_alloc_stats] ");
+
+	heap = get_raw_heap_allocator();
+	buddy = (Allocator *) init_buddy_allocator(heap, 4096).data.data;
+	linear = (Allocator *) init_linear_allocator(heap, 4096).data.data;
+
+	a = ALLOC(buddy, 100).data;
+	buddy_allocator_stats(buddy, &stats);
+	if (
+		stats.capacity != 4096 || stats.bytes_requested != 100 ||
+		stats.bytes_reserved != 128 || stats.bytes_free != 3968 ||
+		stats.free_blocks != 5 || stats.largest_free_block != 2048
+	) {
+		MSG_PRINT(result, "Buddy statistics are incorrect");
+		deinit_buddy_allocator(buddy);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	FREE(buddy, a);
+
+	a = ALLOC(linear, 100).data;
+	linear_allocator_stats(linear, &stats);
+	if (
+		stats.bytes_requested != 100 || stats.bytes_reserved != 104 ||
+		stats.bytes_free != stats.capacity - 104 || stats.free_blocks != 1 ||
+		stats.largest_free_block != stats.bytes_free
+	) {
+		MSG_PRINT(result, "Linear statistics are incorrect");
+		deinit_buddy_allocator(buddy);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	FREE(linear, a);
+
+	deinit_buddy_allocator(buddy);
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *buddy_alloc_aligned(TestResult *result) {
+	Allocator *heap, *buddy;
+	FragmentationStats stats;
+	Slice small, blocks[8];
+	INIT_RESULT(result, "[buddy_alloc_aligned] ");
+
+	heap = get_raw_heap_allocator();
+	buddy = (Allocator *) init_buddy_allocator(heap, 4096).data.data;
+
+	// A small block first, so plain allocations would land off the alignment
+	small = ALLOC(buddy, 16).data;
+	for (unsigned int index = 0; index < 8; index++) {
+		blocks[index] = ALLOC_ALIGNED(buddy, 24, 64 << (index & 3)).data;
+		if (IS_NULL_SLICE(blocks[index]) || ((uintptr_t) blocks[index].data & ((64u << (index & 3)) - 1)) != 0) {
+			MSG_PRINT(result, "Aligned allocation failed or was misplaced");
+			deinit_buddy_allocator(buddy);
+			return result;
+		}
+	}
+
+	if (!IS_NULL_SLICE(ALLOC_ALIGNED(buddy, 16, 8192).data)) {
+		MSG_PRINT(result, "Allocated past the alignment of the buffer");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	// Aligned blocks free like any other and merge back into one
+	for (unsigned int index = 0; index < 8; index++) {
+		if (FREE(buddy, blocks[index]).status != ERROR_OK) {
+			MSG_PRINT(result, "Unable to free an aligned block");
+			deinit_buddy_allocator(buddy);
+			return result;
+		}
+	}
+	FREE(buddy, small);
+	buddy_allocator_stats(buddy, &stats);
+	if (stats.free_blocks != 1 || stats.largest_free_block != 4096) {
+		MSG_PRINT(result, "Aligned blocks did not merge back");
+		deinit_buddy_allocator(buddy);
+		return result;
+	}
+
+	deinit_buddy_allocator(buddy);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *buddy_alloc_init_deinit(TestResult*);
+TestResult *buddy_alloc_split_merge(TestResult*);
+TestResult *buddy_alloc_realloc_in_place(TestResult*);
+TestResult *buddy_alloc_stats(TestResult*);
+TestResult *buddy_alloc_aligned(TestResult*);
@@ -0,0 +1,290 @@
+#include "budget_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <pthread.h>
+
+#define BUDGET_TEST_THREADS 4
+#define BUDGET_TEST_ROUNDS 20000
+
+typedef struct {
+	unsigned int soft;
+	unsigned int hard;
+	size_t last_excess;
+} BudgetTestCalls;
+
+function void budget_test_count(BudgetAllocator *budget, enum budget_level level, size_t excess, void *context) {
+	BudgetTestCalls *calls = (BudgetTestCalls *) context;
+
+	(void) budget;
+	if (level == BUDGET_SOFT) {
+		calls->soft++;
+	} else {
+		calls->hard++;
+	}
+	calls->last_excess = excess;
+}
+
+function void budget_test_shrink(BudgetAllocator *budget, enum budget_level level, size_t excess, void *context) {
+	(void) budget;
+	(void) level;
+	(void) excess;
+	array_list_shrink((ArrayList *) context);
+}
+
+function void *budget_test_worker(void *context) {
+	Allocator *allocator = (Allocator *) context;
+	Slice blocks[8] = {0};
+
+	for (unsigned int round = 0; round < BUDGET_TEST_ROUNDS; round++) {
+		unsigned int index = round & 7;
+
+		if (!IS_NULL_SLICE(blocks[index])) {
+			FREE(allocator, blocks[index]);
+			SET_NULL_SLICE(blocks[index]);
+		}
+		blocks[index] = ALLOC(allocator, 64 + (round * 37) % 1024).data;
+	}
+	for (unsigned int index = 0; index < 8; index++) {
+		if (!IS_NULL_SLICE(blocks[index])) {
+			FREE(allocator, blocks[index]);
+		}
+	}
+	return 0;
+}
+
+TestResult *budget_alloc_limits(TestResult *result) {
+	BudgetAllocator *budget;
+	Allocator *allocator;
+	BudgetTestCalls calls = {0};
+	BudgetUsage usage;
+	Slice first, second, third;
+	INIT_RESULT(result, "[budget_alloc_limits] ");
+
+	if (new_budget_allocator(get_raw_heap_allocator(), 2000, 1000).status == ERROR_OK) {
+		MSG_PRINT(result, "Accepted a soft limit above the hard one");
+		return result;
+	}
+
+	budget = (BudgetAllocator *) new_budget_allocator(get_raw_heap_allocator(), 1000, 2000).data.data;
+	if (budget == 0) {
+		MSG_PRINT(result, "Unable to instantiate budget allocator");
+		return result;
+	}
+	allocator = (Allocator *) budget;
+	budget_allocator_on_pressure(budget, budget_test_count, &calls);
+
+	first = ALLOC(allocator, 600).data;
+	if (IS_NULL_SLICE(first) || calls.soft != 0) {
+		MSG_PRINT(result, "Allocation under the soft limit raised pressure");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	second = ALLOC(allocator, 600).data;
+	if (IS_NULL_SLICE(second) || calls.soft != 1 || calls.last_excess != 200) {
+		MSG_PRINT(result, "Crossing the soft limit did not raise pressure once");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	// Staying above the soft limit does not call again
+	third = ALLOC(allocator, 100).data;
+	if (IS_NULL_SLICE(third) || calls.soft != 1) {
+		MSG_PRINT(result, "Pressure was raised again above the soft limit");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+	FREE(allocator, third);
+
+	third = ALLOC(allocator, 900).data;
+	if (!IS_NULL_SLICE(third) || calls.hard != 1 || calls.last_excess != 100) {
+		MSG_PRINT(result, "Allocation past the hard limit was not refused");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	first = REALLOC(allocator, first, 700).data;
+	second = REALLOC(allocator, second, 100).data;
+	budget_allocator_usage(budget, &usage);
+	if (usage.used != 800 || usage.peak != 1300 || usage.failures != 1 || usage.pressure_events != 2) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Usage reads %zu used, %zu peak, %lu failures, %lu events",
+			usage.used, usage.peak, (unsigned long) usage.failures, (unsigned long) usage.pressure_events
+		);
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	// A lower hard limit refuses new growth but leaves live blocks alone
+	if (budget_allocator_set_limits(budget, 500, 800).status != ERROR_OK || !IS_NULL_SLICE(ALLOC(allocator, 8).data)) {
+		MSG_PRINT(result, "Lowered hard limit was not applied");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	FREE(allocator, first);
+	FREE(allocator, second);
+	budget_allocator_usage(budget, &usage);
+	if (usage.used != 0) {
+		MSG_PRINT(result, "Frees were not credited");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	if (deinit_budget_allocator(budget).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit budget allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *budget_alloc_relief(TestResult *result) {
+	BudgetAllocator *budget;
+	Allocator *allocator;
+	ArrayList al;
+	Slice block;
+	BudgetUsage usage;
+	INIT_RESULT(result, "[budget_alloc_relief] ");
+
+	budget = (BudgetAllocator *) new_budget_allocator(get_raw_heap_allocator(), 4096, 8192).data.data;
+	if (budget == 0) {
+		MSG_PRINT(result, "Unable to instantiate budget allocator");
+		return result;
+	}
+	allocator = (Allocator *) budget;
+
+	if (new_array_list(&al, allocator, sizeof(int), 16).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to create ArrayList");
+		deinit_budget_allocator(budget);
+		return result;
+	}
+	for (int index = 0; index < 1024; index++) {
+		Slice s = { &index, sizeof(int) };
+		LINEAR_PUSH(&al, s);
+	}
+	al.item_count = 10;
+	budget_allocator_on_pressure(budget, budget_test_shrink, &al);
+
+	// Only fits once the callback drops the list's spare capacity
+	block = ALLOC(allocator, 6000).data;
+	if (IS_NULL_SLICE(block)) {
+		MSG_PRINT(result, "Pressure callback did not make room");
+		deinit_array_list(&al);
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	budget_allocator_usage(budget, &usage);
+	if (al.buffer.length != 10 * sizeof(int) || usage.used != 6000 + al.buffer.length) {
+		MSG_PRINT(result, "Shrunk list was not credited to the budget");
+		FREE(allocator, block);
+		deinit_array_list(&al);
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	FREE(allocator, block);
+	deinit_array_list(&al);
+	deinit_budget_allocator(budget);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *budget_alloc_threads(TestResult *result) {
+	BudgetAllocator *budget;
+	pthread_t threads[BUDGET_TEST_THREADS];
+	BudgetUsage usage;
+	INIT_RESULT(result, "[budget_alloc_threads] ");
+
+	// Tight enough that even one thread alone keeps running into the hard limit
+	budget = (BudgetAllocator *) new_budget_allocator(get_raw_heap_allocator(), 2048, 4096).data.data;
+	if (budget == 0) {
+		MSG_PRINT(result, "Unable to instantiate budget allocator");
+		return result;
+	}
+
+	for (unsigned int index = 0; index < BUDGET_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, budget_test_worker, budget);
+	}
+	for (unsigned int index = 0; index < BUDGET_TEST_THREADS; index++) {
+		pthread_join(threads[index], 0);
+	}
+
+	budget_allocator_usage(budget, &usage);
+	if (usage.used != 0 || usage.peak > 4096 || usage.failures == 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%zu bytes left, peak %zu, %lu failures",
+			usage.used, usage.peak, (unsigned long) usage.failures
+		);
+		deinit_budget_allocator(budget);
+		return result;
+	}
+
+	deinit_budget_allocator(budget);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *budget_alloc_freeall(TestResult *result) {
+	BasicLinearAllocator *linear, *large;
+	SegregatorAllocator *segregator;
+	BudgetAllocator *budget;
+	BudgetUsage usage;
+	Slice a, b;
+	INIT_RESULT(result, "[budget_alloc_freeall] ");
+
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(get_raw_heap_allocator(), 4096).data.data;
+	budget = (BudgetAllocator *) new_budget_allocator((Allocator *) linear, 1024, 2048).data.data;
+	if (budget == 0) {
+		MSG_PRINT(result, "Unable to instantiate budget allocator");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	a = ALLOC((Allocator *) budget, 128).data;
+	if (FREEALL((Allocator *) budget).status != ERROR_OK) {
+		MSG_PRINT(result, "Freeall failed with nothing to release");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	b = ALLOC((Allocator *) budget, 128).data;
+	if (IS_NULL_SLICE(b) || b.data == a.data || budget->inside_methods != (Allocator *) linear) {
+		MSG_PRINT(result, "Allocation after freeall overwrote the budget");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	budget_allocator_usage(budget, &usage);
+	if (usage.used != 256 || usage.hard_limit != 2048) {
+		MSG_PRINT(result, "Freeall changed the charged bytes");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	// A combinator with a budget child can still be reset as a whole
+	large = (BasicLinearAllocator *) new_basic_linear_allocator(get_raw_heap_allocator(), 4096).data.data;
+	segregator = (SegregatorAllocator *) new_segregator_allocator(
+		get_raw_heap_allocator(), 256, (Allocator *) budget, (Allocator *) large
+	).data.data;
+	if (segregator == 0 || FREEALL((Allocator *) segregator).status != ERROR_OK) {
+		MSG_PRINT(result, "Freeall failed through a segregator");
+		deinit_segregator_allocator(segregator);
+		deinit_basic_linear_allocator(large);
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_segregator_allocator(segregator);
+	deinit_basic_linear_allocator(large);
+	deinit_budget_allocator(budget);
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
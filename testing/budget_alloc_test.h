@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *budget_alloc_limits(TestResult*);
+TestResult *budget_alloc_relief(TestResult*);
+TestResult *budget_alloc_threads(TestResult*);
+TestResult *budget_alloc_freeall(TestResult*);
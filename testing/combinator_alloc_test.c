@@ -0,0 +1,204 @@
+#include "combinator_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <string.h>
+
+TestResult *allocator_owns(TestResult *result) {
+	Allocator *heap = get_raw_heap_allocator();
+	BasicLinearAllocator *first, *second;
+	Slice ptr, foreign;
+	int failed = 1;
+	INIT_RESULT(result, "[allocator_owns] ");
+
+	first = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 256).data.data;
+	second = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 256).data.data;
+	ptr = ALLOC((Allocator *) first, 32).data;
+	foreign = ALLOC(heap, 32).data;
+
+	if (OWNS((Allocator *) first, ptr).status != ERROR_OK) {
+		MSG_PRINT(result, "An allocator disowned its own allocation");
+	} else if (OWNS((Allocator *) second, ptr).status == ERROR_OK) {
+		MSG_PRINT(result, "An allocator claimed a sibling's allocation");
+	} else if (OWNS((Allocator *) first, foreign).status == ERROR_OK) {
+		MSG_PRINT(result, "An allocator claimed heap memory");
+	} else if (OWNS(heap, foreign).status == ERROR_OK) {
+		MSG_PRINT(result, "The raw heap claimed memory it cannot track");
+	} else {
+		failed = 0;
+	}
+
+	FREE(heap, foreign);
+	deinit_basic_linear_allocator(second);
+	deinit_basic_linear_allocator(first);
+	if (!failed) {
+		result->status = TEST_PASS;
+	}
+	return result;
+}
+
+TestResult *combinator_segregator(TestResult *result) {
+	Allocator *heap = get_raw_heap_allocator();
+	BasicLinearAllocator *small;
+	StatsAllocator *large;
+	SegregatorAllocator *segregator;
+	AllocatorStats snapshot;
+	Slice little, big;
+	INIT_RESULT(result, "[combinator_segregator] ");
+
+	small = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 1024).data.data;
+	large = (StatsAllocator *) new_stats_allocator(heap).data.data;
+	segregator = (SegregatorAllocator *) new_segregator_allocator(heap, 64, (Allocator *) small, (Allocator *) large).data.data;
+
+	little = ALLOC((Allocator *) segregator, 64).data;
+	big = ALLOC((Allocator *) segregator, 65).data;
+	if (OWNS((Allocator *) small, little).status != ERROR_OK || OWNS((Allocator *) small, big).status == ERROR_OK) {
+		MSG_PRINT(result, "Sizes were not split at the threshold");
+		FREE((Allocator *) segregator, big);
+		deinit_segregator_allocator(segregator);
+		deinit_stats_allocator(large);
+		deinit_basic_linear_allocator(small);
+		return result;
+	}
+
+	memset(little.data, 7, little.length);
+	little = REALLOC((Allocator *) segregator, little, 200).data;
+	if (little.length != 200 || ((uint8_t *) little.data)[63] != 7) {
+		MSG_PRINT(result, "Growing past the threshold lost data");
+		deinit_segregator_allocator(segregator);
+		deinit_stats_allocator(large);
+		deinit_basic_linear_allocator(small);
+		return result;
+	}
+
+	FREE((Allocator *) segregator, little);
+	FREE((Allocator *) segregator, big);
+	stats_allocator_snapshot(large, &snapshot);
+	if (snapshot.allocs != 2 || snapshot.bytes_live != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Large side saw %u allocations with %u bytes live",
+			(unsigned int) snapshot.allocs, (unsigned int) snapshot.bytes_live
+		);
+		deinit_segregator_allocator(segregator);
+		deinit_stats_allocator(large);
+		deinit_basic_linear_allocator(small);
+		return result;
+	}
+
+	deinit_segregator_allocator(segregator);
+	deinit_stats_allocator(large);
+	deinit_basic_linear_allocator(small);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *combinator_fallback(TestResult *result) {
+	Allocator *heap = get_raw_heap_allocator();
+	BasicLinearAllocator *primary;
+	StatsAllocator *secondary;
+	FallbackAllocator *fallback;
+	AllocatorStats snapshot;
+	Slice first, second;
+	INIT_RESULT(result, "[combinator_fallback] ");
+
+	primary = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 128).data.data;
+	secondary = (StatsAllocator *) new_stats_allocator(heap).data.data;
+	fallback = (FallbackAllocator *) new_fallback_allocator(heap, (Allocator *) primary, (Allocator *) secondary).data.data;
+
+	first = ALLOC((Allocator *) fallback, 100).data;
+	second = ALLOC((Allocator *) fallback, 100).data;
+	if (OWNS((Allocator *) primary, first).status != ERROR_OK || OWNS((Allocator *) primary, second).status == ERROR_OK) {
+		MSG_PRINT(result, "Overflow did not spill to the secondary");
+		FREE((Allocator *) fallback, second);
+		deinit_fallback_allocator(fallback);
+		deinit_stats_allocator(secondary);
+		deinit_basic_linear_allocator(primary);
+		return result;
+	}
+	if (OWNS((Allocator *) fallback, first).status != ERROR_OK) {
+		MSG_PRINT(result, "Fallback disowned memory from its primary");
+		FREE((Allocator *) fallback, second);
+		deinit_fallback_allocator(fallback);
+		deinit_stats_allocator(secondary);
+		deinit_basic_linear_allocator(primary);
+		return result;
+	}
+
+	memset(first.data, 3, first.length);
+	first = REALLOC((Allocator *) fallback, first, 1000).data;
+	if (first.length != 1000 || ((uint8_t *) first.data)[99] != 3) {
+		MSG_PRINT(result, "Moving to the secondary lost data");
+		FREE((Allocator *) fallback, second);
+		deinit_fallback_allocator(fallback);
+		deinit_stats_allocator(secondary);
+		deinit_basic_linear_allocator(primary);
+		return result;
+	}
+
+	FREE((Allocator *) fallback, first);
+	FREE((Allocator *) fallback, second);
+	stats_allocator_snapshot(secondary, &snapshot);
+	if (snapshot.frees != 2 || snapshot.bytes_live != 0) {
+		MSG_PRINT(result, "Frees were not routed to the secondary");
+		deinit_fallback_allocator(fallback);
+		deinit_stats_allocator(secondary);
+		deinit_basic_linear_allocator(primary);
+		return result;
+	}
+
+	deinit_fallback_allocator(fallback);
+	deinit_stats_allocator(secondary);
+	deinit_basic_linear_allocator(primary);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *combinator_bucketizer(TestResult *result) {
+	Allocator *heap = get_raw_heap_allocator();
+	StatsAllocator *stats[4];
+	Allocator *buckets[4];
+	BucketizerAllocator *bucketizer;
+	AllocatorStats snapshot;
+	Slice ptr;
+	int failed = 0;
+	INIT_RESULT(result, "[combinator_bucketizer] ");
+
+	for (unsigned int index = 0; index < 4; index++) {
+		stats[index] = (StatsAllocator *) new_stats_allocator(heap).data.data;
+		buckets[index] = (Allocator *) stats[index];
+	}
+
+	// Buckets for 1-16, 17-32, 33-48 and 49-64 bytes
+	bucketizer = (BucketizerAllocator *) new_bucketizer_allocator(heap, buckets, 4, 1, 16).data.data;
+	for (unsigned int size = 1; size <= 64; size++) {
+		ptr = ALLOC((Allocator *) bucketizer, size).data;
+		FREE((Allocator *) bucketizer, ptr);
+	}
+
+	for (unsigned int index = 0; index < 4 && !failed; index++) {
+		stats_allocator_snapshot(stats[index], &snapshot);
+		if (snapshot.allocs != 16 || snapshot.bytes_live != 0) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Bucket %u served %u allocations",
+				index, (unsigned int) snapshot.allocs
+			);
+			failed = 1;
+		}
+	}
+	if (!failed && ALLOC((Allocator *) bucketizer, 65).status == ERROR_OK) {
+		MSG_PRINT(result, "A size past the last bucket was served");
+		failed = 1;
+	}
+
+	deinit_bucketizer_allocator(bucketizer);
+	for (unsigned int index = 0; index < 4; index++) {
+		deinit_stats_allocator(stats[index]);
+	}
+	if (!failed) {
+		result->status = TEST_PASS;
+	}
+	return result;
+}
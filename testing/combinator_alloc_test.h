@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *allocator_owns(TestResult*);
+TestResult *combinator_segregator(TestResult*);
+TestResult *combinator_fallback(TestResult*);
+TestResult *combinator_bucketizer(TestResult*);
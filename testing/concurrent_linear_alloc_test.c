@@ -0,0 +1,158 @@
+#include "concurrent_linear_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CONCURRENT_TEST_THREADS 8
+#define CONCURRENT_TEST_ITERATIONS 4096
+
+local _Atomic unsigned int concurrent_test_tag;
+
+TestResult *concurrent_linear_alloc_init_deinit(TestResult *result) {
+	Result res;
+	INIT_RESULT(result, "[concurrent_linear_alloc_init_deinit] ");
+
+	res = new_concurrent_linear_allocator(get_raw_heap_allocator(), 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate concurrent linear allocator");
+		return result;
+	}
+
+	res = deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit concurrent linear allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *concurrent_linear_alloc_overflow(TestResult *result) {
+	Allocator *linear;
+	Result res;
+	INIT_RESULT(result, "[concurrent_linear_alloc_overflow] ");
+
+	linear = (Allocator *) new_concurrent_linear_allocator(get_raw_heap_allocator(), 256).data.data;
+
+	ALLOC(linear, 200);
+	res = ALLOC(linear, 64);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Allocated past the end of the buffer");
+		deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+		return result;
+	}
+
+	// The failed request must have been rolled back
+	res = ALLOC(linear, 56);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Failed allocation was not rolled back");
+		deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+		return result;
+	}
+
+	FREE(linear, res.data);
+	res = ALLOC(linear, 56);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Freeing the last allocation did not release it");
+		deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+		return result;
+	}
+
+	deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *concurrent_linear_alloc_epoch(TestResult *result) {
+	ConcurrentLinearAllocator *linear;
+	Slice first;
+	Result res;
+	uint64_t epoch;
+	INIT_RESULT(result, "[concurrent_linear_alloc_epoch] ");
+
+	linear = (ConcurrentLinearAllocator *) new_concurrent_linear_allocator(get_raw_heap_allocator(), 256).data.data;
+
+	first = ALLOC((Allocator *) linear, 64).data;
+	ALLOC((Allocator *) linear, 64);
+	epoch = concurrent_linear_epoch(linear);
+
+	FREEALL((Allocator *) linear);
+	if (concurrent_linear_epoch(linear) != epoch + 1) {
+		MSG_PRINT(result, "FREEALL did not start a new epoch");
+		deinit_concurrent_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC((Allocator *) linear, 64);
+	if (res.status != ERROR_OK || res.data.data != first.data) {
+		MSG_PRINT(result, "FREEALL did not reset the offset");
+		deinit_concurrent_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_concurrent_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+function void *concurrent_linear_worker(void *data) {
+	Allocator *linear = (Allocator *) data;
+	Slice slices[CONCURRENT_TEST_ITERATIONS];
+	uint8_t tag = (uint8_t) atomic_fetch_add(&concurrent_test_tag, 1);
+
+	for (unsigned int index = 0; index < CONCURRENT_TEST_ITERATIONS; index++) {
+		slices[index] = ALLOC(linear, 8 + index % 24).data;
+		if (slices[index].data == 0) {
+			return (void*) 1;
+		}
+		memset(slices[index].data, tag, slices[index].length);
+	}
+
+	for (unsigned int index = 0; index < CONCURRENT_TEST_ITERATIONS; index++) {
+		for (unsigned int byte = 0; byte < slices[index].length; byte++) {
+			if (((uint8_t *) slices[index].data)[byte] != tag) {
+				return (void*) 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+TestResult *concurrent_linear_alloc_threads(TestResult *result) {
+	Allocator *linear;
+	pthread_t threads[CONCURRENT_TEST_THREADS];
+	void *thread_result;
+	unsigned int failures = 0;
+	INIT_RESULT(result, "[concurrent_linear_alloc_threads] ");
+
+	linear = (Allocator *) new_concurrent_linear_allocator(
+		get_raw_heap_allocator(), CONCURRENT_TEST_THREADS * CONCURRENT_TEST_ITERATIONS * 32
+	).data.data;
+	for (unsigned int index = 0; index < CONCURRENT_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, concurrent_linear_worker, linear);
+	}
+	for (unsigned int index = 0; index < CONCURRENT_TEST_THREADS; index++) {
+		pthread_join(threads[index], &thread_result);
+		if (thread_result != 0) {
+			failures++;
+		}
+	}
+
+	if (failures != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%u worker threads saw overlapping allocations",
+			failures
+		);
+		deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+		return result;
+	}
+
+	deinit_concurrent_linear_allocator((ConcurrentLinearAllocator *) linear);
+	result->status = TEST_PASS;
+	return result;
+}
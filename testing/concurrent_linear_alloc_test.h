@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *concurrent_linear_alloc_init_deinit(TestResult*);
+TestResult *concurrent_linear_alloc_overflow(TestResult*);
+TestResult *concurrent_linear_alloc_epoch(TestResult*);
+TestResult *concurrent_linear_alloc_threads(TestResult*);
@@ -0,0 +1,152 @@
+#include "dispatch_test.h"
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+#include <time.h>
+
+// Each test runs the same work through the vtable and through the inline
+// API, checks both agree, and reports the per-op cost of each. Timings are
+// informational only; the tests fail solely on diverging results.
+#define DISPATCH_OPS 1000000
+
+function double dispatch_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+function void dispatch_report(TestResult *result, double vtable, double direct) {
+	sprintf(
+		result->message + strlen(result->message),
+		"vtable %.2f ns/op, inline %.2f ns/op",
+		vtable / DISPATCH_OPS,
+		direct / DISPATCH_OPS
+	);
+}
+
+TestResult *dispatch_arena_alloc(TestResult *result) {
+	ArenaAllocator *arena;
+	uintptr_t vtable_sum = 0, direct_sum = 0;
+	ArenaMark mark;
+	double start, vtable, direct;
+	INIT_RESULT(result, "[dispatch_arena_alloc] ");
+
+	arena = (ArenaAllocator *) new_arena_allocator(get_raw_heap_allocator(), 16 * DISPATCH_OPS, ARENA_RETAIN_ALL).data.data;
+	if (arena == 0) {
+		MSG_PRINT(result, "Unable to instantiate arena allocator");
+		return result;
+	}
+
+	// Both passes start from the same offset, so they hand out the same blocks
+	ALLOC((Allocator *) arena, 8);
+	mark = arena_mark(arena);
+
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		vtable_sum += (uintptr_t) ALLOC((Allocator *) arena, 1 + (index & 15)).data.data;
+	}
+	vtable = dispatch_now() - start;
+
+	arena_rewind(arena, mark);
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		direct_sum += (uintptr_t) arena_alloc_inline(arena, 1 + (index & 15)).data.data;
+	}
+	direct = dispatch_now() - start;
+
+	deinit_arena_allocator(arena);
+	if (vtable_sum != direct_sum) {
+		MSG_PRINT(result, "Inline allocations differ from the vtable ones");
+		return result;
+	}
+
+	dispatch_report(result, vtable, direct);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *dispatch_array_list(TestResult *result) {
+	ArrayList al;
+	uint64_t vtable_sum = 0, direct_sum = 0;
+	double start, vtable, direct;
+	INIT_RESULT(result, "[dispatch_array_list] ");
+
+	if (new_array_list(&al, get_raw_heap_allocator(), sizeof(unsigned int), 16).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to create new ArrayList");
+		return result;
+	}
+	for (unsigned int value = 0; value < 1024; value++) {
+		Slice s = { &value, sizeof(unsigned int) };
+		array_list_push_inline(&al, s);
+	}
+
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		vtable_sum += RESULT_UNWRAP(INDEXING_GET(&al, index & 1023), unsigned int);
+	}
+	vtable = dispatch_now() - start;
+
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		direct_sum += RESULT_UNWRAP(array_list_get_inline(&al, index & 1023), unsigned int);
+	}
+	direct = dispatch_now() - start;
+
+	deinit_array_list(&al);
+	if (vtable_sum != direct_sum) {
+		MSG_PRINT(result, "Inline reads differ from the vtable ones");
+		return result;
+	}
+
+	dispatch_report(result, vtable, direct);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *dispatch_stack(TestResult *result) {
+	StackCollection stack;
+	uint64_t vtable_sum = 0, direct_sum = 0;
+	double start, vtable, direct;
+	INIT_RESULT(result, "[dispatch_stack] ");
+
+	if (new_stack_collection(&stack, get_raw_heap_allocator(), sizeof(unsigned int), 64).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to create new StackCollection");
+		return result;
+	}
+
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		Slice s = { &index, sizeof(unsigned int) };
+		LINEAR_PUSH(&stack, s);
+		if ((index & 63) == 63) {
+			for (unsigned int pop = 0; pop < 64; pop++) {
+				vtable_sum += RESULT_UNWRAP(LINEAR_POP(&stack), unsigned int);
+			}
+		}
+	}
+	vtable = dispatch_now() - start;
+
+	start = dispatch_now();
+	for (unsigned int index = 0; index < DISPATCH_OPS; index++) {
+		Slice s = { &index, sizeof(unsigned int) };
+		stack_push_inline(&stack, s);
+		if ((index & 63) == 63) {
+			for (unsigned int pop = 0; pop < 64; pop++) {
+				direct_sum += RESULT_UNWRAP(stack_pop_inline(&stack), unsigned int);
+			}
+		}
+	}
+	direct = dispatch_now() - start;
+
+	deinit_stack_collection(&stack);
+	if (vtable_sum != direct_sum) {
+		MSG_PRINT(result, "Inline pops differ from the vtable ones");
+		return result;
+	}
+
+	dispatch_report(result, vtable, direct);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *dispatch_arena_alloc(TestResult*);
+TestResult *dispatch_array_list(TestResult*);
+TestResult *dispatch_stack(TestResult*);
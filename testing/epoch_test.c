@@ -0,0 +1,176 @@
+#include "epoch_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define EPOCH_TEST_READERS 4
+#define EPOCH_TEST_SWAPS 20000
+#define EPOCH_TEST_CANARY 0x5eed5eed5eed5eedull
+
+local _Atomic(uint64_t *) epoch_test_shared;
+local _Atomic int epoch_test_done;
+
+TestResult *epoch_init_deinit(TestResult *result) {
+	EpochDomain *domain;
+	Result res;
+	INIT_RESULT(result, "[epoch_init_deinit] ");
+
+	res = new_epoch_domain(get_raw_heap_allocator());
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate epoch domain");
+		return result;
+	}
+	domain = (EpochDomain *) res.data.data;
+
+	res = epoch_register(domain);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to register a record");
+		deinit_epoch_domain(domain);
+		return result;
+	}
+	epoch_unregister((EpochRecord *) res.data.data);
+
+	res = deinit_epoch_domain(domain);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit epoch domain");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *epoch_deferred_free(TestResult *result) {
+	StatsAllocator *stats;
+	EpochDomain *domain;
+	EpochRecord *reader, *writer;
+	AllocatorStats snapshot;
+	Slice retired;
+	INIT_RESULT(result, "[epoch_deferred_free] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+	domain = (EpochDomain *) new_epoch_domain(get_raw_heap_allocator()).data.data;
+	reader = (EpochRecord *) epoch_register(domain).data.data;
+	writer = (EpochRecord *) epoch_register(domain).data.data;
+
+	epoch_enter(reader);
+	retired = ALLOC((Allocator *) stats, 64).data;
+	epoch_retire(writer, retired, (Allocator *) stats);
+
+	for (unsigned int round = 0; round < 4; round++) {
+		epoch_reclaim(writer);
+	}
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.frees != 0) {
+		MSG_PRINT(result, "Memory was freed under an active reader");
+		epoch_exit(reader);
+		deinit_epoch_domain(domain);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	epoch_exit(reader);
+	for (unsigned int round = 0; round < 4; round++) {
+		epoch_reclaim(writer);
+	}
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.frees != 1 || snapshot.bytes_live != 0) {
+		MSG_PRINT(result, "Memory was not freed once the reader left");
+		deinit_epoch_domain(domain);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	deinit_epoch_domain(domain);
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Readers keep dereferencing whatever is published while the writer swaps
+// it out and retires the old value; a premature free shows up as a
+// clobbered canary, or as a use-after-free under a sanitizer.
+function void *epoch_reader(void *data) {
+	EpochDomain *domain = (EpochDomain *) data;
+	EpochRecord *record;
+	uint64_t *value;
+	void *failed = 0;
+
+	record = (EpochRecord *) epoch_register(domain).data.data;
+	while (!atomic_load(&epoch_test_done)) {
+		epoch_enter(record);
+		value = atomic_load(&epoch_test_shared);
+		if (value[0] != EPOCH_TEST_CANARY || value[1] != ~EPOCH_TEST_CANARY) {
+			failed = (void*) 1;
+		}
+		epoch_exit(record);
+	}
+	epoch_unregister(record);
+
+	return failed;
+}
+
+TestResult *epoch_threads(TestResult *result) {
+	EpochDomain *domain;
+	EpochRecord *writer;
+	Allocator *heap;
+	pthread_t threads[EPOCH_TEST_READERS];
+	void *thread_result;
+	uint64_t *value, *old;
+	Slice s;
+	unsigned int failures = 0;
+	INIT_RESULT(result, "[epoch_threads] ");
+
+	heap = get_raw_heap_allocator();
+	domain = (EpochDomain *) new_epoch_domain(heap).data.data;
+	writer = (EpochRecord *) epoch_register(domain).data.data;
+
+	value = (uint64_t *) ALLOC(heap, 2 * sizeof(uint64_t)).data.data;
+	value[0] = EPOCH_TEST_CANARY;
+	value[1] = ~EPOCH_TEST_CANARY;
+	atomic_store(&epoch_test_shared, value);
+	atomic_store(&epoch_test_done, 0);
+
+	for (unsigned int index = 0; index < EPOCH_TEST_READERS; index++) {
+		pthread_create(&threads[index], 0, epoch_reader, domain);
+	}
+
+	for (unsigned int swap = 0; swap < EPOCH_TEST_SWAPS; swap++) {
+		value = (uint64_t *) ALLOC(heap, 2 * sizeof(uint64_t)).data.data;
+		value[0] = EPOCH_TEST_CANARY;
+		value[1] = ~EPOCH_TEST_CANARY;
+		old = atomic_exchange(&epoch_test_shared, value);
+
+		s.data = old;
+		s.length = 2 * sizeof(uint64_t);
+		epoch_retire(writer, s, heap);
+	}
+
+	atomic_store(&epoch_test_done, 1);
+	for (unsigned int index = 0; index < EPOCH_TEST_READERS; index++) {
+		pthread_join(threads[index], &thread_result);
+		if (thread_result != 0) {
+			failures++;
+		}
+	}
+
+	s.data = atomic_load(&epoch_test_shared);
+	s.length = 2 * sizeof(uint64_t);
+	FREE(heap, s);
+	epoch_unregister(writer);
+	deinit_epoch_domain(domain);
+
+	if (failures != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%u readers saw freed memory",
+			failures
+		);
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
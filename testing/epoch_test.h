@@ -0,0 +1,7 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *epoch_init_deinit(TestResult*);
+TestResult *epoch_deferred_free(TestResult*);
+TestResult *epoch_threads(TestResult*);
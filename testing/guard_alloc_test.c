@@ -0,0 +1,383 @@
+#include "guard_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GUARD_TEST_OPS 1000000
+#define GUARD_TEST_THREADS 8
+
+// The fault tests run in a child, whose SIGSEGV handler exits with the
+// fault the allocator blames
+local GuardAllocator *guard_faulting;
+
+function void guard_test_handler(int signal, siginfo_t *info, void *context) {
+	GuardReport report;
+
+	(void) signal;
+	(void) context;
+	if (guard_allocator_describe(guard_faulting, info->si_addr, &report).status != ERROR_OK) {
+		_exit(2);
+	}
+	_exit(10 + report.fault);
+}
+
+// Returns the child's exit code, or -1 if it did not exit normally
+function int guard_test_fault(Slice block, long offset, int free_first) {
+	struct sigaction action;
+	pid_t child;
+	int status;
+
+	// Otherwise the child can write the parent's buffered output again
+	fflush(stdout);
+	child = fork();
+	if (child < 0) {
+		return -1;
+	}
+	if (child == 0) {
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = guard_test_handler;
+		action.sa_flags = SA_SIGINFO;
+		sigaction(SIGSEGV, &action, 0);
+
+		if (free_first) {
+			FREE((Allocator *) guard_faulting, block);
+		}
+		((volatile uint8_t *) block.data)[offset] = 1;
+		_exit(1);
+	}
+
+	if (waitpid(child, &status, 0) != child || !WIFEXITED(status)) {
+		return -1;
+	}
+	return WEXITSTATUS(status);
+}
+
+function double guard_test_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+TestResult *guard_alloc_placement(TestResult *result) {
+	GuardAllocator *guard;
+	Allocator *allocator;
+	Slice blocks[4], extra;
+	GuardReport report;
+	long page_size;
+	INIT_RESULT(result, "[guard_alloc_placement] ");
+
+	if (new_guard_allocator(get_raw_heap_allocator(), 0, 4).status == ERROR_OK) {
+		MSG_PRINT(result, "Accepted a sample rate of zero");
+		return result;
+	}
+
+	guard = (GuardAllocator *) new_guard_allocator(get_raw_heap_allocator(), 1, 4).data.data;
+	if (guard == 0) {
+		MSG_PRINT(result, "Unable to instantiate guard allocator");
+		return result;
+	}
+	allocator = (Allocator *) guard;
+	page_size = sysconf(_SC_PAGESIZE);
+	guard_sample_next();
+
+	// Odd sizes keep byte alignment and so end exactly against the guard
+	blocks[0] = ALLOC(allocator, 13).data;
+	blocks[1] = ALLOC_ALIGNED(allocator, 24, 64).data;
+	blocks[2] = ALLOC_ZEROED(allocator, 100).data;
+	blocks[3] = ALLOC(allocator, page_size + 1).data;
+	if (IS_NULL_SLICE(blocks[0]) || IS_NULL_SLICE(blocks[1]) || IS_NULL_SLICE(blocks[2]) || IS_NULL_SLICE(blocks[3])) {
+		MSG_PRINT(result, "Allocation failed");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	if (((uintptr_t) blocks[0].data + blocks[0].length) % page_size != 0) {
+		MSG_PRINT(result, "Sampled block does not end at the guard page");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	if ((uintptr_t) blocks[1].data % 64 != 0) {
+		MSG_PRINT(result, "Sampled block lost its alignment");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	for (unsigned int index = 0; index < blocks[2].length; index++) {
+		if (((uint8_t *) blocks[2].data)[index] != 0) {
+			MSG_PRINT(result, "Zeroed block is not zero");
+			deinit_guard_allocator(guard);
+			return result;
+		}
+	}
+	if (guard->sampled != 3 || guard_allocator_describe(guard, blocks[3].data, &report).status == ERROR_OK) {
+		MSG_PRINT(result, "Block larger than a page was not forwarded");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	memset(blocks[0].data, 1, blocks[0].length);
+	FREE(allocator, blocks[3]);
+
+	// With three slots live, the fourth sampled block takes the last one
+	// and the next request falls back to the parent
+	blocks[3] = ALLOC(allocator, 8).data;
+	extra = ALLOC(allocator, 8).data;
+	if (guard->sampled != 4 || IS_NULL_SLICE(extra) || guard_allocator_describe(guard, extra.data, &report).status == ERROR_OK) {
+		MSG_PRINT(result, "Full pool did not fall back to the parent");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	FREE(allocator, extra);
+
+	for (unsigned int index = 0; index < 4; index++) {
+		if (FREE(allocator, blocks[index]).status != ERROR_OK) {
+			MSG_PRINT(result, "Unable to free sampled block");
+			deinit_guard_allocator(guard);
+			return result;
+		}
+	}
+
+	if (deinit_guard_allocator(guard).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit guard allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *guard_alloc_faults(TestResult *result) {
+	Slice block;
+	int code;
+	INIT_RESULT(result, "[guard_alloc_faults] ");
+
+	guard_faulting = (GuardAllocator *) new_guard_allocator(get_raw_heap_allocator(), 1, 4).data.data;
+	if (guard_faulting == 0) {
+		MSG_PRINT(result, "Unable to instantiate guard allocator");
+		return result;
+	}
+	guard_sample_next();
+
+	block = ALLOC((Allocator *) guard_faulting, 37).data;
+	if (IS_NULL_SLICE(block)) {
+		MSG_PRINT(result, "Allocation failed");
+		deinit_guard_allocator(guard_faulting);
+		return result;
+	}
+
+	code = guard_test_fault(block, block.length, 0);
+	if (code != 10 + GUARD_FAULT_OVERFLOW) {
+		sprintf(result->message + strlen(result->message), "Overrun by one byte gave %d", code);
+		deinit_guard_allocator(guard_faulting);
+		return result;
+	}
+
+	code = guard_test_fault(block, 0, 1);
+	if (code != 10 + GUARD_FAULT_USE_AFTER_FREE) {
+		sprintf(result->message + strlen(result->message), "Write after free gave %d", code);
+		deinit_guard_allocator(guard_faulting);
+		return result;
+	}
+
+	if (FREE((Allocator *) guard_faulting, block).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free sampled block");
+		deinit_guard_allocator(guard_faulting);
+		return result;
+	}
+
+	deinit_guard_allocator(guard_faulting);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *guard_alloc_quarantine(TestResult *result) {
+	GuardAllocator *guard;
+	Allocator *allocator;
+	Slice first, second, third, reused;
+	GuardReport report;
+	INIT_RESULT(result, "[guard_alloc_quarantine] ");
+
+	guard = (GuardAllocator *) new_guard_allocator(get_raw_heap_allocator(), 1, 3).data.data;
+	if (guard == 0) {
+		MSG_PRINT(result, "Unable to instantiate guard allocator");
+		return result;
+	}
+	allocator = (Allocator *) guard;
+	guard_sample_next();
+
+	first = ALLOC(allocator, 64).data;
+	FREE(allocator, first);
+	if (FREE(allocator, first).status == ERROR_OK) {
+		MSG_PRINT(result, "Double free was accepted");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	if (
+		guard_allocator_describe(guard, first.data, &report).status != ERROR_OK ||
+		report.fault != GUARD_FAULT_USE_AFTER_FREE || report.allocation.data != first.data
+	) {
+		MSG_PRINT(result, "Freed block was not reported as such");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	// The freed slot waits behind the fresh ones, then behind older frees
+	second = ALLOC(allocator, 64).data;
+	third = ALLOC(allocator, 64).data;
+	if (IS_NULL_SLICE(second) || IS_NULL_SLICE(third) || second.data == first.data || third.data == first.data) {
+		MSG_PRINT(result, "Freed slot was reused before the fresh ones");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	FREE(allocator, second);
+	reused = ALLOC(allocator, 64).data;
+	if (reused.data != first.data) {
+		MSG_PRINT(result, "Oldest freed slot was not the one reused");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	if (*(uint64_t *) reused.data != 0) {
+		MSG_PRINT(result, "Reused slot still holds old data");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	if (
+		guard_allocator_describe(guard, (uint8_t *) third.data + third.length, &report).status != ERROR_OK ||
+		report.fault != GUARD_FAULT_OVERFLOW || report.allocation.data != third.data
+	) {
+		MSG_PRINT(result, "Guard page was not blamed on the block below it");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	// In-place resizes stay within the slot
+	if (RESIZE(allocator, third, 32).status != ERROR_OK || RESIZE(allocator, third, 65).status == ERROR_OK) {
+		MSG_PRINT(result, "Sampled block resized past its page");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	// Only the sampled blocks go; the parent, which holds the allocator, is
+	// left alone
+	if (FREEALL(allocator).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to retire the sampled blocks");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	if (OWNS(allocator, reused).status == ERROR_OK || OWNS(allocator, third).status == ERROR_OK) {
+		MSG_PRINT(result, "Freeall did not retire the sampled blocks");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	reused = ALLOC(allocator, 64).data;
+	if (IS_NULL_SLICE(reused) || FREE(allocator, reused).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate after freeall");
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	deinit_guard_allocator(guard);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Timings are informational, as in the dispatch tests
+TestResult *guard_alloc_sampling(TestResult *result) {
+	GuardAllocator *guard;
+	Allocator *heap, *allocator;
+	Slice block;
+	GuardReport report;
+	unsigned int sampled;
+	double start, parent, guarded;
+	INIT_RESULT(result, "[guard_alloc_sampling] ");
+
+	heap = get_raw_heap_allocator();
+	guard = (GuardAllocator *) new_guard_allocator(heap, 100, 16).data.data;
+	if (guard == 0) {
+		MSG_PRINT(result, "Unable to instantiate guard allocator");
+		return result;
+	}
+	allocator = (Allocator *) guard;
+	guard_sample_next();
+
+	sampled = 0;
+	for (unsigned int index = 0; index < 10000; index++) {
+		block = ALLOC(allocator, 1 + (index & 63)).data;
+		if (guard_allocator_describe(guard, block.data, &report).status == ERROR_OK) {
+			sampled++;
+		}
+		FREE(allocator, block);
+	}
+	if (sampled < 50 || sampled > 200 || sampled != guard->sampled) {
+		sprintf(result->message + strlen(result->message), "Sampled %u of 10000 at a rate of 100", sampled);
+		deinit_guard_allocator(guard);
+		return result;
+	}
+	deinit_guard_allocator(guard);
+
+	guard = (GuardAllocator *) new_guard_allocator(heap, 1u << 20, 16).data.data;
+	allocator = (Allocator *) guard;
+
+	start = guard_test_now();
+	for (unsigned int index = 0; index < GUARD_TEST_OPS; index++) {
+		FREE(heap, ALLOC(heap, 1 + (index & 63)).data);
+	}
+	parent = guard_test_now() - start;
+
+	start = guard_test_now();
+	for (unsigned int index = 0; index < GUARD_TEST_OPS; index++) {
+		FREE(allocator, ALLOC(allocator, 1 + (index & 63)).data);
+	}
+	guarded = guard_test_now() - start;
+
+	deinit_guard_allocator(guard);
+	sprintf(
+		result->message + strlen(result->message),
+		"parent %.2f ns/op, guarded %.2f ns/op",
+		parent / GUARD_TEST_OPS,
+		guarded / GUARD_TEST_OPS
+	);
+	result->status = TEST_PASS;
+	return result;
+}
+
+function void *guard_test_first_alloc(void *data) {
+	Allocator *allocator = (Allocator *) data;
+
+	FREE(allocator, ALLOC(allocator, 32).data);
+	return 0;
+}
+
+// Each new thread starts a countdown instead of sampling its first
+// allocation; at this rate a sample is a one in two million chance
+TestResult *guard_alloc_thread_start(TestResult *result) {
+	GuardAllocator *guard;
+	pthread_t threads[GUARD_TEST_THREADS];
+	INIT_RESULT(result, "[guard_alloc_thread_start] ");
+
+	guard = (GuardAllocator *) new_guard_allocator(get_raw_heap_allocator(), 1u << 20, 16).data.data;
+	if (guard == 0) {
+		MSG_PRINT(result, "Unable to instantiate guard allocator");
+		return result;
+	}
+
+	for (unsigned int index = 0; index < GUARD_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, guard_test_first_alloc, guard);
+	}
+	for (unsigned int index = 0; index < GUARD_TEST_THREADS; index++) {
+		pthread_join(threads[index], 0);
+	}
+	if (guard->sampled != 0) {
+		sprintf(result->message + strlen(result->message), "Sampled %zu first allocations", guard->sampled);
+		deinit_guard_allocator(guard);
+		return result;
+	}
+
+	deinit_guard_allocator(guard);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *guard_alloc_placement(TestResult*);
+TestResult *guard_alloc_faults(TestResult*);
+TestResult *guard_alloc_quarantine(TestResult*);
+TestResult *guard_alloc_sampling(TestResult*);
+TestResult *guard_alloc_thread_start(TestResult*);
@@ -203,3 +203,105 @@ TestResult *heap_slice_split(TestResult *result) {
 	return result;
 }
 
+
+TestResult *heap_aligned_allocation(TestResult *result) {
+	INIT_RESULT(result, "[heap_aligned_allocation]");
+
+	Allocator* raw_heap = get_raw_heap_allocator();
+
+	for (unsigned int alignment = 1; alignment <= 4096; alignment <<= 1) {
+		Result alloc_res = ALLOC_ALIGNED(raw_heap, 100, alignment);
+		if (alloc_res.status != ERROR_OK || alloc_res.data.length != 100) {
+			sprintf(result->message + strlen(result->message), " Aligned allocation to %u failed", alignment);
+			return result;
+		}
+		if (((uintptr_t) alloc_res.data.data & (alignment - 1)) != 0) {
+			sprintf(result->message + strlen(result->message), " Allocation is not aligned to %u", alignment);
+			FREE(raw_heap, alloc_res.data);
+			return result;
+		}
+		FREE(raw_heap, alloc_res.data);
+	}
+
+	if (ALLOC_ALIGNED(raw_heap, 100, 24).status == ERROR_OK) {
+		MSG_PRINT(result, " Accepted an alignment that is not a power of two");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *heap_batch_allocation(TestResult *result) {
+	unsigned int sizes[4] = { 8, 100, 3, 4096 };
+	Slice slices[4];
+	INIT_RESULT(result, "[heap_batch_allocation]");
+
+	Allocator* raw_heap = get_raw_heap_allocator();
+
+	Result res = ALLOC_BATCH(raw_heap, sizes, slices, 4);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, " Unable to allocate a batch");
+		return result;
+	}
+	for (unsigned int index = 0; index < 4; index++) {
+		if (slices[index].data == 0 || slices[index].length != sizes[index]) {
+			sprintf(result->message + strlen(result->message), " Batch item %u has the wrong length", index);
+			FREE_BATCH(raw_heap, slices, 4);
+			return result;
+		}
+		memset(slices[index].data, index, slices[index].length);
+	}
+
+	res = FREE_BATCH(raw_heap, slices, 4);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, " Unable to free a batch");
+		return result;
+	}
+
+	sizes[2] = 0;
+	if (ALLOC_BATCH(raw_heap, sizes, slices, 4).status == ERROR_OK) {
+		MSG_PRINT(result, " Accepted a batch with an empty item");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *heap_zeroed_allocation(TestResult *result) {
+	unsigned int sizes[2] = { 24, 1 << 20 };
+	uint8_t *bytes;
+	INIT_RESULT(result, "[heap_zeroed_allocation]");
+
+	Allocator* raw_heap = get_raw_heap_allocator();
+
+	for (unsigned int index = 0; index < 2; index++) {
+		Result res = ALLOC_ZEROED(raw_heap, sizes[index]);
+		if (res.status != ERROR_OK || res.data.length != sizes[index]) {
+			MSG_PRINT(result, " Unable to allocate zeroed memory");
+			return result;
+		}
+
+		bytes = (uint8_t *) res.data.data;
+		for (unsigned int offset = 0; offset < res.data.length; offset++) {
+			if (bytes[offset] != 0) {
+				sprintf(result->message + strlen(result->message), " Byte %u of %u is not zero", offset, sizes[index]);
+				FREE(raw_heap, res.data);
+				return result;
+			}
+		}
+
+		// Dirty the block so a reused one would show up on the next pass
+		memset(res.data.data, 0xff, res.data.length);
+		FREE(raw_heap, res.data);
+	}
+
+	if (ALLOC_ZEROED(raw_heap, 0).status == ERROR_OK) {
+		MSG_PRINT(result, " Accepted an empty allocation");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
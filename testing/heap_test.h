@@ -7,3 +7,6 @@ TestResult *heap_reallocation(TestResult *result);
 TestResult *heap_freeall_should_fail(TestResult *result);
 TestResult *heap_clone(TestResult *result);
 TestResult *heap_slice_split(TestResult *result);
+TestResult *heap_aligned_allocation(TestResult *result);
+TestResult *heap_batch_allocation(TestResult *result);
+TestResult *heap_zeroed_allocation(TestResult *result);
@@ -0,0 +1,120 @@
+#include "huge_page_alloc_test.h"
+#include "../memory.h"
+
+TestResult *huge_page_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[huge_page_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = new_huge_page_allocator(heap);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate huge page allocator");
+		return result;
+	}
+
+	res = deinit_huge_page_allocator((HugePageAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit huge page allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *huge_page_alloc_alignment(TestResult *result) {
+	Allocator *heap;
+	HugePageAllocator *huge;
+	HugePageStats stats;
+	Slice large, small;
+	Result res;
+	INIT_RESULT(result, "[huge_page_alloc_alignment] ");
+
+	heap = get_raw_heap_allocator();
+	huge = (HugePageAllocator *) new_huge_page_allocator(heap).data.data;
+
+	large = ALLOC((Allocator *) huge, 3 * HUGE_PAGE_SIZE + 1).data;
+	small = ALLOC((Allocator *) huge, 64).data;
+	if (large.data == 0 || small.data == 0) {
+		MSG_PRINT(result, "Allocation failed");
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+	if (((uintptr_t) large.data & (HUGE_PAGE_SIZE - 1)) != 0) {
+		MSG_PRINT(result, "Large allocation is not 2 MiB aligned");
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+	memset(large.data, 1, large.length);
+
+	res = huge_page_allocator_stats(huge, &stats);
+	if (
+		res.status != ERROR_OK || stats.regions != 1 ||
+		stats.bytes_mapped != 4 * HUGE_PAGE_SIZE ||
+		stats.bytes_hugetlb + stats.bytes_advised != stats.bytes_mapped ||
+		stats.bytes_thp_backed > stats.bytes_advised
+	) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Unexpected counters: %u regions, %zu bytes mapped",
+			stats.regions,
+			stats.bytes_mapped
+		);
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+
+	FREE((Allocator *) huge, small);
+	FREE((Allocator *) huge, large);
+	huge_page_allocator_stats(huge, &stats);
+	if (stats.regions != 0 || stats.bytes_mapped != 0) {
+		MSG_PRINT(result, "Freed region is still counted");
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+
+	deinit_huge_page_allocator(huge);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *huge_page_alloc_as_parent(TestResult *result) {
+	Allocator *heap;
+	HugePageAllocator *huge;
+	Allocator *linear;
+	Result res;
+	INIT_RESULT(result, "[huge_page_alloc_as_parent] ");
+
+	heap = get_raw_heap_allocator();
+	huge = (HugePageAllocator *) new_huge_page_allocator(heap).data.data;
+
+	res = init_linear_allocator((Allocator *) huge, 2 * HUGE_PAGE_SIZE);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to back a linear allocator with huge pages");
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+	linear = (Allocator *) res.data.data;
+
+	res = ALLOC(linear, HUGE_PAGE_SIZE);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Linear allocation from huge pages failed");
+		deinit_linear_allocator(linear);
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+	memset(res.data.data, 0, res.data.length);
+	FREE(linear, res.data);
+
+	res = deinit_linear_allocator(linear);
+	if (res.status != ERROR_OK || huge->region_count != 0) {
+		MSG_PRINT(result, "Linear allocator did not return its buffer");
+		deinit_huge_page_allocator(huge);
+		return result;
+	}
+
+	deinit_huge_page_allocator(huge);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *huge_page_alloc_init_deinit(TestResult*);
+TestResult *huge_page_alloc_alignment(TestResult*);
+TestResult *huge_page_alloc_as_parent(TestResult*);
@@ -0,0 +1,138 @@
+#include "inline_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+#include "../utilities.h"
+
+TestResult *inline_alloc_small_list(TestResult *result) {
+	uint64_t storage[64];
+	Slice buffer = { storage, sizeof(storage) };
+	InlineAllocator inline_alloc;
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	ArrayList al;
+	INIT_RESULT(result, "[inline_alloc_small_list] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+	if (new_inline_allocator(&inline_alloc, buffer, (Allocator *) stats).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate inline allocator");
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	new_array_list(&al, (Allocator *) &inline_alloc, sizeof(int), 8);
+	for (int value = 0; value < 32; value++) {
+		Slice s = { &value, sizeof(int) };
+		LINEAR_PUSH(&al, s);
+	}
+	deinit_array_list(&al);
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.allocs != 0 || snapshot.reallocs != 0) {
+		MSG_PRINT(result, "A list that fits the buffer touched the parent");
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	deinit_inline_allocator(&inline_alloc);
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *inline_alloc_overflow(TestResult *result) {
+	uint64_t storage[16];
+	Slice buffer = { storage, sizeof(storage) };
+	InlineAllocator inline_alloc;
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	ArrayList al;
+	INIT_RESULT(result, "[inline_alloc_overflow] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+	new_inline_allocator(&inline_alloc, buffer, (Allocator *) stats);
+
+	new_array_list(&al, (Allocator *) &inline_alloc, sizeof(int), 4);
+	for (int value = 0; value < 100; value++) {
+		Slice s = { &value, sizeof(int) };
+		if (LINEAR_PUSH(&al, s).status != ERROR_OK) {
+			MSG_PRINT(result, "Unable to grow past the buffer");
+			deinit_stats_allocator(stats);
+			return result;
+		}
+	}
+	if (RESULT_UNWRAP(INDEXING_GET(&al, 0), int) != 0 || RESULT_UNWRAP(INDEXING_GET(&al, 99), int) != 99) {
+		MSG_PRINT(result, "Values were lost moving to the parent");
+		deinit_array_list(&al);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.bytes_live == 0) {
+		MSG_PRINT(result, "The grown list is not held by the parent");
+		deinit_array_list(&al);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	deinit_array_list(&al);
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.bytes_live != 0) {
+		MSG_PRINT(result, "Freeing did not reach the parent");
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	deinit_inline_allocator(&inline_alloc);
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *inline_alloc_free_routing(TestResult *result) {
+	uint64_t storage[8];
+	Slice buffer = { storage, sizeof(storage) };
+	InlineAllocator inline_alloc;
+	Allocator *allocator;
+	Slice first, second, spilled;
+	INIT_RESULT(result, "[inline_alloc_free_routing] ");
+
+	new_inline_allocator(&inline_alloc, buffer, get_raw_heap_allocator());
+	allocator = (Allocator *) &inline_alloc;
+
+	first = ALLOC(allocator, 16).data;
+	second = ALLOC(allocator, 16).data;
+	spilled = ALLOC(allocator, 64).data;
+	if ((uint8_t *) second.data != (uint8_t *) storage + 16) {
+		MSG_PRINT(result, "Allocations did not come from the buffer");
+		return result;
+	}
+	if ((uint8_t *) spilled.data >= (uint8_t *) storage && (uint8_t *) spilled.data < (uint8_t *) storage + sizeof(storage)) {
+		MSG_PRINT(result, "Allocated past the end of the buffer");
+		return result;
+	}
+
+	// Only the last buffer allocation can be handed back
+	FREE(allocator, first);
+	FREE(allocator, second);
+	if (ALLOC(allocator, 32).data.data != (uint8_t *) storage + 16) {
+		MSG_PRINT(result, "Freeing the last allocation did not release it");
+		FREE(allocator, spilled);
+		return result;
+	}
+
+	if (FREE(allocator, spilled).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free through the parent");
+		return result;
+	}
+
+	FREEALL(allocator);
+	if (ALLOC(allocator, 64).data.data != storage) {
+		MSG_PRINT(result, "FREEALL did not reset the buffer");
+		return result;
+	}
+
+	deinit_inline_allocator(&inline_alloc);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *inline_alloc_small_list(TestResult*);
+TestResult *inline_alloc_overflow(TestResult*);
+TestResult *inline_alloc_free_routing(TestResult*);
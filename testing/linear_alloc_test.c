@@ -216,3 +216,545 @@ TestResult *linear_alloc_freeall(TestResult *result) {
 	result->status = TEST_PASS;
 	return result;
 }
+
+TestResult *linear_alloc_coalesce(TestResult *result) {
+	Allocator *heap;
+	Allocator *linear;
+	Result res;
+	Slice a, b, c;
+	INIT_RESULT(result, "[linear_alloc_coalesce] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (Allocator *) init_linear_allocator(heap, 256).data.data;
+
+	a = ALLOC(linear, 64).data;
+	b = ALLOC(linear, 64).data;
+	c = ALLOC(linear, 128).data;
+	if (IS_NULL_SLICE(a) || IS_NULL_SLICE(b) || IS_NULL_SLICE(c)) {
+		MSG_PRINT(result, "Unable to fill the allocator");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC(linear, 8);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Allocation succeeded on a full allocator");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	if (FREE(linear, a).status != ERROR_OK || FREE(linear, c).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free allocations");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	if (FREE(linear, a).status == ERROR_OK) {
+		MSG_PRINT(result, "Double free was accepted");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	if (FREE(linear, b).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free the middle allocation");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC(linear, 256);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Free blocks were not coalesced");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *linear_alloc_best_fit(TestResult *result) {
+	Allocator *heap;
+	Allocator *linear;
+	Result res;
+	Slice small, large, fences[2];
+	INIT_RESULT(result, "[linear_alloc_best_fit] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (Allocator *) init_linear_allocator(heap, 1024).data.data;
+
+	large = ALLOC(linear, 128).data;
+	fences[0] = ALLOC(linear, 8).data;
+	small = ALLOC(linear, 96).data;
+	fences[1] = ALLOC(linear, 8).data;
+	FREE(linear, large);
+	FREE(linear, small);
+
+	res = ALLOC(linear, 48);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate 48 bytes");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	if (
+		(uint8_t *) res.data.data < (uint8_t *) small.data ||
+		(uint8_t *) res.data.data >= (uint8_t *) small.data + small.length
+	) {
+		MSG_PRINT(result, "Allocation did not use the smallest fitting block");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	FREE(linear, res.data);
+	FREE(linear, fences[0]);
+	FREE(linear, fences[1]);
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_mark_rewind(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	ArenaMark mark;
+	Slice scratch;
+	Result res;
+	INIT_RESULT(result, "[basic_linear_alloc_mark_rewind] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 256).data.data;
+
+	ALLOC((Allocator *)linear, 16);
+	mark = basic_linear_mark(linear);
+	scratch = ALLOC((Allocator *)linear, 64).data;
+	ALLOC((Allocator *)linear, 64);
+
+	res = basic_linear_rewind(linear, mark);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to rewind to mark");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC((Allocator *)linear, 8);
+	if (res.status != ERROR_OK || res.data.data != scratch.data) {
+		MSG_PRINT(result, "Rewind did not release scratch allocations");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_resize(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	Slice first, last;
+	Result res;
+	INIT_RESULT(result, "[basic_linear_alloc_resize] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 256).data.data;
+
+	first = ALLOC((Allocator *)linear, 16).data;
+	memset(first.data, 0x5a, first.length);
+	last = ALLOC((Allocator *)linear, 16).data;
+
+	res = RESIZE((Allocator *)linear, last, 64);
+	if (res.status != ERROR_OK || res.data.data != last.data || res.data.length != 64) {
+		MSG_PRINT(result, "Unable to grow the last allocation in place");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+	last = res.data;
+
+	res = RESIZE((Allocator *)linear, first, 32);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Grew an allocation over its neighbour");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	res = REALLOC((Allocator *)linear, first, 32);
+	if (res.status != ERROR_OK || res.data.length != 32 || ((uint8_t *) res.data.data)[15] != 0x5a) {
+		MSG_PRINT(result, "Reallocation did not copy the allocation");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	res = REALLOC((Allocator *)linear, res.data, 8);
+	if (res.status != ERROR_OK || res.data.length != 8) {
+		MSG_PRINT(result, "Unable to shrink an allocation");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *linear_alloc_resize(TestResult *result) {
+	Allocator *heap;
+	Allocator *linear;
+	FragmentationStats stats;
+	Slice block, neighbour, fence;
+	Result res;
+	INIT_RESULT(result, "[linear_alloc_resize] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (Allocator *) init_linear_allocator(heap, 1024).data.data;
+
+	// Allocations are carved from the tail, so later ones sit lower
+	fence = ALLOC(linear, 64).data;
+	neighbour = ALLOC(linear, 128).data;
+	block = ALLOC(linear, 64).data;
+	FREE(linear, neighbour);
+
+	res = RESIZE(linear, block, 192);
+	if (res.status != ERROR_OK || res.data.data != block.data) {
+		MSG_PRINT(result, "Unable to grow into the adjacent free block");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	block = res.data;
+
+	res = RESIZE(linear, block, 256);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Grew over a live allocation");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	res = RESIZE(linear, block, 40);
+	if (res.status != ERROR_OK || res.data.data != block.data) {
+		MSG_PRINT(result, "Unable to shrink in place");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	block = res.data;
+
+	FREE(linear, block);
+	FREE(linear, fence);
+	linear_allocator_stats(linear, &stats);
+	if (stats.free_blocks != 1 || stats.bytes_reserved != 0 || stats.bytes_requested != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Resizing left %u free blocks and %u reserved bytes",
+			stats.free_blocks,
+			stats.bytes_reserved
+		);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_aligned(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	Result res;
+	INIT_RESULT(result, "[basic_linear_alloc_aligned] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 1024).data.data;
+
+	ALLOC((Allocator *)linear, 3);
+	res = ALLOC_ALIGNED((Allocator *)linear, 32, 64);
+	if (res.status != ERROR_OK || ((uintptr_t) res.data.data & 63) != 0) {
+		MSG_PRINT(result, "Allocation is not aligned to 64");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC_ALIGNED((Allocator *)linear, 1024, 64);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Padding was not accounted for");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_batch(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	unsigned int sizes[3] = { 24, 7, 100 };
+	Slice slices[3];
+	Result res;
+	INIT_RESULT(result, "[basic_linear_alloc_batch] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 256).data.data;
+
+	res = ALLOC_BATCH((Allocator *)linear, sizes, slices, 3);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate a batch");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+	if (
+		(uint8_t *) slices[1].data != (uint8_t *) slices[0].data + 24 ||
+		(uint8_t *) slices[2].data != (uint8_t *) slices[1].data + 7
+	) {
+		MSG_PRINT(result, "Batch was not carved from one bump");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	// 131 bytes are taken, so a second batch of the same sizes cannot fit
+	res = ALLOC_BATCH((Allocator *)linear, sizes, slices, 3);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Batch was allocated past the end of the buffer");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+	if (ALLOC((Allocator *)linear, 125).status != ERROR_OK) {
+		MSG_PRINT(result, "Failed batch consumed part of the buffer");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	// Freed right after allocation, a batch is reclaimed whole
+	FREEALL((Allocator *)linear);
+	ALLOC_BATCH((Allocator *)linear, sizes, slices, 3);
+	if (FREE_BATCH((Allocator *)linear, slices, 3).status != ERROR_OK || linear->current.data != slices[0].data) {
+		MSG_PRINT(result, "Freed batch was not reclaimed");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	// A block that is not the last one stays where it is
+	slices[0] = ALLOC((Allocator *)linear, 16).data;
+	slices[1] = ALLOC((Allocator *)linear, 16).data;
+	FREE((Allocator *)linear, slices[0]);
+	if (linear->current.data != (uint8_t *) slices[1].data + 16) {
+		MSG_PRINT(result, "Freeing an earlier block moved the bump");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+	FREE((Allocator *)linear, slices[1]);
+	if (linear->current.data != slices[1].data) {
+		MSG_PRINT(result, "Freeing the last block did not reclaim it");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *linear_alloc_aligned(TestResult *result) {
+	Allocator *heap;
+	Allocator *linear;
+	FragmentationStats stats;
+	Slice blocks[32];
+	unsigned int alignment;
+	INIT_RESULT(result, "[linear_alloc_aligned] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (Allocator *) init_linear_allocator(heap, 16384).data.data;
+
+	for (unsigned int index = 0; index < 32; index++) {
+		alignment = 8u << (index % 6);
+		blocks[index] = ALLOC_ALIGNED(linear, 24 + index * 8, alignment).data;
+		if (blocks[index].data == 0 || ((uintptr_t) blocks[index].data & (alignment - 1)) != 0) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Allocation %u is not aligned to %u",
+				index,
+				alignment
+			);
+			deinit_linear_allocator(linear);
+			return result;
+		}
+		memset(blocks[index].data, index, blocks[index].length);
+	}
+
+	// The padding around aligned blocks must stay reusable
+	for (unsigned int index = 0; index < 32; index += 2) {
+		FREE(linear, blocks[index]);
+	}
+	for (unsigned int index = 1; index < 32; index += 2) {
+		if (((uint8_t *) blocks[index].data)[0] != index) {
+			MSG_PRINT(result, "Allocations overlap");
+			deinit_linear_allocator(linear);
+			return result;
+		}
+		FREE(linear, blocks[index]);
+	}
+
+	linear_allocator_stats(linear, &stats);
+	if (stats.free_blocks != 1 || stats.bytes_reserved != 0) {
+		MSG_PRINT(result, "Padding was lost after freeing everything");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_trim(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	TrimPolicy policy = { TRIM_ON_RESET, TRIM_DONTNEED, 64 * 1024, 0 };
+	uint8_t *bytes;
+	Result res;
+	INIT_RESULT(result, "[basic_linear_alloc_trim] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 1024 * 1024).data.data;
+	basic_linear_set_trim_policy(linear, policy);
+
+	bytes = (uint8_t *) ALLOC((Allocator *) linear, 1024 * 1024).data.data;
+	memset(bytes, 0xff, 1024 * 1024);
+	FREEALL((Allocator *) linear);
+
+	// Released pages of a private mapping read back as zeroes
+	if (bytes[0] != 0xff || bytes[1024 * 1024 - 4096 * 2] != 0) {
+		MSG_PRINT(result, "Reset did not release the pages past the retained bytes");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	// An explicit trim keeps what is in use
+	res = ALLOC((Allocator *) linear, 1024 * 1024);
+	memset(res.data.data, 0xff, res.data.length);
+	bytes = (uint8_t *) RESIZE((Allocator *) linear, res.data, 256 * 1024).data.data;
+	if (basic_linear_trim(linear).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to trim");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+	if (bytes[256 * 1024 - 1] != 0xff || bytes[1024 * 1024 - 4096 * 2] != 0) {
+		MSG_PRINT(result, "Trim released live memory or kept the unused tail");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *basic_linear_alloc_trim_idle(TestResult *result) {
+	Allocator *heap;
+	BasicLinearAllocator *linear;
+	TrimPolicy policy = { TRIM_WHEN_IDLE, TRIM_DONTNEED, 64 * 1024, 2 };
+	uint8_t *bytes, *tail;
+	INIT_RESULT(result, "[basic_linear_alloc_trim_idle] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(heap, 1024 * 1024).data.data;
+	basic_linear_set_trim_policy(linear, policy);
+
+	bytes = (uint8_t *) ALLOC((Allocator *) linear, 1024 * 1024).data.data;
+	memset(bytes, 0xff, 1024 * 1024);
+	tail = bytes + 1024 * 1024 - 4096 * 2;
+
+	// The spike itself and the first quiet reset keep the pages
+	FREEALL((Allocator *) linear);
+	ALLOC((Allocator *) linear, 1024);
+	FREEALL((Allocator *) linear);
+	if (*tail != 0xff) {
+		MSG_PRINT(result, "Trimmed before the arena went idle");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	ALLOC((Allocator *) linear, 1024);
+	FREEALL((Allocator *) linear);
+	if (*tail != 0) {
+		MSG_PRINT(result, "Did not trim after two idle resets");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *trim_policy_idle_once(TestResult *result) {
+	TrimPolicy policy = { TRIM_WHEN_IDLE, TRIM_DONTNEED, 4096, 0 };
+	unsigned int idle = 0;
+	INIT_RESULT(result, "[trim_policy_idle_once] ");
+
+	// A limit of zero trims on the first quiet reset, and only that one
+	if (trim_policy_due(&policy, &idle, 1024 * 1024) || !trim_policy_due(&policy, &idle, 0)) {
+		MSG_PRINT(result, "Did not trim on the first idle reset");
+		return result;
+	}
+	for (int index = 0; index < 4; index++) {
+		if (trim_policy_due(&policy, &idle, 0)) {
+			MSG_PRINT(result, "Trimmed the same spike again");
+			return result;
+		}
+	}
+
+	// A new spike is trimmed again once things are quiet
+	if (trim_policy_due(&policy, &idle, 1024 * 1024) || !trim_policy_due(&policy, &idle, 1024)) {
+		MSG_PRINT(result, "Did not trim after a new spike");
+		return result;
+	}
+
+	policy.idle_resets = 2;
+	idle = 0;
+	if (trim_policy_due(&policy, &idle, 0) || !trim_policy_due(&policy, &idle, 0) || trim_policy_due(&policy, &idle, 0)) {
+		MSG_PRINT(result, "Did not trim exactly on the second idle reset");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *linear_alloc_trim(TestResult *result) {
+	Allocator *heap;
+	Allocator *linear;
+	Slice kept, freed;
+	uint8_t *bytes;
+	INIT_RESULT(result, "[linear_alloc_trim] ");
+
+	heap = get_raw_heap_allocator();
+	linear = (Allocator *) init_linear_allocator(heap, 1024 * 1024).data.data;
+
+	kept = ALLOC(linear, 128 * 1024).data;
+	freed = ALLOC(linear, 512 * 1024).data;
+	memset(kept.data, 0xff, kept.length);
+	memset(freed.data, 0xff, freed.length);
+	bytes = (uint8_t *) freed.data;
+	FREE(linear, freed);
+
+	if (linear_allocator_trim(linear).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to trim");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	if (((uint8_t *) kept.data)[kept.length - 1] != 0xff || bytes[freed.length / 2] != 0) {
+		MSG_PRINT(result, "Trim released live memory or kept a free block");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	// Still a working allocator afterwards
+	freed = ALLOC(linear, 512 * 1024).data;
+	if (IS_NULL_SLICE(freed) || FREE(linear, freed).status != ERROR_OK) {
+		MSG_PRINT(result, "Trimming corrupted the free blocks");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -6,7 +6,19 @@ TestResult *basic_linear_alloc_init_deinit(TestResult*);
 TestResult *basic_linear_alloc_alloc_free(TestResult*);
 TestResult *basic_linear_alloc_freeall(TestResult*);
 TestResult *basic_linear_alloc_clone(TestResult*);
+TestResult *basic_linear_alloc_mark_rewind(TestResult*);
+TestResult *basic_linear_alloc_resize(TestResult*);
+TestResult *basic_linear_alloc_aligned(TestResult*);
+TestResult *basic_linear_alloc_batch(TestResult*);
+TestResult *basic_linear_alloc_trim(TestResult*);
+TestResult *basic_linear_alloc_trim_idle(TestResult*);
+TestResult *trim_policy_idle_once(TestResult*);
 
 TestResult *linear_alloc_init_deinit(TestResult*);
 TestResult *linear_alloc_alloc_free(TestResult*);
 TestResult *linear_alloc_freeall(TestResult*);
+TestResult *linear_alloc_coalesce(TestResult*);
+TestResult *linear_alloc_best_fit(TestResult*);
+TestResult *linear_alloc_resize(TestResult*);
+TestResult *linear_alloc_aligned(TestResult*);
+TestResult *linear_alloc_trim(TestResult*);
@@ -0,0 +1,259 @@
+#include "magazine_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+#include <time.h>
+
+#define MAGAZINE_TEST_THREADS 4
+#define MAGAZINE_TEST_ITERATIONS 10000
+#define MAGAZINE_BENCH_OPS 250000
+
+TestResult *magazine_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[magazine_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = new_magazine_allocator(heap);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate magazine allocator");
+		return result;
+	}
+
+	res = deinit_magazine_allocator((MagazineAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit magazine allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *magazine_alloc_alloc_free(TestResult *result) {
+	Allocator *linear, *magazine;
+	Result res;
+	Slice a;
+	INIT_RESULT(result, "[magazine_alloc_alloc_free] ");
+
+	linear = (Allocator *) init_linear_allocator(get_raw_heap_allocator(), 65536).data.data;
+	magazine = (Allocator *) new_magazine_allocator(linear).data.data;
+
+	res = ALLOC(magazine, 48);
+	if (res.status != ERROR_OK || res.data.length != 48) {
+		MSG_PRINT(result, "Unable to allocate 48 bytes");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	a = res.data;
+	memset(a.data, 1, a.length);
+
+	res = FREE(magazine, a);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free 48 bytes");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	res = ALLOC(magazine, 42);
+	if (res.status != ERROR_OK || res.data.data != a.data) {
+		MSG_PRINT(result, "Cached round was not reused");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	FREE(magazine, res.data);
+
+	res = ALLOC(magazine, 4096);
+	if (res.status != ERROR_OK || res.data.length != 4096) {
+		MSG_PRINT(result, "Unable to allocate above the largest class");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	FREE(magazine, res.data);
+
+	deinit_magazine_allocator((MagazineAllocator *) magazine);
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+function void *magazine_worker(void *data) {
+	Allocator *magazine = (Allocator *) data;
+	Slice held[16];
+	Result res;
+
+	for (unsigned int iteration = 0; iteration < MAGAZINE_TEST_ITERATIONS; iteration++) {
+		unsigned int slot = iteration % 16;
+		if (iteration >= 16) {
+			if (*(unsigned int *)held[slot].data != iteration - 16) {
+				return data;
+			}
+			FREE(magazine, held[slot]);
+		}
+		res = ALLOC(magazine, 8 + (iteration % 200));
+		if (res.status != ERROR_OK) {
+			return data;
+		}
+		*(unsigned int *)res.data.data = iteration;
+		held[slot] = res.data;
+	}
+
+	for (unsigned int slot = 0; slot < 16; slot++) {
+		FREE(magazine, held[slot]);
+	}
+	return 0;
+}
+
+TestResult *magazine_alloc_threads(TestResult *result) {
+	Allocator *magazine;
+	pthread_t threads[MAGAZINE_TEST_THREADS];
+	void *thread_result;
+	unsigned int failures = 0;
+	INIT_RESULT(result, "[magazine_alloc_threads] ");
+
+	magazine = (Allocator *) new_magazine_allocator(get_raw_heap_allocator()).data.data;
+	for (unsigned int index = 0; index < MAGAZINE_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, magazine_worker, magazine);
+	}
+	for (unsigned int index = 0; index < MAGAZINE_TEST_THREADS; index++) {
+		pthread_join(threads[index], &thread_result);
+		if (thread_result != 0) {
+			failures++;
+		}
+	}
+
+	if (failures != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%u worker threads saw corrupted allocations",
+			failures
+		);
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		return result;
+	}
+
+	deinit_magazine_allocator((MagazineAllocator *) magazine);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Drains the caches but leaves the parent, which also holds the allocator
+TestResult *magazine_alloc_freeall(TestResult *result) {
+	Allocator *linear, *magazine;
+	Slice a, b;
+	INIT_RESULT(result, "[magazine_alloc_freeall] ");
+
+	linear = (Allocator *) init_linear_allocator(get_raw_heap_allocator(), 65536).data.data;
+	magazine = (Allocator *) new_magazine_allocator(linear).data.data;
+
+	a = ALLOC(magazine, 48).data;
+	b = ALLOC(magazine, 48).data;
+	FREE(magazine, b);
+	if (FREEALL(magazine).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to drain the caches");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	if (((MagazineAllocator *) magazine)->inside_methods != linear) {
+		MSG_PRINT(result, "Freeall reset the parent holding the allocator");
+		deinit_linear_allocator(linear);
+		return result;
+	}
+
+	// The live block survives, and new ones come from fresh rounds
+	memset(a.data, 1, a.length);
+	b = ALLOC(magazine, 48).data;
+	if (IS_NULL_SLICE(b) || b.data == a.data || OWNS(linear, b).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate after freeall");
+		deinit_magazine_allocator((MagazineAllocator *) magazine);
+		deinit_linear_allocator(linear);
+		return result;
+	}
+	FREE(magazine, a);
+	FREE(magazine, b);
+
+	deinit_magazine_allocator((MagazineAllocator *) magazine);
+	deinit_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
+
+function void *magazine_bench_worker(void *data) {
+	Allocator *allocator = (Allocator *) data;
+	Slice held[16] = {0};
+
+	for (unsigned int iteration = 0; iteration < MAGAZINE_BENCH_OPS; iteration++) {
+		unsigned int slot = iteration % 16;
+		if (held[slot].data != 0) {
+			FREE(allocator, held[slot]);
+		}
+		held[slot] = ALLOC(allocator, 8 + (iteration % 200)).data;
+		if (held[slot].data == 0) {
+			return data;
+		}
+	}
+
+	for (unsigned int slot = 0; slot < 16; slot++) {
+		FREE(allocator, held[slot]);
+	}
+	return 0;
+}
+
+// Returns the wall time per alloc/free pair across all threads, or a
+// negative value if a worker failed
+function double magazine_bench(Allocator *allocator) {
+	pthread_t threads[MAGAZINE_TEST_THREADS];
+	struct timespec start, end;
+	void *thread_result;
+	int failed = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int index = 0; index < MAGAZINE_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, magazine_bench_worker, allocator);
+	}
+	for (unsigned int index = 0; index < MAGAZINE_TEST_THREADS; index++) {
+		pthread_join(threads[index], &thread_result);
+		failed |= thread_result != 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (failed) {
+		return -1;
+	}
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+		((double) MAGAZINE_TEST_THREADS * MAGAZINE_BENCH_OPS);
+}
+
+// The same threaded workload against the parent alone and through the
+// magazines in front of it. Timings are informational, as in the dispatch
+// tests: they depend on the core count of the machine running them.
+TestResult *magazine_alloc_contended(TestResult *result) {
+	Allocator *heap, *magazine;
+	double parent, magazines;
+	INIT_RESULT(result, "[magazine_alloc_contended] ");
+
+	heap = get_raw_heap_allocator();
+	magazine = (Allocator *) new_magazine_allocator(heap).data.data;
+
+	parent = magazine_bench(heap);
+	magazines = magazine_bench(magazine);
+	deinit_magazine_allocator((MagazineAllocator *) magazine);
+	if (parent < 0 || magazines < 0) {
+		MSG_PRINT(result, "A worker thread failed to allocate");
+		return result;
+	}
+
+	sprintf(
+		result->message + strlen(result->message),
+		"%u threads: parent %.2f ns/op, magazine %.2f ns/op",
+		MAGAZINE_TEST_THREADS, parent, magazines
+	);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *magazine_alloc_init_deinit(TestResult*);
+TestResult *magazine_alloc_alloc_free(TestResult*);
+TestResult *magazine_alloc_threads(TestResult*);
+TestResult *magazine_alloc_freeall(TestResult*);
+TestResult *magazine_alloc_contended(TestResult*);
@@ -0,0 +1,165 @@
+#include "numa_alloc_test.h"
+#include "../memory.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// From <linux/mempolicy.h>: report the node backing an address
+#define NUMA_TEST_F_NODE_ADDR 3
+
+TestResult *numa_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[numa_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = new_numa_allocator(heap, -1);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate NUMA allocator");
+		return result;
+	}
+	if (((NumaAllocator *) res.data.data)->node != numa_current_node()) {
+		MSG_PRINT(result, "Allocator is not on the calling thread's node");
+		deinit_numa_allocator((NumaAllocator *) res.data.data);
+		return result;
+	}
+
+	res = deinit_numa_allocator((NumaAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit NUMA allocator");
+		return result;
+	}
+
+	if (new_numa_allocator(heap, numa_node_count()).status == ERROR_OK) {
+		MSG_PRINT(result, "Accepted a node that does not exist");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *numa_alloc_binding(TestResult *result) {
+	NumaAllocator *numa;
+	Slice page;
+	int node;
+	INIT_RESULT(result, "[numa_alloc_binding] ");
+
+	numa = (NumaAllocator *) new_numa_allocator(get_raw_heap_allocator(), 0).data.data;
+
+	// Take the mbind() path even on a single-node machine
+	numa->bind = 1;
+	page = ALLOC((Allocator *) numa, 3 * 4096).data;
+	if (IS_NULL_SLICE(page)) {
+		MSG_PRINT(result, "Allocation failed");
+		deinit_numa_allocator(numa);
+		return result;
+	}
+	memset(page.data, 1, page.length);
+
+	// Kernels or sandboxes without NUMA support turn binding off instead
+	node = -1;
+	if (
+		numa->bind &&
+		syscall(SYS_get_mempolicy, &node, 0, 0, page.data, NUMA_TEST_F_NODE_ADDR) == 0 &&
+		node != 0
+	) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Memory landed on node %d instead of node 0",
+			node
+		);
+		deinit_numa_allocator(numa);
+		return result;
+	}
+
+	if (FREE((Allocator *) numa, page).status != ERROR_OK || numa->bytes_mapped != 0) {
+		MSG_PRINT(result, "Unable to unmap the allocation");
+		deinit_numa_allocator(numa);
+		return result;
+	}
+
+	deinit_numa_allocator(numa);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *numa_alloc_as_parent(TestResult *result) {
+	NumaAllocator *numa;
+	BasicLinearAllocator *basic;
+	Allocator *linear;
+	Slice a, b;
+	INIT_RESULT(result, "[numa_alloc_as_parent] ");
+
+	numa = (NumaAllocator *) new_numa_allocator(get_raw_heap_allocator(), -1).data.data;
+	basic = (BasicLinearAllocator *) new_basic_linear_allocator((Allocator *) numa, 1 << 20).data.data;
+	linear = (Allocator *) init_linear_allocator((Allocator *) numa, 1 << 20).data.data;
+	if (basic == 0 || linear == 0) {
+		MSG_PRINT(result, "Unable to build linear allocators on NUMA memory");
+		deinit_numa_allocator(numa);
+		return result;
+	}
+
+	a = ALLOC((Allocator *) basic, 1000).data;
+	b = ALLOC(linear, 1000).data;
+	memset(a.data, 1, a.length);
+	memset(b.data, 2, b.length);
+	if (OWNS((Allocator *) numa, a).status != ERROR_OK || OWNS((Allocator *) numa, b).status != ERROR_OK) {
+		MSG_PRINT(result, "Allocations are not backed by the NUMA allocator");
+		deinit_linear_allocator(linear);
+		deinit_basic_linear_allocator(basic);
+		deinit_numa_allocator(numa);
+		return result;
+	}
+
+	deinit_linear_allocator(linear);
+	deinit_basic_linear_allocator(basic);
+	if (numa->bytes_mapped != 0) {
+		MSG_PRINT(result, "Deinit left NUMA memory mapped");
+		deinit_numa_allocator(numa);
+		return result;
+	}
+
+	deinit_numa_allocator(numa);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *numa_alloc_registry(TestResult *result) {
+	Allocator *local;
+	BasicLinearAllocator *basic;
+	INIT_RESULT(result, "[numa_alloc_registry] ");
+
+	if (numa_node_count() < 1) {
+		MSG_PRINT(result, "No NUMA nodes found");
+		return result;
+	}
+
+	local = numa_local_allocator();
+	if (local == 0 || local != numa_node_allocator(numa_current_node())) {
+		MSG_PRINT(result, "The local allocator is not the registered one");
+		release_numa_allocators();
+		return result;
+	}
+	if (numa_node_allocator(-1) != 0 || numa_node_allocator(numa_node_count()) != 0) {
+		MSG_PRINT(result, "Registry handed out an allocator for a missing node");
+		release_numa_allocators();
+		return result;
+	}
+
+	basic = (BasicLinearAllocator *) new_basic_linear_allocator(local, 4096).data.data;
+	if (basic == 0 || IS_NULL_SLICE(ALLOC((Allocator *) basic, 64).data)) {
+		MSG_PRINT(result, "Registered allocator cannot back an arena");
+		release_numa_allocators();
+		return result;
+	}
+	deinit_basic_linear_allocator(basic);
+
+	if (release_numa_allocators().status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to release the registry");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *numa_alloc_init_deinit(TestResult*);
+TestResult *numa_alloc_binding(TestResult*);
+TestResult *numa_alloc_as_parent(TestResult*);
+TestResult *numa_alloc_registry(TestResult*);
@@ -0,0 +1,289 @@
+#include "pool_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define POOL_TEST_THREADS 8
+#define POOL_TEST_ITERATIONS 20000
+#define POOL_TEST_HELD 16
+#define POOL_BENCH_THREADS 4
+#define POOL_BENCH_OPS 250000
+
+local _Atomic unsigned int pool_test_tag;
+
+TestResult *pool_alloc_init_deinit(TestResult *result) {
+	Result res;
+	INIT_RESULT(result, "[pool_alloc_init_deinit] ");
+
+	res = new_pool_allocator(get_raw_heap_allocator(), sizeof(Slice), 64);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate pool allocator");
+		return result;
+	}
+
+	res = deinit_pool_allocator((PoolAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit pool allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *pool_alloc_reuse(TestResult *result) {
+	Allocator *pool;
+	Slice first, large;
+	Result res;
+	INIT_RESULT(result, "[pool_alloc_reuse] ");
+
+	pool = (Allocator *) new_pool_allocator(get_raw_heap_allocator(), 24, 16).data.data;
+
+	first = ALLOC(pool, 24).data;
+	res = FREE(pool, first);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free a pool object");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+
+	res = ALLOC(pool, 16);
+	if (res.status != ERROR_OK || res.data.data != first.data) {
+		MSG_PRINT(result, "Freed object was not reused");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+	FREE(pool, res.data);
+
+	// Objects larger than the pool size come from the parent
+	large = ALLOC(pool, 4096).data;
+	if (large.data == 0) {
+		MSG_PRINT(result, "Unable to allocate past the object size");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+	FREE(pool, large);
+
+	res.data.data = (void*) &large;
+	res.data.length = 24;
+	res = FREE(pool, res.data);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Freed an object the pool does not own");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+
+	deinit_pool_allocator((PoolAllocator *) pool);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *pool_alloc_refill(TestResult *result) {
+	Allocator *pool;
+	Slice slices[100];
+	INIT_RESULT(result, "[pool_alloc_refill] ");
+
+	pool = (Allocator *) new_pool_allocator(get_raw_heap_allocator(), sizeof(Slice), 8).data.data;
+
+	for (unsigned int index = 0; index < 100; index++) {
+		slices[index] = ALLOC(pool, sizeof(Slice)).data;
+		if (slices[index].data == 0) {
+			MSG_PRINT(result, "Pool did not refill from the parent");
+			deinit_pool_allocator((PoolAllocator *) pool);
+			return result;
+		}
+		memset(slices[index].data, index, slices[index].length);
+	}
+
+	for (unsigned int index = 0; index < 100; index++) {
+		for (unsigned int byte = 0; byte < slices[index].length; byte++) {
+			if (((uint8_t *) slices[index].data)[byte] != (uint8_t) index) {
+				MSG_PRINT(result, "Pool objects overlap");
+				deinit_pool_allocator((PoolAllocator *) pool);
+				return result;
+			}
+		}
+	}
+
+	for (unsigned int index = 0; index < 100; index++) {
+		if (FREE(pool, slices[index]).status != ERROR_OK) {
+			MSG_PRINT(result, "Unable to free an object from a later batch");
+			deinit_pool_allocator((PoolAllocator *) pool);
+			return result;
+		}
+	}
+
+	// Objects cached by this thread go with the chunks they came from
+	if (FREEALL(pool).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to release the chunks");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+	slices[0] = ALLOC(pool, sizeof(Slice)).data;
+	if (slices[0].data == 0 || OWNS(pool, slices[0]).status != ERROR_OK || FREE(pool, slices[0]).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate after freeall");
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+
+	deinit_pool_allocator((PoolAllocator *) pool);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Each thread keeps a few objects tagged while churning the rest, so a
+// double hand-out shows up as a clobbered tag. A losing pop may still read
+// the first word of an object just handed out, hence the atomic tag.
+function void *pool_worker(void *data) {
+	Allocator *pool = (Allocator *) data;
+	Slice held[POOL_TEST_HELD];
+	uint64_t tag = atomic_fetch_add(&pool_test_tag, 1) + 1;
+
+	for (unsigned int index = 0; index < POOL_TEST_HELD; index++) {
+		SET_NULL_SLICE(held[index]);
+	}
+
+	for (unsigned int iteration = 0; iteration < POOL_TEST_ITERATIONS; iteration++) {
+		Slice *slot = &held[iteration % POOL_TEST_HELD];
+
+		if (slot->data != 0) {
+			if (atomic_load_explicit((_Atomic uint64_t *) slot->data, memory_order_relaxed) !=
+				(tag << 32 | iteration % POOL_TEST_HELD)) {
+				return (void*) 1;
+			}
+			if (FREE(pool, *slot).status != ERROR_OK) {
+				return (void*) 1;
+			}
+		}
+
+		*slot = ALLOC(pool, sizeof(uint64_t)).data;
+		if (slot->data == 0) {
+			return (void*) 1;
+		}
+		atomic_store_explicit(
+			(_Atomic uint64_t *) slot->data, tag << 32 | iteration % POOL_TEST_HELD, memory_order_relaxed
+		);
+	}
+
+	for (unsigned int index = 0; index < POOL_TEST_HELD; index++) {
+		FREE(pool, held[index]);
+	}
+
+	return 0;
+}
+
+TestResult *pool_alloc_threads(TestResult *result) {
+	Allocator *pool;
+	pthread_t threads[POOL_TEST_THREADS];
+	void *thread_result;
+	unsigned int failures = 0;
+	INIT_RESULT(result, "[pool_alloc_threads] ");
+
+	pool = (Allocator *) new_pool_allocator(get_raw_heap_allocator(), sizeof(uint64_t), 32).data.data;
+	for (unsigned int index = 0; index < POOL_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, pool_worker, pool);
+	}
+	for (unsigned int index = 0; index < POOL_TEST_THREADS; index++) {
+		pthread_join(threads[index], &thread_result);
+		if (thread_result != 0) {
+			failures++;
+		}
+	}
+
+	if (failures != 0) {
+		sprintf(
+			result->message + strlen(result->message),
+			"%u worker threads were handed a live object",
+			failures
+		);
+		deinit_pool_allocator((PoolAllocator *) pool);
+		return result;
+	}
+
+	deinit_pool_allocator((PoolAllocator *) pool);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Holds a window of Slice-sized objects, as standard_slice_split() would,
+// freeing the oldest each time it takes a new one
+function void *pool_bench_worker(void *data) {
+	Allocator *allocator = (Allocator *) data;
+	Slice held[POOL_TEST_HELD] = {0};
+
+	for (unsigned int iteration = 0; iteration < POOL_BENCH_OPS; iteration++) {
+		unsigned int slot = iteration % POOL_TEST_HELD;
+		if (held[slot].data != 0) {
+			FREE(allocator, held[slot]);
+		}
+		held[slot] = ALLOC(allocator, sizeof(Slice)).data;
+		if (held[slot].data == 0) {
+			return data;
+		}
+	}
+
+	for (unsigned int slot = 0; slot < POOL_TEST_HELD; slot++) {
+		FREE(allocator, held[slot]);
+	}
+	return 0;
+}
+
+// Returns the wall time per alloc/free pair across all threads, or a
+// negative value if a worker failed
+function double pool_bench(Allocator *allocator) {
+	pthread_t threads[POOL_BENCH_THREADS];
+	struct timespec start, end;
+	void *thread_result;
+	int failed = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int index = 0; index < POOL_BENCH_THREADS; index++) {
+		pthread_create(&threads[index], 0, pool_bench_worker, allocator);
+	}
+	for (unsigned int index = 0; index < POOL_BENCH_THREADS; index++) {
+		pthread_join(threads[index], &thread_result);
+		failed |= thread_result != 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (failed) {
+		return -1;
+	}
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+		((double) POOL_BENCH_THREADS * POOL_BENCH_OPS);
+}
+
+// The same threaded workload against malloc, through the raw heap, and
+// against the pool. Timings are informational, as in the dispatch tests:
+// they depend on the core count of the machine running them.
+TestResult *pool_alloc_contended(TestResult *result) {
+	Allocator *heap, *pool;
+	double parent, pooled;
+	INIT_RESULT(result, "[pool_alloc_contended] ");
+
+	heap = get_raw_heap_allocator();
+	pool = (Allocator *) new_pool_allocator(heap, sizeof(Slice), 256).data.data;
+	if (pool == 0) {
+		MSG_PRINT(result, "Unable to instantiate pool allocator");
+		return result;
+	}
+
+	parent = pool_bench(heap);
+	pooled = pool_bench(pool);
+	deinit_pool_allocator((PoolAllocator *) pool);
+	if (parent < 0 || pooled < 0) {
+		MSG_PRINT(result, "A worker thread failed to allocate");
+		return result;
+	}
+
+	sprintf(
+		result->message + strlen(result->message),
+		"%u threads: malloc %.2f ns/op, pool %.2f ns/op",
+		POOL_BENCH_THREADS, parent, pooled
+	);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *pool_alloc_init_deinit(TestResult*);
+TestResult *pool_alloc_reuse(TestResult*);
+TestResult *pool_alloc_refill(TestResult*);
+TestResult *pool_alloc_threads(TestResult*);
+TestResult *pool_alloc_contended(TestResult*);
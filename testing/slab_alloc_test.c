@@ -0,0 +1,155 @@
+#include "slab_alloc_test.h"
+#include "../memory.h"
+
+TestResult *slab_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[slab_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = new_slab_allocator(heap, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate slab allocator");
+		return result;
+	}
+
+	res = deinit_slab_allocator((SlabAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit slab allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *slab_alloc_size_classes(TestResult *result) {
+	unsigned int index, length;
+	INIT_RESULT(result, "[slab_alloc_size_classes] ");
+
+	for (unsigned int size = 1; size <= SIZE_CLASS_MAX; size++) {
+		index = size_class_index(size);
+		length = size_class_length(index);
+		if (index >= SIZE_CLASS_COUNT || length < size) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Size %u mapped to class %u of length %u",
+				size, index, length
+			);
+			return result;
+		}
+		if (index > 0 && size_class_length(index - 1) >= size) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Size %u does not use the smallest class",
+				size
+			);
+			return result;
+		}
+	}
+
+	if (size_class_length(SIZE_CLASS_COUNT - 1) != SIZE_CLASS_MAX) {
+		MSG_PRINT(result, "Largest class does not match SIZE_CLASS_MAX");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *slab_alloc_alloc_free(TestResult *result) {
+	Allocator *heap, *slab;
+	Result res;
+	Slice a, b, large;
+	INIT_RESULT(result, "[slab_alloc_alloc_free] ");
+
+	heap = get_raw_heap_allocator();
+	slab = (Allocator *) new_slab_allocator(heap, 4096).data.data;
+
+	res = ALLOC(slab, 24);
+	if (res.status != ERROR_OK || res.data.length != 24) {
+		MSG_PRINT(result, "Unable to allocate 24 bytes");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+	a = res.data;
+
+	res = ALLOC(slab, 20);
+	if (res.status != ERROR_OK || res.data.data != (void*)((uint8_t *)a.data + 24)) {
+		MSG_PRINT(result, "Same class allocations are not adjacent");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+	b = res.data;
+
+	res = FREE(slab, a);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free allocation");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+
+	res = ALLOC(slab, 17);
+	if (res.status != ERROR_OK || res.data.data != a.data) {
+		MSG_PRINT(result, "Freed object was not reused by its class");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+	FREE(slab, res.data);
+	FREE(slab, b);
+
+	res = ALLOC(slab, 1024);
+	if (res.status != ERROR_OK || res.data.length != 1024) {
+		MSG_PRINT(result, "Unable to allocate above the largest class");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+	large = res.data;
+
+	res = FREE(slab, large);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free above the largest class");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+
+	deinit_slab_allocator((SlabAllocator *) slab);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *slab_alloc_realloc(TestResult *result) {
+	Allocator *heap, *slab;
+	Result res;
+	Slice a;
+	INIT_RESULT(result, "[slab_alloc_realloc] ");
+
+	heap = get_raw_heap_allocator();
+	slab = (Allocator *) new_slab_allocator(heap, 4096).data.data;
+
+	a = ALLOC(slab, 40).data;
+	memset(a.data, 7, a.length);
+
+	res = REALLOC(slab, a, 34);
+	if (res.status != ERROR_OK || res.data.data != a.data || res.data.length != 34) {
+		MSG_PRINT(result, "Realloc within a class moved the object");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+
+	res = REALLOC(slab, res.data, 200);
+	if (res.status != ERROR_OK || res.data.length != 200) {
+		MSG_PRINT(result, "Unable to realloc into a larger class");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+	if (((uint8_t *)res.data.data)[33] != 7) {
+		MSG_PRINT(result, "Realloc did not preserve contents");
+		deinit_slab_allocator((SlabAllocator *) slab);
+		return result;
+	}
+
+	deinit_slab_allocator((SlabAllocator *) slab);
+	result->status = TEST_PASS;
+	return result;
+}
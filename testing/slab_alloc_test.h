@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *slab_alloc_init_deinit(TestResult*);
+TestResult *slab_alloc_size_classes(TestResult*);
+TestResult *slab_alloc_alloc_free(TestResult*);
+TestResult *slab_alloc_realloc(TestResult*);
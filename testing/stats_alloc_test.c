@@ -0,0 +1,196 @@
+#include "stats_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+#include <pthread.h>
+
+#define STATS_TEST_THREADS 4
+#define STATS_TEST_ITERATIONS 10000
+
+TestResult *stats_alloc_init_deinit(TestResult *result) {
+	Result res;
+	INIT_RESULT(result, "[stats_alloc_init_deinit] ");
+
+	res = new_stats_allocator(get_raw_heap_allocator());
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate stats allocator");
+		return result;
+	}
+
+	res = deinit_stats_allocator((StatsAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit stats allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *stats_alloc_counters(TestResult *result) {
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	Slice a, b;
+	INIT_RESULT(result, "[stats_alloc_counters] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+
+	a = ALLOC((Allocator *) stats, 100).data;
+	b = ALLOC((Allocator *) stats, 1000).data;
+	FREE((Allocator *) stats, b);
+	a = REALLOC((Allocator *) stats, a, 300).data;
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.allocs != 2 || snapshot.reallocs != 1 || snapshot.frees != 1) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Counted %lu allocs, %lu reallocs, %lu frees",
+			(unsigned long) snapshot.allocs,
+			(unsigned long) snapshot.reallocs,
+			(unsigned long) snapshot.frees
+		);
+		FREE((Allocator *) stats, a);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+	if (snapshot.bytes_live != 300 || snapshot.bytes_peak != 1100) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Counted %lu live and %lu peak bytes",
+			(unsigned long) snapshot.bytes_live,
+			(unsigned long) snapshot.bytes_peak
+		);
+		FREE((Allocator *) stats, a);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+	if (snapshot.histogram[6] != 1 || snapshot.histogram[8] != 1 || snapshot.histogram[9] != 1) {
+		MSG_PRINT(result, "Sizes landed in the wrong histogram buckets");
+		FREE((Allocator *) stats, a);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	FREE((Allocator *) stats, a);
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *stats_alloc_reset(TestResult *result) {
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	Slice a, b;
+	INIT_RESULT(result, "[stats_alloc_reset] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+
+	a = ALLOC((Allocator *) stats, 64).data;
+	b = ALLOC((Allocator *) stats, 512).data;
+	FREE((Allocator *) stats, b);
+	stats_allocator_reset(stats);
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.allocs != 0 || snapshot.frees != 0 || snapshot.histogram[6] != 0) {
+		MSG_PRINT(result, "Reset did not clear the counters");
+		FREE((Allocator *) stats, a);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+	if (snapshot.bytes_live != 64 || snapshot.bytes_peak != 64) {
+		MSG_PRINT(result, "Reset lost track of live bytes");
+		FREE((Allocator *) stats, a);
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	FREE((Allocator *) stats, a);
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+function void *stats_worker(void *data) {
+	Allocator *stats = (Allocator *) data;
+	Slice slice;
+
+	for (unsigned int index = 0; index < STATS_TEST_ITERATIONS; index++) {
+		slice = ALLOC(stats, 16 + index % 64).data;
+		FREE(stats, slice);
+	}
+
+	return 0;
+}
+
+TestResult *stats_alloc_threads(TestResult *result) {
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	pthread_t threads[STATS_TEST_THREADS];
+	INIT_RESULT(result, "[stats_alloc_threads] ");
+
+	stats = (StatsAllocator *) new_stats_allocator(get_raw_heap_allocator()).data.data;
+	for (unsigned int index = 0; index < STATS_TEST_THREADS; index++) {
+		pthread_create(&threads[index], 0, stats_worker, stats);
+	}
+	for (unsigned int index = 0; index < STATS_TEST_THREADS; index++) {
+		pthread_join(threads[index], 0);
+	}
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (
+		snapshot.allocs != STATS_TEST_THREADS * STATS_TEST_ITERATIONS ||
+		snapshot.frees != snapshot.allocs || snapshot.bytes_live != 0
+	) {
+		MSG_PRINT(result, "Concurrent updates were lost");
+		deinit_stats_allocator(stats);
+		return result;
+	}
+
+	deinit_stats_allocator(stats);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// The wrapper lives in the bump allocator it wraps, so a reset must not
+// reach the parent
+TestResult *stats_alloc_freeall(TestResult *result) {
+	BasicLinearAllocator *linear;
+	StatsAllocator *stats;
+	AllocatorStats snapshot;
+	Slice a, b;
+	INIT_RESULT(result, "[stats_alloc_freeall] ");
+
+	linear = (BasicLinearAllocator *) new_basic_linear_allocator(get_raw_heap_allocator(), 4096).data.data;
+	stats = (StatsAllocator *) new_stats_allocator((Allocator *) linear).data.data;
+	if (stats == 0) {
+		MSG_PRINT(result, "Unable to instantiate stats allocator");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	a = ALLOC((Allocator *) stats, 128).data;
+	if (FREEALL((Allocator *) stats).status != ERROR_OK) {
+		MSG_PRINT(result, "Freeall failed with nothing to release");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	b = ALLOC((Allocator *) stats, 128).data;
+	if (IS_NULL_SLICE(b) || b.data == a.data || stats->inside_methods != (Allocator *) linear) {
+		MSG_PRINT(result, "Allocation after freeall overwrote the wrapper");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	stats_allocator_snapshot(stats, &snapshot);
+	if (snapshot.allocs != 2 || snapshot.bytes_live != 256 || snapshot.failures != 0) {
+		MSG_PRINT(result, "Freeall changed the counters");
+		deinit_basic_linear_allocator(linear);
+		return result;
+	}
+
+	deinit_stats_allocator(stats);
+	deinit_basic_linear_allocator(linear);
+	result->status = TEST_PASS;
+	return result;
+}
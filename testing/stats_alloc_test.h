@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *stats_alloc_init_deinit(TestResult*);
+TestResult *stats_alloc_counters(TestResult*);
+TestResult *stats_alloc_reset(TestResult*);
+TestResult *stats_alloc_threads(TestResult*);
+TestResult *stats_alloc_freeall(TestResult*);
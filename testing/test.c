@@ -5,6 +5,24 @@
 #include "queue_test.h"
 #include "slice_test.h"
 #include "stack_test.h"
+#include "slab_alloc_test.h"
+#include "magazine_alloc_test.h"
+#include "tlsf_alloc_test.h"
+#include "buddy_alloc_test.h"
+#include "arena_alloc_test.h"
+#include "vm_arena_alloc_test.h"
+#include "huge_page_alloc_test.h"
+#include "stats_alloc_test.h"
+#include "trace_alloc_test.h"
+#include "concurrent_linear_alloc_test.h"
+#include "pool_alloc_test.h"
+#include "dispatch_test.h"
+#include "epoch_test.h"
+#include "inline_alloc_test.h"
+#include "combinator_alloc_test.h"
+#include "numa_alloc_test.h"
+#include "guard_alloc_test.h"
+#include "budget_alloc_test.h"
 
 TestResult *always_passes(TestResult* result) {
 	INIT_RESULT(result, "[always_passes]");
@@ -12,7 +30,7 @@ TestResult *always_passes(TestResult* result) {
 	return result;
 }
 
-#define TEST_COUNT 29
+#define TEST_COUNT 127
 Test tests[TEST_COUNT] = {
 	always_passes,
 	slice_compare,
@@ -36,13 +54,111 @@ Test tests[TEST_COUNT] = {
 	array_list_swap,
 	array_list_replace,
 	heap_slice_split,
+	heap_aligned_allocation,
+	array_list_aligned,
 	basic_linear_alloc_init_deinit,
 	basic_linear_alloc_alloc_free,
 	basic_linear_alloc_freeall,
 	basic_linear_alloc_clone,
+	basic_linear_alloc_mark_rewind,
+	basic_linear_alloc_resize,
+	basic_linear_alloc_aligned,
 	linear_alloc_init_deinit,
 	linear_alloc_alloc_free,
 	linear_alloc_freeall,
+	linear_alloc_coalesce,
+	linear_alloc_best_fit,
+	linear_alloc_resize,
+	linear_alloc_aligned,
+	slab_alloc_init_deinit,
+	slab_alloc_size_classes,
+	slab_alloc_alloc_free,
+	slab_alloc_realloc,
+	magazine_alloc_init_deinit,
+	magazine_alloc_alloc_free,
+	magazine_alloc_threads,
+	magazine_alloc_freeall,
+	magazine_alloc_contended,
+	tlsf_alloc_init_deinit,
+	tlsf_alloc_alloc_free,
+	tlsf_alloc_coalesce,
+	tlsf_alloc_resize,
+	buddy_alloc_init_deinit,
+	buddy_alloc_split_merge,
+	buddy_alloc_realloc_in_place,
+	buddy_alloc_stats,
+	buddy_alloc_aligned,
+	arena_alloc_init_deinit,
+	arena_alloc_growth,
+	arena_alloc_free_last,
+	arena_alloc_retention,
+	arena_alloc_mark_rewind,
+	arena_alloc_scratch,
+	arena_alloc_zeroed,
+	arena_alloc_trim,
+	vm_arena_alloc_init_deinit,
+	vm_arena_alloc_commit,
+	vm_arena_alloc_decommit,
+	vm_arena_alloc_zeroed,
+	vm_arena_alloc_trim,
+	huge_page_alloc_init_deinit,
+	huge_page_alloc_alignment,
+	huge_page_alloc_as_parent,
+	stats_alloc_init_deinit,
+	stats_alloc_counters,
+	stats_alloc_reset,
+	stats_alloc_threads,
+	stats_alloc_freeall,
+	trace_alloc_init_deinit,
+	trace_alloc_sites,
+	trace_alloc_invalid_free,
+	trace_alloc_table_growth,
+	trace_alloc_freeall,
+	trace_alloc_batch_sites,
+	concurrent_linear_alloc_init_deinit,
+	concurrent_linear_alloc_overflow,
+	concurrent_linear_alloc_epoch,
+	concurrent_linear_alloc_threads,
+	pool_alloc_init_deinit,
+	pool_alloc_reuse,
+	pool_alloc_refill,
+	pool_alloc_threads,
+	pool_alloc_contended,
+	heap_batch_allocation,
+	heap_zeroed_allocation,
+	basic_linear_alloc_batch,
+	basic_linear_alloc_trim,
+	basic_linear_alloc_trim_idle,
+	trim_policy_idle_once,
+	linear_alloc_trim,
+	array_list_deinit_items,
+	array_list_shrink_capacity,
+	dispatch_arena_alloc,
+	dispatch_array_list,
+	dispatch_stack,
+	epoch_init_deinit,
+	epoch_deferred_free,
+	epoch_threads,
+	inline_alloc_small_list,
+	inline_alloc_overflow,
+	inline_alloc_free_routing,
+	allocator_owns,
+	combinator_segregator,
+	combinator_fallback,
+	combinator_bucketizer,
+	numa_alloc_init_deinit,
+	numa_alloc_binding,
+	numa_alloc_as_parent,
+	numa_alloc_registry,
+	guard_alloc_placement,
+	guard_alloc_faults,
+	guard_alloc_quarantine,
+	guard_alloc_sampling,
+	guard_alloc_thread_start,
+	budget_alloc_limits,
+	budget_alloc_relief,
+	budget_alloc_threads,
+	budget_alloc_freeall,
 };
 
 int main() {
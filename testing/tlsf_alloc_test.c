@@ -0,0 +1,174 @@
+#include "tlsf_alloc_test.h"
+#include "../memory.h"
+
+TestResult *tlsf_alloc_init_deinit(TestResult *result) {
+	Allocator *heap;
+	Result res;
+	INIT_RESULT(result, "[tlsf_alloc_init_deinit] ");
+
+	heap = get_raw_heap_allocator();
+	res = init_tlsf_allocator(heap, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate TLSF allocator");
+		return result;
+	}
+
+	res = deinit_tlsf_allocator((Allocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit TLSF allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *tlsf_alloc_alloc_free(TestResult *result) {
+	Allocator *heap, *tlsf;
+	Result res;
+	Slice a, b;
+	INIT_RESULT(result, "[tlsf_alloc_alloc_free] ");
+
+	heap = get_raw_heap_allocator();
+	tlsf = (Allocator *) init_tlsf_allocator(heap, 4096).data.data;
+
+	res = ALLOC(tlsf, 100);
+	if (res.status != ERROR_OK || res.data.length != 100) {
+		MSG_PRINT(result, "Unable to allocate 100 bytes");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	a = res.data;
+	memset(a.data, 1, a.length);
+
+	res = ALLOC(tlsf, 1000);
+	if (res.status != ERROR_OK || res.data.length != 1000) {
+		MSG_PRINT(result, "Unable to allocate 1000 bytes");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	b = res.data;
+	memset(b.data, 2, b.length);
+
+	if (((uint8_t *) a.data)[99] != 1) {
+		MSG_PRINT(result, "Allocations overlap");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+
+	if (FREE(tlsf, a).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free allocation");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	if (FREE(tlsf, a).status == ERROR_OK) {
+		MSG_PRINT(result, "Double free was accepted");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	FREE(tlsf, b);
+
+	deinit_tlsf_allocator(tlsf);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *tlsf_alloc_coalesce(TestResult *result) {
+	Allocator *heap, *tlsf;
+	Slice parts[8];
+	Result res;
+	INIT_RESULT(result, "[tlsf_alloc_coalesce] ");
+
+	heap = get_raw_heap_allocator();
+	tlsf = (Allocator *) init_tlsf_allocator(heap, 4096).data.data;
+
+	res = ALLOC(tlsf, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate the whole buffer");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	FREE(tlsf, res.data);
+
+	for (unsigned int index = 0; index < 8; index++) {
+		parts[index] = ALLOC(tlsf, 256).data;
+		if (IS_NULL_SLICE(parts[index])) {
+			MSG_PRINT(result, "Unable to allocate parts");
+			deinit_tlsf_allocator(tlsf);
+			return result;
+		}
+	}
+
+	// Free odd parts first so the even ones merge with both neighbours
+	for (unsigned int index = 1; index < 8; index += 2) {
+		FREE(tlsf, parts[index]);
+	}
+	for (unsigned int index = 0; index < 8; index += 2) {
+		FREE(tlsf, parts[index]);
+	}
+
+	res = ALLOC(tlsf, 4096);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Free blocks were not coalesced");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+
+	deinit_tlsf_allocator(tlsf);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *tlsf_alloc_resize(TestResult *result) {
+	Allocator *heap;
+	Allocator *tlsf;
+	Slice a, b, c;
+	Result res;
+	INIT_RESULT(result, "[tlsf_alloc_resize] ");
+
+	heap = get_raw_heap_allocator();
+	tlsf = (Allocator *) init_tlsf_allocator(heap, 4096).data.data;
+
+	a = ALLOC(tlsf, 64).data;
+	b = ALLOC(tlsf, 256).data;
+	c = ALLOC(tlsf, 64).data;
+	FREE(tlsf, b);
+
+	res = RESIZE(tlsf, a, 320);
+	if (res.status != ERROR_OK || res.data.data != a.data) {
+		MSG_PRINT(result, "Unable to grow into the next free block");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	a = res.data;
+
+	res = RESIZE(tlsf, a, 1024);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Grew over a live block");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+
+	res = RESIZE(tlsf, a, 32);
+	if (res.status != ERROR_OK || res.data.data != a.data) {
+		MSG_PRINT(result, "Unable to shrink in place");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+	a = res.data;
+
+	// The released tail must be reusable
+	b = ALLOC(tlsf, 256).data;
+	if ((uint8_t *) b.data < (uint8_t *) a.data || (uint8_t *) b.data > (uint8_t *) c.data) {
+		MSG_PRINT(result, "Shrunk tail was not given back");
+		deinit_tlsf_allocator(tlsf);
+		return result;
+	}
+
+	FREE(tlsf, a);
+	FREE(tlsf, b);
+	FREE(tlsf, c);
+	deinit_tlsf_allocator(tlsf);
+	result->status = TEST_PASS;
+	return result;
+}
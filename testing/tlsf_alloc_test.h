@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *tlsf_alloc_init_deinit(TestResult*);
+TestResult *tlsf_alloc_alloc_free(TestResult*);
+TestResult *tlsf_alloc_coalesce(TestResult*);
+TestResult *tlsf_alloc_resize(TestResult*);
@@ -0,0 +1,244 @@
+#include "trace_alloc_test.h"
+#include "../globals.h"
+#include "../memory.h"
+
+TestResult *trace_alloc_init_deinit(TestResult *result) {
+	Result res;
+	INIT_RESULT(result, "[trace_alloc_init_deinit] ");
+
+	res = new_trace_allocator(get_raw_heap_allocator());
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate trace allocator");
+		return result;
+	}
+
+	res = deinit_trace_allocator((TraceAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit trace allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Separate functions so that the allocations have distinct call sites
+__attribute__((noinline)) function Slice trace_small_site(Allocator *allocator) {
+	return ALLOC(allocator, 16).data;
+}
+
+__attribute__((noinline)) function Slice trace_large_site(Allocator *allocator) {
+	return ALLOC(allocator, 1000).data;
+}
+
+TestResult *trace_alloc_sites(TestResult *result) {
+	Allocator *trace;
+	TraceSite sites[4];
+	Slice small[3], large[2];
+	Result res;
+	INIT_RESULT(result, "[trace_alloc_sites] ");
+
+	trace = (Allocator *) new_trace_allocator(get_raw_heap_allocator()).data.data;
+	for (unsigned int index = 0; index < 3; index++) {
+		small[index] = trace_small_site(trace);
+	}
+	for (unsigned int index = 0; index < 2; index++) {
+		large[index] = trace_large_site(trace);
+	}
+	FREE(trace, small[0]);
+
+	res = trace_allocator_report((TraceAllocator *) trace, sites, 4);
+	if (res.status != ERROR_OK || res.data.length != 2 * sizeof(TraceSite)) {
+		MSG_PRINT(result, "Allocations were not grouped into two sites");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+	if (
+		sites[0].allocations != 2 || sites[0].bytes != 2000 ||
+		sites[1].allocations != 2 || sites[1].bytes != 32 ||
+		sites[0].site == sites[1].site
+	) {
+		MSG_PRINT(result, "Sites were not counted or ordered by bytes");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	FREE(trace, small[1]);
+	FREE(trace, small[2]);
+	FREE(trace, large[0]);
+	FREE(trace, large[1]);
+	res = trace_allocator_report((TraceAllocator *) trace, sites, 4);
+	if (res.status != ERROR_OK || res.data.length != 0) {
+		MSG_PRINT(result, "Freed allocations are still reported");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	deinit_trace_allocator((TraceAllocator *) trace);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *trace_alloc_invalid_free(TestResult *result) {
+	TraceAllocator *trace;
+	Slice slice, foreign;
+	INIT_RESULT(result, "[trace_alloc_invalid_free] ");
+
+	trace = (TraceAllocator *) new_trace_allocator(get_raw_heap_allocator()).data.data;
+	slice = ALLOC((Allocator *) trace, 32).data;
+	FREE((Allocator *) trace, slice);
+
+	if (FREE((Allocator *) trace, slice).status == ERROR_OK) {
+		MSG_PRINT(result, "Double free was forwarded");
+		deinit_trace_allocator(trace);
+		return result;
+	}
+
+	foreign = ALLOC(get_raw_heap_allocator(), 32).data;
+	if (FREE((Allocator *) trace, foreign).status == ERROR_OK) {
+		MSG_PRINT(result, "Free of untracked memory was forwarded");
+		FREE(get_raw_heap_allocator(), foreign);
+		deinit_trace_allocator(trace);
+		return result;
+	}
+	FREE(get_raw_heap_allocator(), foreign);
+
+	if (trace->invalid_frees != 2) {
+		MSG_PRINT(result, "Invalid frees were not counted");
+		deinit_trace_allocator(trace);
+		return result;
+	}
+
+	deinit_trace_allocator(trace);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *trace_alloc_table_growth(TestResult *result) {
+	TraceAllocator *trace;
+	Slice slices[2000];
+	INIT_RESULT(result, "[trace_alloc_table_growth] ");
+
+	trace = (TraceAllocator *) new_trace_allocator(get_raw_heap_allocator()).data.data;
+	for (unsigned int index = 0; index < 2000; index++) {
+		slices[index] = ALLOC((Allocator *) trace, 8 + index % 32).data;
+	}
+
+	// Removing every third entry exercises the backward shift
+	for (unsigned int index = 0; index < 2000; index += 3) {
+		if (FREE((Allocator *) trace, slices[index]).status != ERROR_OK) {
+			MSG_PRINT(result, "Tracked allocation was not found");
+			deinit_trace_allocator(trace);
+			return result;
+		}
+	}
+	for (unsigned int index = 0; index < 2000; index++) {
+		if (index % 3 != 0 && FREE((Allocator *) trace, slices[index]).status != ERROR_OK) {
+			MSG_PRINT(result, "Entry was lost after removals");
+			deinit_trace_allocator(trace);
+			return result;
+		}
+	}
+
+	if (trace->count != 0 || trace->invalid_frees != 0) {
+		MSG_PRINT(result, "Table does not match the allocations");
+		deinit_trace_allocator(trace);
+		return result;
+	}
+
+	deinit_trace_allocator(trace);
+	result->status = TEST_PASS;
+	return result;
+}
+
+// Frees what the tracer holds but leaves its parent, which holds the tracer
+TestResult *trace_alloc_freeall(TestResult *result) {
+	Allocator *trace;
+	TraceSite sites[4];
+	Slice block;
+	Result res;
+	INIT_RESULT(result, "[trace_alloc_freeall] ");
+
+	trace = (Allocator *) new_trace_allocator(get_raw_heap_allocator()).data.data;
+	for (unsigned int index = 0; index < 300; index++) {
+		ALLOC(trace, 16 + index);
+	}
+
+	if (FREEALL(trace).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to free the tracked blocks");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+	res = trace_allocator_report((TraceAllocator *) trace, sites, 4);
+	if (res.status != ERROR_OK || res.data.length != 0 || ((TraceAllocator *) trace)->count != 0) {
+		MSG_PRINT(result, "Blocks are still tracked after freeall");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	block = ALLOC(trace, 64).data;
+	if (IS_NULL_SLICE(block) || FREE(trace, block).status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to allocate after freeall");
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	deinit_trace_allocator((TraceAllocator *) trace);
+	result->status = TEST_PASS;
+	return result;
+}
+
+__attribute__((noinline)) function void trace_batch_site(Allocator *allocator, Slice *out) {
+	unsigned int sizes[2] = { 24, 40 };
+
+	ALLOC_BATCH(allocator, sizes, out, 2);
+}
+
+__attribute__((noinline)) function void trace_other_batch_site(Allocator *allocator, Slice *out) {
+	unsigned int sizes[2] = { 8, 8 };
+
+	ALLOC_BATCH(allocator, sizes, out, 2);
+}
+
+__attribute__((noinline)) function Slice trace_clone_site(Allocator *allocator, Slice ptr) {
+	return CLONE(allocator, ptr).data;
+}
+
+// Batches and clones are blamed on their callers, not on a shared helper
+TestResult *trace_alloc_batch_sites(TestResult *result) {
+	Allocator *trace;
+	TraceSite sites[4];
+	Slice first[2], second[2], copy;
+	char text[] = "traced";
+	Result res;
+	INIT_RESULT(result, "[trace_alloc_batch_sites] ");
+
+	trace = (Allocator *) new_trace_allocator(get_raw_heap_allocator()).data.data;
+	trace_batch_site(trace, first);
+	trace_other_batch_site(trace, second);
+	copy = trace_clone_site(trace, (Slice){ text, sizeof(text) });
+	if (IS_NULL_SLICE(first[1]) || IS_NULL_SLICE(second[1]) || IS_NULL_SLICE(copy) || memcmp(copy.data, text, sizeof(text)) != 0) {
+		MSG_PRINT(result, "Batch or clone failed");
+		FREEALL(trace);
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	res = trace_allocator_report((TraceAllocator *) trace, sites, 4);
+	if (
+		res.status != ERROR_OK || res.data.length != 3 * sizeof(TraceSite) ||
+		sites[0].allocations != 2 || sites[0].bytes != 64 ||
+		sites[1].allocations != 2 || sites[1].bytes != 16 ||
+		sites[2].allocations != 1 || sites[2].bytes != sizeof(text)
+	) {
+		MSG_PRINT(result, "Batch and clone call sites were not told apart");
+		FREEALL(trace);
+		deinit_trace_allocator((TraceAllocator *) trace);
+		return result;
+	}
+
+	FREEALL(trace);
+	deinit_trace_allocator((TraceAllocator *) trace);
+	result->status = TEST_PASS;
+	return result;
+}
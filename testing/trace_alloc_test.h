@@ -0,0 +1,10 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *trace_alloc_init_deinit(TestResult*);
+TestResult *trace_alloc_sites(TestResult*);
+TestResult *trace_alloc_invalid_free(TestResult*);
+TestResult *trace_alloc_table_growth(TestResult*);
+TestResult *trace_alloc_freeall(TestResult*);
+TestResult *trace_alloc_batch_sites(TestResult*);
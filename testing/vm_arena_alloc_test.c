@@ -0,0 +1,179 @@
+#include "vm_arena_alloc_test.h"
+#include "../memory.h"
+
+TestResult *vm_arena_alloc_init_deinit(TestResult *result) {
+	Result res;
+	INIT_RESULT(result, "[vm_arena_alloc_init_deinit] ");
+
+	res = new_vm_arena_allocator((size_t) 1 << 30, 0);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to instantiate vm arena allocator");
+		return result;
+	}
+
+	res = deinit_vm_arena_allocator((VmArenaAllocator *) res.data.data);
+	if (res.status != ERROR_OK) {
+		MSG_PRINT(result, "Unable to deinit vm arena allocator");
+		return result;
+	}
+
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *vm_arena_alloc_commit(TestResult *result) {
+	VmArenaAllocator *arena;
+	Slice grown;
+	Result res;
+	INIT_RESULT(result, "[vm_arena_alloc_commit] ");
+
+	arena = (VmArenaAllocator *) new_vm_arena_allocator((size_t) 1 << 30, 0).data.data;
+	if (arena->committed != VM_ARENA_COMMIT_GRANULE) {
+		MSG_PRINT(result, "Reservation committed more than its first granule");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	grown = ALLOC((Allocator *) arena, 100).data;
+	memset(grown.data, 0x5a, grown.length);
+
+	// Growing the last allocation commits pages behind it instead of moving
+	for (unsigned int size = 1 << 10; size <= 1 << 24; size <<= 2) {
+		res = REALLOC((Allocator *) arena, grown, size);
+		if (res.status != ERROR_OK || res.data.data != grown.data) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Growing to %u bytes moved the allocation",
+				size
+			);
+			deinit_vm_arena_allocator(arena);
+			return result;
+		}
+		grown = res.data;
+		memset((uint8_t *) grown.data + 100, 0, grown.length - 100);
+	}
+
+	if (((uint8_t *) grown.data)[99] != 0x5a || arena->committed < grown.length) {
+		MSG_PRINT(result, "Committed memory does not cover the allocation");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	res = ALLOC((Allocator *) arena, 1u << 31);
+	if (res.status == ERROR_OK) {
+		MSG_PRINT(result, "Allocated past the end of the reservation");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_vm_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *vm_arena_alloc_decommit(TestResult *result) {
+	VmArenaAllocator *arena;
+	Slice first, large;
+	Result res;
+	INIT_RESULT(result, "[vm_arena_alloc_decommit] ");
+
+	arena = (VmArenaAllocator *) new_vm_arena_allocator((size_t) 1 << 30, 4 * VM_ARENA_COMMIT_GRANULE).data.data;
+
+	first = ALLOC((Allocator *) arena, 64).data;
+	large = ALLOC((Allocator *) arena, 16 * VM_ARENA_COMMIT_GRANULE).data;
+	memset(large.data, 0xff, large.length);
+
+	res = FREEALL((Allocator *) arena);
+	if (res.status != ERROR_OK || arena->committed != 4 * VM_ARENA_COMMIT_GRANULE) {
+		sprintf(
+			result->message + strlen(result->message),
+			"FREEALL left %zu bytes committed",
+			arena->committed
+		);
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	res = ALLOC((Allocator *) arena, 64);
+	if (res.status != ERROR_OK || res.data.data != first.data) {
+		MSG_PRINT(result, "FREEALL did not reset the arena");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	// Decommitted pages come back zeroed
+	large = ALLOC((Allocator *) arena, 16 * VM_ARENA_COMMIT_GRANULE).data;
+	if (((uint8_t *) large.data)[large.length - 1] != 0) {
+		MSG_PRINT(result, "Decommitted pages kept their contents");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_vm_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *vm_arena_alloc_zeroed(TestResult *result) {
+	VmArenaAllocator *arena;
+	Slice dirty, zeroed;
+	INIT_RESULT(result, "[vm_arena_alloc_zeroed] ");
+
+	arena = (VmArenaAllocator *) new_vm_arena_allocator((size_t) 1 << 30, 0).data.data;
+
+	dirty = ALLOC((Allocator *) arena, 256).data;
+	memset(dirty.data, 0xff, dirty.length);
+	FREE((Allocator *) arena, dirty);
+
+	zeroed = ALLOC_ZEROED((Allocator *) arena, 4096).data;
+	if (zeroed.data != dirty.data) {
+		MSG_PRINT(result, "Freed memory was not reused");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+	for (unsigned int index = 0; index < zeroed.length; index++) {
+		if (((uint8_t *) zeroed.data)[index] != 0) {
+			sprintf(
+				result->message + strlen(result->message),
+				"Byte %u of the reused allocation is not zero",
+				index
+			);
+			deinit_vm_arena_allocator(arena);
+			return result;
+		}
+	}
+
+	deinit_vm_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
+
+TestResult *vm_arena_alloc_trim(TestResult *result) {
+	VmArenaAllocator *arena;
+	Slice large;
+	INIT_RESULT(result, "[vm_arena_alloc_trim] ");
+
+	arena = (VmArenaAllocator *) new_vm_arena_allocator((size_t) 1 << 30, 0).data.data;
+
+	large = ALLOC((Allocator *) arena, 16 * VM_ARENA_COMMIT_GRANULE).data;
+	FREE((Allocator *) arena, large);
+	if (arena->committed < 16 * VM_ARENA_COMMIT_GRANULE) {
+		MSG_PRINT(result, "Freeing decommitted without a trim");
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	if (vm_arena_trim(arena).status != ERROR_OK || arena->committed != VM_ARENA_COMMIT_GRANULE) {
+		sprintf(
+			result->message + strlen(result->message),
+			"Trim left %zu bytes committed",
+			arena->committed
+		);
+		deinit_vm_arena_allocator(arena);
+		return result;
+	}
+
+	deinit_vm_arena_allocator(arena);
+	result->status = TEST_PASS;
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "test.h"
+
+TestResult *vm_arena_alloc_init_deinit(TestResult*);
+TestResult *vm_arena_alloc_commit(TestResult*);
+TestResult *vm_arena_alloc_decommit(TestResult*);
+TestResult *vm_arena_alloc_zeroed(TestResult*);
+TestResult *vm_arena_alloc_trim(TestResult*);
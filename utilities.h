@@ -74,14 +74,60 @@ struct stack_collection_s {
 	Allocator *allocator;
 	unsigned int item_size;
 	unsigned int item_count;
+	unsigned int alignment;
 	Slice buffer;
 };
 Result new_stack_collection(StackCollection*, Allocator*, unsigned int item_size, unsigned int max_count);
+// An alignment of 0 leaves the buffer at the allocator's default alignment
+Result new_stack_collection_aligned(StackCollection*, Allocator*, unsigned int item_size, unsigned int max_count, unsigned int alignment);
 Result deinit_stack_collection(StackCollection *stack);
+Result stack_collection_grow(StackCollection *stack);
+
+// Static-dispatch versions of the Linear methods for callers that hold the
+// concrete type; the vtable entries are thin wrappers around them.
+static inline Result stack_push_inline(StackCollection *stack, Slice item) {
+	Result res;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (stack == 0 || item.data == 0 || item.length != stack->item_size) {
+		return res;
+	}
+
+	offset = stack->item_size * stack->item_count;
+	if (offset + stack->item_size > stack->buffer.length) {
+		res = stack_collection_grow(stack);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+	}
+
+	memcpy((uint8_t*)stack->buffer.data + offset, item.data, stack->item_size);
+	stack->item_count++;
+
+	res.status = ERROR_OK;
+	return res;
+}
+
+static inline Result stack_pop_inline(StackCollection *stack) {
+	Result res;
+	BASE_ERROR_RESULT(res);
+
+	if (stack == 0 || stack->item_count < 1) {
+		return res;
+	}
+
+	stack->item_count--;
+	res.status = ERROR_OK;
+	res.data.length = stack->item_size;
+	res.data.data = (void*)((uint8_t*)stack->buffer.data + stack->item_count * stack->item_size);
+	return res;
+}
 
 typedef struct queue_collection_s QueueCollection;
 #include "utilities/queue.h"
 Result new_queue_collection(QueueCollection*, Allocator*, unsigned int item_size, unsigned int max_count);
+Result new_queue_collection_aligned(QueueCollection*, Allocator*, unsigned int item_size, unsigned int max_count, unsigned int alignment);
 Result deinit_queue_collection(QueueCollection*);
 
 typedef struct indexing_s Indexing;
@@ -123,10 +169,60 @@ struct array_list_s {
 	Slice buffer;
 	unsigned int item_size;
 	unsigned int item_count;
+	unsigned int alignment;
 };
 Result new_array_list(ArrayList *, Allocator*, unsigned int item_size, unsigned int max_count);
+Result new_array_list_aligned(ArrayList *, Allocator*, unsigned int item_size, unsigned int max_count, unsigned int alignment);
 Result deinit_array_list(ArrayList*);
 Result deinit_array_list_items(ArrayList *);
+Result array_list_grow(ArrayList *);
+Result array_list_shrink(ArrayList *);
+
+static inline Result array_list_get_inline(ArrayList *al, int index) {
+	Result res;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (al == 0) {
+		return res;
+	}
+
+	offset = index < 0 ? al->item_count + index : (unsigned int) index;
+	if (offset >= al->item_count) {
+		return res;
+	}
+
+	res.status = ERROR_OK;
+	res.data.length = al->item_size;
+	res.data.data = (void*)((uint8_t*)al->buffer.data + offset * al->item_size);
+	return res;
+}
+
+static inline Result array_list_push_inline(ArrayList *al, Slice item) {
+	Result res;
+	unsigned int offset;
+	BASE_ERROR_RESULT(res);
+
+	if (al == 0 || item.data == 0 || item.length != al->item_size) {
+		return res;
+	}
+
+	offset = al->item_count * al->item_size;
+	if (offset + al->item_size > al->buffer.length) {
+		res = array_list_grow(al);
+		if (res.status != ERROR_OK) {
+			return res;
+		}
+	}
+
+	memcpy((uint8_t*)al->buffer.data + offset, item.data, al->item_size);
+	al->item_count++;
+
+	res.status = ERROR_OK;
+	res.data.length = al->item_size;
+	res.data.data = (void*)((uint8_t*)al->buffer.data + offset);
+	return res;
+}
 
 /*typedef struct hashmap8_s Hashmap8;
 #include "utilities/hash.h"
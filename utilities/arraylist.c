@@ -5,34 +5,7 @@
 #include <string.h>
 
 function Result array_list_get(Indexing* indexing, int index) {
-	Result res;
-	ArrayList *al;
-	unsigned int offset;
-	Slice val;
-	BASE_ERROR_RESULT(res);
-
-	if (indexing == 0) {
-		return res;
-	}
-
-	al = (ArrayList*) indexing;
-	if (index < 0) {
-		offset = al->item_count + index;
-	} else {
-		offset = index;
-	}
-
-	if (offset >= al->item_count) {
-		return res;
-	}
-
-	val.length = al->item_size;
-	val.data = ((uint8_t*)al->buffer.data + (offset * al->item_size));
-
-	res.status = ERROR_OK;
-	res.data = val;
-
-	return res;
+	return array_list_get_inline((ArrayList*) indexing, index);
 }
 
 function Result array_list_index_of(Indexing* indexing, Slice item) {
@@ -115,12 +88,10 @@ function Result array_list_insert(Indexing* indexing, Slice item, int index) {
 	}
 
 	if (al->item_count * al->item_size >= al->buffer.length) {
-		alloc_res = REALLOC(al->allocator, al->buffer, al->buffer.length << 1);
+		alloc_res = array_list_grow(al);
 		if (alloc_res.status != ERROR_OK) {
 			return res;
 		}
-
-		al->buffer = alloc_res.data;
 	}
 
 	if (index < 0) {
@@ -248,46 +219,63 @@ function Result array_list_replace(Indexing *indexing, Slice item, int index) {
     return res;
 }
 
-function Result array_list_push(Linear *linear, Slice item) {
+// Doubles the buffer, in place when the allocator allows it
+Result array_list_grow(ArrayList *al) {
     Result res;
-    ArrayList *al;
-    unsigned int offset;
-    #ifdef DEBUG_SET
-    #pragma GCC diagnostic push
-    #pragma GCC diagnostic ignored "-Wunused-variable"
-    char *item_str = (char *) item.data;
-    #pragma GCC diagnostic pop
-    #endif
     BASE_ERROR_RESULT(res);
 
-    if (linear == 0 || item.data == 0) {
+    if (al == 0) {
         return res;
     }
 
-    al = (ArrayList *) linear;
-    if (item.length != al->item_size) {
+    res = RESIZE(al->allocator, al->buffer, al->buffer.length << 1);
+    if (res.status != ERROR_OK && al->alignment != 0) {
+        res = standard_realloc_aligned(al->allocator, al->buffer, al->buffer.length << 1, al->alignment);
+    } else if (res.status != ERROR_OK) {
+        res = REALLOC(al->allocator, al->buffer, al->buffer.length << 1);
+    }
+    if (res.status != ERROR_OK) {
         return res;
     }
+    al->buffer = res.data;
 
-    offset = al->item_count * al->item_size;
-    if (offset >= al->buffer.length) {
-        res = REALLOC(al->allocator, al->buffer, al->buffer.length << 1);
-        if (res.status != ERROR_OK) {
-            return res;
-        }
-        al->buffer = res.data;
+    return res;
+}
+
+// Gives the spare capacity back to the allocator, keeping room for one item
+Result array_list_shrink(ArrayList *al) {
+    Result res;
+    unsigned int length;
+    BASE_ERROR_RESULT(res);
+
+    if (al == 0) {
+        return res;
     }
 
-    res = slice_copy(slice_sub(al->buffer, offset, al->item_size), item);
-    if (res.status != ERROR_OK) {
+    length = (al->item_count > 0 ? al->item_count : 1) * al->item_size;
+    if (length >= al->buffer.length) {
+        res.status = ERROR_OK;
+        res.data = al->buffer;
         return res;
     }
 
-    al->item_count++;
+    if (al->alignment != 0) {
+        res = standard_realloc_aligned(al->allocator, al->buffer, length, al->alignment);
+    } else {
+        res = REALLOC(al->allocator, al->buffer, length);
+    }
+    if (res.status != ERROR_OK) {
+        return res;
+    }
+    al->buffer = res.data;
 
     return res;
 }
 
+function Result array_list_push(Linear *linear, Slice item) {
+    return array_list_push_inline((ArrayList *) linear, item);
+}
+
 function Result array_list_pop(Linear *linear) {
     Result res;
     ArrayList *al;
@@ -377,22 +365,38 @@ function Iterator array_list_get_iterator(Indexing *indexing) {
 }
 
 Result new_array_list(ArrayList *al, Allocator* allocator, unsigned int item_size, unsigned int max_count) {
+	return new_array_list_aligned(al, allocator, item_size, max_count, 0);
+}
+
+Result new_array_list_aligned(ArrayList *al, Allocator* allocator, unsigned int item_size, unsigned int max_count, unsigned int alignment) {
 	Result res, alloc_res;
 	BASE_ERROR_RESULT(res);
 
 	if (al == 0 || allocator == 0 || item_size == 0 || max_count == 0) {
 		return res;
 	}
+	if (alignment != 0 && !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
 
 	al->allocator = allocator;
 	al->item_size = item_size;
 	al->item_count = 0;
-	alloc_res = ALLOC(allocator, item_size * max_count);
+	al->alignment = alignment;
+	// There is no aligned flavour of ALLOC_ZEROED, so only aligned lists
+	// pay for clearing the buffer up front
+	if (alignment != 0) {
+		alloc_res = ALLOC_ALIGNED(allocator, item_size * max_count, alignment);
+		if (alloc_res.status == ERROR_OK) {
+			memset(alloc_res.data.data, 0, alloc_res.data.length);
+		}
+	} else {
+		alloc_res = ALLOC_ZEROED(allocator, item_size * max_count);
+	}
 	if (alloc_res.status != ERROR_OK) {
 		return res;
 	}
 	al->buffer = alloc_res.data;
-	memset(al->buffer.data, 0, al->buffer.length);
 
 	al->outside_functions.get = array_list_get;
 	al->outside_functions.index_of = array_list_index_of;
@@ -432,26 +436,23 @@ Result deinit_array_list(ArrayList* al) {
 	return res;
 }
 
+// Each item is a Slice allocated from the list's allocator. The items are
+// released with one batch call and the list is left empty.
 Result deinit_array_list_items(ArrayList *al) {
 	Result res;
 	BASE_ERROR_RESULT(res); 
 
-	if (al == 0) {
+	if (al == 0 || al->allocator == 0 || al->item_size != sizeof(Slice)) {
 		return res;
 	}
 
-	for (unsigned int index = 0; index < al->item_count; index++) {
-		res = INDEXING_GET(al, index);
-		if (res.status != ERROR_OK) {
-			return res;
-		}
-		res = FREE(al->allocator, res.data);
-		if (res.status != ERROR_OK) {
-			return res;
-		}
+	if (al->item_count == 0) {
+		res.status = ERROR_OK;
+		return res;
 	}
 
-	res.status = ERROR_OK;
+	res = FREE_BATCH(al->allocator, (Slice *) al->buffer.data, al->item_count);
+	al->item_count = 0;
 	return res;
 }
 
@@ -20,7 +20,12 @@ function Result queue_push(Linear* linear, Slice item) {
 	if (queue->item_count * queue->item_size >= queue->buffer.length) {
 		unsigned int relocation_start = queue->head * queue->item_size;
 		unsigned int relocation_length = queue->buffer.length - relocation_start;
-		Result realloc_res = REALLOC(queue->allocator, queue->buffer, queue->buffer.length << 1);
+		Result realloc_res = RESIZE(queue->allocator, queue->buffer, queue->buffer.length << 1);
+		if (realloc_res.status != ERROR_OK && queue->alignment != 0) {
+			realloc_res = standard_realloc_aligned(queue->allocator, queue->buffer, queue->buffer.length << 1, queue->alignment);
+		} else if (realloc_res.status != ERROR_OK) {
+			realloc_res = REALLOC(queue->allocator, queue->buffer, queue->buffer.length << 1);
+		}
 		if (realloc_res.status != ERROR_OK) {
 			return res;
 		}
@@ -98,20 +103,33 @@ function Result queue_clone(Linear *linear) {
 }
 
 Result new_queue_collection(QueueCollection* queue, Allocator* allocator, unsigned int item_size, unsigned int max_count) {
+	return new_queue_collection_aligned(queue, allocator, item_size, max_count, 0);
+}
+
+Result new_queue_collection_aligned(QueueCollection* queue, Allocator* allocator, unsigned int item_size, unsigned int max_count, unsigned int alignment) {
 	Result res;
 	BASE_ERROR_RESULT(res);
 
 	if (allocator == 0 || item_size == 0 || max_count == 0) {
 		return res;
 	}
+	if (alignment != 0 && !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
 
 	queue->allocator = allocator;
 	queue->item_size = item_size;
 	queue->item_count = 0;
 	queue->head = 0;
 	queue->tail = 0;
+	queue->alignment = alignment;
 
-	Result buffer_res = ALLOC(allocator, max_count * item_size);
+	Result buffer_res;
+	if (alignment != 0) {
+		buffer_res = ALLOC_ALIGNED(allocator, max_count * item_size, alignment);
+	} else {
+		buffer_res = ALLOC(allocator, max_count * item_size);
+	}
 	if (buffer_res.status != ERROR_OK) {
 		return res;
 	}
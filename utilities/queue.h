@@ -10,4 +10,5 @@ struct queue_collection_s {
 	unsigned int tail;
 	unsigned int item_size;
 	unsigned int item_count;
+	unsigned int alignment;
 };
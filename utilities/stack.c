@@ -5,58 +5,35 @@
 #include <stdint.h>
 #include <string.h>
 
-function Result stack_push(Linear *collection, Slice item) {
+// Doubles the buffer, in place when the allocator allows it
+Result stack_collection_grow(StackCollection *stack) {
 	Result res;
 	BASE_ERROR_RESULT(res);
 
-	if (collection == 0 || item.length == 0 || item.data == 0) {
+	if (stack == 0) {
 		return res;
 	}
 
-	StackCollection *stack = (StackCollection*)collection;
-	if (stack->item_size != item.length) {
-		return res;
+	res = RESIZE(stack->allocator, stack->buffer, stack->buffer.length << 1);
+	if (res.status != ERROR_OK && stack->alignment != 0) {
+		res = standard_realloc_aligned(stack->allocator, stack->buffer, stack->buffer.length << 1, stack->alignment);
+	} else if (res.status != ERROR_OK) {
+		res = REALLOC(stack->allocator, stack->buffer, stack->buffer.length << 1);
 	}
-
-	unsigned int new_offset = stack->item_size * stack->item_count;
-	unsigned int new_length = stack->item_size + new_offset;
-
-	if (new_length > stack->buffer.length) {
-		Result result = REALLOC(stack->allocator, stack->buffer, stack->buffer.length << 1);
-		if (result.status == ERROR_ERR) {
-			return res;
-		}
-		stack->buffer = result.data;
+	if (res.status != ERROR_OK) {
+		return res;
 	}
-
-	memcpy((char*)stack->buffer.data + new_offset, item.data, stack->item_size);
-	stack->item_count++;
-	res.status = ERROR_OK;
+	stack->buffer = res.data;
 
 	return res;
 }
 
-function Result stack_pop(Linear *collection) {
-	Result res;
-	BASE_ERROR_RESULT(res);
-
-	if (collection == 0) {
-		return res;
-	}
-
-	StackCollection* stack = (StackCollection*) collection;
-	if (stack->item_count < 1) {
-		return res;
-	}
-
-	stack->item_count--;
-	unsigned int new_offset = stack->item_count * stack->item_size;
-
-	res.status = ERROR_OK;
-	res.data.length = stack->item_size;
-	res.data.data = (void*) ((uint8_t*)stack->buffer.data + new_offset);
+function Result stack_push(Linear *collection, Slice item) {
+	return stack_push_inline((StackCollection*) collection, item);
+}
 
-	return res;
+function Result stack_pop(Linear *collection) {
+	return stack_pop_inline((StackCollection*) collection);
 }
 
 function Result stack_clone(Linear *collection) {
@@ -86,12 +63,19 @@ function Result stack_clone(Linear *collection) {
 }
 
 Result new_stack_collection(StackCollection* stack, Allocator* allocator, unsigned int item_size, unsigned int initial_length) {
+	return new_stack_collection_aligned(stack, allocator, item_size, initial_length, 0);
+}
+
+Result new_stack_collection_aligned(StackCollection* stack, Allocator* allocator, unsigned int item_size, unsigned int initial_length, unsigned int alignment) {
 	Result res;
 	BASE_ERROR_RESULT(res);
 
 	if (allocator == 0 || item_size == 0 || initial_length == 0) {
 		return res;
 	}
+	if (alignment != 0 && !ALIGNMENT_VALID(alignment)) {
+		return res;
+	}
 
 	stack->outside_functions.clone = stack_clone;
 	stack->outside_functions.pop = stack_pop;
@@ -100,7 +84,13 @@ Result new_stack_collection(StackCollection* stack, Allocator* allocator, unsign
 	stack->allocator = allocator;
 	stack->item_size = item_size;
 	stack->item_count = 0;
-	Result alloc_res = ALLOC(allocator, initial_length * item_size);
+	stack->alignment = alignment;
+	Result alloc_res;
+	if (alignment != 0) {
+		alloc_res = ALLOC_ALIGNED(allocator, initial_length * item_size, alignment);
+	} else {
+		alloc_res = ALLOC(allocator, initial_length * item_size);
+	}
 	if (alloc_res.status == ERROR_ERR) {
 		return res;
 	}